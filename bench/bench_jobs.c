@@ -0,0 +1,149 @@
+/*
+ * bench_jobs.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "owl_bench.h"
+
+#define STEPS 16
+#define SPAWNS 100000
+
+typedef struct Particle {
+  f32 x, y;
+  f32 vx, vy;
+  f32 life;
+} Particle;
+
+static void update(s32 first, s32 last, void *ud) {
+  Particle *p = (Particle *)ud + first;
+  s32 i, s;
+
+  /* A few substeps of a swirl field, enough work to be compute bound */
+  for (i = first; i < last; ++i, ++p)
+    for (s = 0; s < STEPS; ++s) {
+      p->vx += sinf(p->y * 0.01f) * 0.1f;
+      p->vy += cosf(p->x * 0.01f) * 0.1f - 0.05f;
+      p->x += p->vx * 0.016f;
+      p->y += p->vy * 0.016f;
+      p->life -= 0.001f;
+
+      if (p->life < 0) {
+        p->x = (f32)(i % 800);
+        p->y = (f32)(i % 600);
+        p->life = 1.0f;
+      }
+    }
+}
+
+static void spawn(s32 first, s32 last, void *ud) {}
+
+static void nothing(owl_Job *job, void *ud) {}
+
+static void spawner(owl_Job *job, void *ud) {
+  s32 i;
+
+  for (i = 0; i < SPAWNS; ++i)
+    owl_job(nothing, NULL, job, NULL);
+}
+
+static void reset(Particle *particles, s32 count) {
+  s32 i;
+
+  srand(20220501);
+
+  for (i = 0; i < count; ++i) {
+    particles[i].x = (f32)(rand() % 800);
+    particles[i].y = (f32)(rand() % 600);
+    particles[i].vx = (f32)(rand() % 200 - 100) * 0.01f;
+    particles[i].vy = (f32)(rand() % 200 - 100) * 0.01f;
+    particles[i].life = (f32)(rand() % 1000) * 0.001f;
+  }
+}
+
+static f64 checksum(const Particle *particles, s32 count) {
+  f64 sum = 0;
+  s32 i;
+
+  for (i = 0; i < count; ++i)
+    sum += particles[i].x + particles[i].y;
+
+  return sum;
+}
+
+static f64 run(Particle *particles, s32 count, s32 frames, bool parallel) {
+  f64 start;
+  s32 f;
+
+  reset(particles, count);
+  start = owl_time(NULL, NULL);
+
+  for (f = 0; f < frames; ++f)
+    if (parallel)
+      owl_parallelFor(count, 0, update, particles);
+    else
+      update(0, count, particles);
+
+  return (owl_time(NULL, NULL) - start) / frames;
+}
+
+s32 bench_jobs(s32 argc, char *argv[]) {
+  s32 count = argc > 0 ? atoi(argv[0]) : 200000;
+  s32 frames = argc > 1 ? atoi(argv[1]) : 20;
+  s32 threads, cores;
+  Particle *particles;
+  f64 serial, elapsed, sum, start;
+  owl_Job *job;
+
+  if (count <= 0 || frames <= 0)
+    return -1;
+
+  particles = (Particle *)malloc(count * sizeof(Particle));
+
+  if (!particles)
+    return -1;
+
+  owl_jobWorkers(0);
+  cores = owl_jobThreads() + 1;
+
+  serial = run(particles, count, frames, false);
+  sum = checksum(particles, count);
+
+  printf("%2d thread   %8.3f ms/frame  %5.2fx  %5.1f%%\n", 1,
+         serial * 1000.0, 1.0, 100.0);
+
+  /* The calling thread takes part, so n workers make n + 1 threads */
+  for (threads = 2; threads <= cores; ++threads) {
+    owl_jobWorkers(threads - 1);
+    owl_parallelFor(count, 0, spawn, NULL);
+
+    elapsed = run(particles, count, frames, true);
+
+    printf("%2d threads  %8.3f ms/frame  %5.2fx  %5.1f%%%s\n", threads,
+           elapsed * 1000.0, serial / elapsed,
+           serial / elapsed * 100.0 / threads,
+           checksum(particles, count) == sum ? "" : "  MISMATCH");
+  }
+
+  /* Scheduling cost of tiny jobs hanging off one parent */
+  start = owl_time(NULL, NULL);
+  owl_job(spawner, NULL, NULL, &job);
+  owl_waitJob(job);
+  elapsed = owl_time(NULL, NULL) - start;
+
+  printf("%-11s %8.1f ns/job (%d children, %d threads)\n", "spawn",
+         elapsed * 1e9 / SPAWNS, SPAWNS, cores);
+
+  owl_jobWorkers(0);
+  free(particles);
+  return 0;
+}
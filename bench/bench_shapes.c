@@ -0,0 +1,163 @@
+/*
+ * bench_shapes.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "owl_bench.h"
+
+#define SCREEN_W 800
+#define SCREEN_H 600
+
+#define SHAPE_PIXELS 0
+#define SHAPE_LINES 1
+#define SHAPE_RECTS 2
+#define SHAPE_FILLRECTS 3
+#define SHAPE_CIRCLES 4
+#define SHAPE_KINDS 5
+
+typedef struct Shapes {
+  owl_Rect *rects;
+  owl_Point *points;
+  f32 *radii;
+  owl_Pixel *colors;
+  s32 count;
+} Shapes;
+
+static const char *names[SHAPE_KINDS] = {"pixels", "lines", "rects",
+                                         "fillRects", "circles"};
+
+static void scalar(const Shapes *s, s32 kind) {
+  const owl_Point *p = s->points;
+  const owl_Rect *r = s->rects;
+  s32 i;
+
+  for (i = 0; i < s->count; ++i) {
+    owl_color(s->colors[i]);
+
+    switch (kind) {
+    case SHAPE_PIXELS:
+      owl_pixel(p[i].x, p[i].y);
+      break;
+    case SHAPE_LINES:
+      owl_line(p[i * 2].x, p[i * 2].y, p[i * 2 + 1].x, p[i * 2 + 1].y);
+      break;
+    case SHAPE_RECTS:
+      owl_rect(r[i].x, r[i].y, r[i].w, r[i].h);
+      break;
+    case SHAPE_FILLRECTS:
+      owl_fillRect(r[i].x, r[i].y, r[i].w, r[i].h);
+      break;
+    case SHAPE_CIRCLES:
+      owl_circle(p[i].x, p[i].y, s->radii[i]);
+      break;
+    }
+  }
+}
+
+static void batched(const Shapes *s, s32 kind) {
+  switch (kind) {
+  case SHAPE_PIXELS:
+    owl_pixels(s->points, s->colors, s->count);
+    break;
+  case SHAPE_LINES:
+    owl_lines(s->points, s->colors, s->count);
+    break;
+  case SHAPE_RECTS:
+    owl_rects(s->rects, s->colors, s->count);
+    break;
+  case SHAPE_FILLRECTS:
+    owl_fillRects(s->rects, s->colors, s->count);
+    break;
+  case SHAPE_CIRCLES:
+    owl_circles(s->points, s->radii, s->colors, s->count);
+    break;
+  }
+}
+
+static f64 run(const Shapes *s, s32 kind, s32 frames, bool batch) {
+  f64 begin, elapsed = 0;
+  s32 f;
+
+  for (f = 0; f < frames; ++f) {
+    owl_color(owl_rgb(0, 0, 0));
+    owl_clear();
+
+    begin = owl_time(NULL, NULL);
+
+    if (batch)
+      batched(s, kind);
+    else
+      scalar(s, kind);
+
+    owl_present();
+    elapsed += owl_time(NULL, NULL) - begin;
+  }
+  return elapsed;
+}
+
+s32 bench_shapes(s32 argc, char *argv[]) {
+  s32 count = argc > 0 ? atoi(argv[0]) : 10000;
+  s32 frames = argc > 1 ? atoi(argv[1]) : 100;
+  f64 one, many;
+  Shapes s;
+  s32 i, kind;
+
+  if (count <= 0 || frames <= 0)
+    return -1;
+
+  if (!owl_init(SCREEN_W, SCREEN_H, "owlbench: shapes", 0))
+    return -1;
+
+  s.count = count;
+  s.rects = (owl_Rect *)malloc(count * sizeof(owl_Rect));
+  s.points = (owl_Point *)malloc(count * 2 * sizeof(owl_Point));
+  s.radii = (f32 *)malloc(count * sizeof(f32));
+  s.colors = (owl_Pixel *)malloc(count * sizeof(owl_Pixel));
+
+  if (!s.rects || !s.points || !s.radii || !s.colors)
+    goto cleanup;
+
+  srand(20220501);
+
+  for (i = 0; i < count; ++i) {
+    s.rects[i].x = (f32)(rand() % SCREEN_W);
+    s.rects[i].y = (f32)(rand() % SCREEN_H);
+    s.rects[i].w = (f32)(4 + rand() % 32);
+    s.rects[i].h = (f32)(4 + rand() % 32);
+    s.radii[i] = (f32)(2 + rand() % 24);
+    s.colors[i] = owl_rgba((u8)rand(), (u8)rand(), (u8)rand(), 0xFF);
+  }
+
+  for (i = 0; i < count * 2; ++i) {
+    s.points[i].x = (f32)(rand() % SCREEN_W);
+    s.points[i].y = (f32)(rand() % SCREEN_H);
+  }
+
+  /* Both timings include the present, so the GPU side is accounted for */
+  for (kind = 0; kind < SHAPE_KINDS; ++kind) {
+    one = run(&s, kind, frames, false);
+    many = run(&s, kind, frames, true);
+
+    printf("%-10s %8d shapes  %8.3f ms scalar  %8.3f ms array  %6.2fx\n",
+           names[kind], count, one * 1000.0 / frames,
+           many * 1000.0 / frames, many > 0 ? one / many : 0.0);
+  }
+
+cleanup:
+  free(s.rects);
+  free(s.points);
+  free(s.radii);
+  free(s.colors);
+
+  owl_quit();
+  return 0;
+}
@@ -0,0 +1,143 @@
+/*
+ * bench_sprites.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "owl_bench.h"
+
+#define SCREEN_W 800
+#define SCREEN_H 600
+#define SPRITE_SIZE 32
+
+typedef struct Sprite {
+  owl_Rect pos;
+  f32 angle;
+  u8 flip;
+} Sprite;
+
+static owl_Canvas *checker(void) {
+  u8 pixels[SPRITE_SIZE * SPRITE_SIZE * 4];
+  s32 x, y;
+  u8 *p = pixels;
+
+  for (y = 0; y < SPRITE_SIZE; ++y)
+    for (x = 0; x < SPRITE_SIZE; ++x) {
+      u8 on = ((x >> 3) ^ (y >> 3)) & 1;
+
+      *p++ = on ? 0xff : 0x40;
+      *p++ = on ? 0xc0 : 0x40;
+      *p++ = on ? 0x20 : 0xff;
+      *p++ = 0xff;
+    }
+
+  return owl_image(pixels, SPRITE_SIZE, SPRITE_SIZE, OWL_FORMAT_RGBA);
+}
+
+static f64 run(owl_Canvas *image, Sprite *sprites, s32 count, s32 frames,
+               owl_SpriteBatch *batch, f64 *submit) {
+  f64 start, begin, elapsed = 0;
+  s32 i, f;
+
+  start = owl_time(NULL, NULL);
+
+  for (f = 0; f < frames; ++f) {
+    owl_color(owl_rgb(0, 0, 0));
+    owl_clear();
+
+    begin = owl_time(NULL, NULL);
+
+    if (batch) {
+      owl_batchBegin(batch);
+
+      for (i = 0; i < count; ++i)
+        owl_batchDraw(batch, image, NULL, &sprites[i].pos, sprites[i].angle,
+                      NULL, sprites[i].flip);
+
+      owl_batchEnd(batch);
+    } else {
+      for (i = 0; i < count; ++i)
+        owl_blit(image, NULL, &sprites[i].pos, sprites[i].angle, NULL,
+                 sprites[i].flip);
+    }
+
+    elapsed += owl_time(NULL, NULL) - begin;
+
+    owl_present();
+
+    for (i = 0; i < count; ++i)
+      sprites[i].angle += 1.0f;
+  }
+
+  *submit = elapsed;
+  return owl_time(NULL, NULL) - start;
+}
+
+static void report(const char *name, s32 count, s32 frames, f64 total,
+                   f64 submit) {
+  printf("%-10s %8d sprites  %8.3f ms/frame  %8.3f ms submit  %12.0f "
+         "sprites/s\n",
+         name, count, total * 1000.0 / frames, submit * 1000.0 / frames,
+         (f64)count * frames / submit);
+}
+
+s32 bench_sprites(s32 argc, char *argv[]) {
+  s32 count = argc > 0 ? atoi(argv[0]) : 5000;
+  s32 frames = argc > 1 ? atoi(argv[1]) : 300;
+  owl_SpriteBatch *batch;
+  owl_Canvas *image;
+  Sprite *sprites;
+  f64 total, submit;
+  s32 i;
+
+  if (count <= 0 || frames <= 0)
+    return -1;
+
+  if (!owl_init(SCREEN_W, SCREEN_H, "owlbench: sprites", 0))
+    return -1;
+
+  image = checker();
+  batch = owl_spriteBatch(0);
+  sprites = (Sprite *)malloc(count * sizeof(Sprite));
+
+  if (!image || !batch || !sprites)
+    goto cleanup;
+
+  srand(20220501);
+
+  for (i = 0; i < count; ++i) {
+    sprites[i].pos.x = (f32)(rand() % (SCREEN_W - SPRITE_SIZE));
+    sprites[i].pos.y = (f32)(rand() % (SCREEN_H - SPRITE_SIZE));
+    sprites[i].pos.w = SPRITE_SIZE;
+    sprites[i].pos.h = SPRITE_SIZE;
+    sprites[i].angle = (f32)(rand() % 360);
+    sprites[i].flip = (u8)(rand() % 4);
+  }
+
+  total = run(image, sprites, count, frames, NULL, &submit);
+  report("owl_blit", count, frames, total, submit);
+
+  total = run(image, sprites, count, frames, batch, &submit);
+  report("batch", count, frames, total, submit);
+
+cleanup:
+  if (sprites)
+    free(sprites);
+
+  if (batch)
+    owl_freeSpriteBatch(batch);
+
+  if (image)
+    owl_freeCanvas(image);
+
+  owl_quit();
+  return 0;
+}
@@ -0,0 +1,271 @@
+/*
+ * bench_table.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "owl_bench.h"
+#include "owl_table.h"
+
+/* The nibble trie owl_Table used before, kept here as the baseline */
+#define TRIE_BITS 4
+#define TRIE_FACTOR (1 << TRIE_BITS)
+#define TRIE_MASK (TRIE_FACTOR - 1)
+
+typedef struct TrieNode {
+  void *value;
+  struct TrieNode *next[TRIE_FACTOR];
+} TrieNode;
+
+static u64 trie_bytes = 0;
+
+static TrieNode *trie(void) {
+  trie_bytes += sizeof(TrieNode);
+  return (TrieNode *)calloc(1, sizeof(TrieNode));
+}
+
+static void freeTrie(TrieNode *node) {
+  s32 i;
+
+  for (i = 0; i < TRIE_FACTOR; ++i)
+    if (node->next[i])
+      freeTrie(node->next[i]);
+
+  free(node);
+}
+
+static TrieNode **getTrie(TrieNode **root, const char *name, bool build) {
+  TrieNode **node = root;
+  const u8 *p = (const u8 *)name;
+  u8 ch;
+
+  while (!!(ch = *p++)) {
+    node = &(*node)->next[ch & TRIE_MASK];
+
+    if (!(*node)) {
+      if (!build)
+        return NULL;
+
+      *node = trie();
+    }
+
+    node = &(*node)->next[ch >> TRIE_BITS];
+
+    if (!(*node)) {
+      if (!build)
+        return NULL;
+
+      *node = trie();
+    }
+  }
+  return node;
+}
+
+static TrieNode **iGetTrie(TrieNode **root, u64 key, bool build) {
+  TrieNode **node = root;
+
+  while (key > 0) {
+    node = &(*node)->next[key & TRIE_MASK];
+
+    if (!(*node)) {
+      if (!build)
+        return NULL;
+
+      *node = trie();
+    }
+
+    key = key >> TRIE_BITS;
+  }
+  return node;
+}
+
+static char **makeKeys(s32 count, const char *fmt) {
+  char **keys = (char **)malloc(count * sizeof(char *));
+  char buffer[64];
+  s32 i;
+
+  if (!keys)
+    return NULL;
+
+  for (i = 0; i < count; ++i) {
+    snprintf(buffer, sizeof(buffer), fmt, (u32)rand() * 2654435761u, i);
+    keys[i] = strdup(buffer);
+  }
+  return keys;
+}
+
+static void freeKeys(char **keys, s32 count) {
+  s32 i;
+
+  for (i = 0; i < count; ++i)
+    free(keys[i]);
+
+  free(keys);
+}
+
+static void report(const char *name, s32 count, f64 insert, f64 hit,
+                   f64 miss, u64 bytes) {
+  printf("%-6s %8d keys  insert %7.1f ns  hit %7.1f ns  miss %7.1f ns  "
+         "%7.1f B/key\n",
+         name, count, insert * 1e9 / count, hit * 1e9 / count,
+         miss * 1e9 / count, (f64)bytes / count);
+}
+
+s32 bench_table(s32 argc, char *argv[]) {
+  s32 count = argc > 0 ? atoi(argv[0]) : 100000;
+  s32 rounds = argc > 1 ? atoi(argv[1]) : 10;
+  char **keys, **misses;
+  f64 start, insert, hit, miss;
+  owl_TableStats stats;
+  owl_Table *table;
+  TrieNode *root, **node;
+  u64 sum = 0;
+  s32 i, r;
+
+  if (count <= 0 || rounds <= 0)
+    return -1;
+
+  srand(20220501);
+
+  keys = makeKeys(count, "assets/sprites/%08x_%d.png");
+  misses = makeKeys(count, "assets/sounds/%08x_%d.wav");
+
+  if (!keys || !misses)
+    return -1;
+
+  trie_bytes = 0;
+  root = trie();
+
+  start = owl_time(NULL, NULL);
+
+  for (i = 0; i < count; ++i)
+    (*getTrie(&root, keys[i], true))->value = keys[i];
+
+  insert = owl_time(NULL, NULL) - start;
+  start = owl_time(NULL, NULL);
+
+  for (r = 0; r < rounds; ++r)
+    for (i = 0; i < count; ++i)
+      sum += (uword_t)(*getTrie(&root, keys[i], false))->value;
+
+  hit = (owl_time(NULL, NULL) - start) / rounds;
+  start = owl_time(NULL, NULL);
+
+  for (r = 0; r < rounds; ++r)
+    for (i = 0; i < count; ++i)
+      if (!!(node = getTrie(&root, misses[i], false)))
+        sum += (uword_t)(*node)->value;
+
+  miss = (owl_time(NULL, NULL) - start) / rounds;
+
+  report("trie", count, insert, hit, miss, trie_bytes);
+  freeTrie(root);
+
+  table = owl_table();
+
+  if (!table)
+    return -1;
+
+  start = owl_time(NULL, NULL);
+
+  for (i = 0; i < count; ++i)
+    owl_setTable(table, keys[i], keys[i]);
+
+  insert = owl_time(NULL, NULL) - start;
+  start = owl_time(NULL, NULL);
+
+  for (r = 0; r < rounds; ++r)
+    for (i = 0; i < count; ++i)
+      sum += (uword_t)owl_getTable(table, keys[i]);
+
+  hit = (owl_time(NULL, NULL) - start) / rounds;
+  start = owl_time(NULL, NULL);
+
+  for (r = 0; r < rounds; ++r)
+    for (i = 0; i < count; ++i)
+      sum += (uword_t)owl_getTable(table, misses[i]);
+
+  miss = (owl_time(NULL, NULL) - start) / rounds;
+
+  owl_tableStats(table, &stats);
+  report("table", count, insert, hit, miss, stats.bytes);
+
+  owl_compactTable(table);
+  owl_tableStats(table, &stats);
+  printf("%-6s %8d keys  %7.1f B/key after owl_compactTable\n", "table",
+         count, (f64)stats.bytes / count);
+  owl_freeTable(table, NULL);
+
+  /* Pointer-like integer keys, as the atlas region table uses */
+  trie_bytes = 0;
+  root = trie();
+
+  start = owl_time(NULL, NULL);
+
+  for (i = 0; i < count; ++i)
+    (*iGetTrie(&root, (uword_t)keys[i], true))->value = keys[i];
+
+  insert = owl_time(NULL, NULL) - start;
+  start = owl_time(NULL, NULL);
+
+  for (r = 0; r < rounds; ++r)
+    for (i = 0; i < count; ++i)
+      sum += (uword_t)(*iGetTrie(&root, (uword_t)keys[i], false))->value;
+
+  hit = (owl_time(NULL, NULL) - start) / rounds;
+  start = owl_time(NULL, NULL);
+
+  for (r = 0; r < rounds; ++r)
+    for (i = 0; i < count; ++i)
+      if (!!(node = iGetTrie(&root, (uword_t)misses[i], false)))
+        sum += (uword_t)(*node)->value;
+
+  miss = (owl_time(NULL, NULL) - start) / rounds;
+
+  report("itrie", count, insert, hit, miss, trie_bytes);
+  freeTrie(root);
+
+  table = owl_table();
+
+  if (!table)
+    return -1;
+
+  start = owl_time(NULL, NULL);
+
+  for (i = 0; i < count; ++i)
+    owl_iSetTable(table, (uword_t)keys[i], keys[i]);
+
+  insert = owl_time(NULL, NULL) - start;
+  start = owl_time(NULL, NULL);
+
+  for (r = 0; r < rounds; ++r)
+    for (i = 0; i < count; ++i)
+      sum += (uword_t)owl_iGetTable(table, (uword_t)keys[i]);
+
+  hit = (owl_time(NULL, NULL) - start) / rounds;
+  start = owl_time(NULL, NULL);
+
+  for (r = 0; r < rounds; ++r)
+    for (i = 0; i < count; ++i)
+      sum += (uword_t)owl_iGetTable(table, (uword_t)misses[i]);
+
+  miss = (owl_time(NULL, NULL) - start) / rounds;
+
+  owl_tableStats(table, &stats);
+  report("itable", count, insert, hit, miss, stats.bytes);
+  owl_freeTable(table, NULL);
+
+  freeKeys(keys, count);
+  freeKeys(misses, count);
+
+  return sum == 0;
+}
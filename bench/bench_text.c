@@ -0,0 +1,98 @@
+/*
+ * bench_text.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "owl_bench.h"
+
+static const char *samples[] = {
+    "The quick brown fox jumps over the lazy dog. ",
+    "AVAWAYTaTeToVaVeWaWeYaYoLTLVLYPA.,;:!? 0123456789 ",
+    "中英文abc混合ABC测试！猫头鹰在夜里看得很清楚。",
+    "天地玄黄，宇宙洪荒。日月盈昃，辰宿列张。寒来暑往，秋收冬藏。",
+};
+
+#define NUM_SAMPLES (s32)(sizeof(samples) / sizeof(*samples))
+
+static char *paragraph(s32 repeat) {
+  size_t len = 0, n;
+  char *text, *p;
+  s32 i;
+
+  for (i = 0; i < NUM_SAMPLES; ++i)
+    len += strlen(samples[i]);
+
+  text = (char *)malloc(len * repeat + 1);
+
+  if (!text)
+    return NULL;
+
+  for (p = text, i = 0; i < NUM_SAMPLES * repeat; ++i) {
+    n = strlen(samples[i % NUM_SAMPLES]);
+    memcpy(p, samples[i % NUM_SAMPLES], n);
+    p += n;
+  }
+
+  *p = '\0';
+  return text;
+}
+
+s32 bench_text(s32 argc, char *argv[]) {
+  const char *filename = argc > 0 ? argv[0] : "./unifont.ttf";
+  s32 size = argc > 1 ? atoi(argv[1]) : 16;
+  s32 repeat = argc > 2 ? atoi(argv[2]) : 2000;
+  s32 passes = 20, i;
+  f64 start, first, warm;
+  f32 width = 0;
+  char *text;
+
+  if (size <= 0 || repeat <= 0)
+    return -1;
+
+  if (!owl_init(320, 240, "owlbench: text", 0))
+    return -1;
+
+  if (!owl_loadFont("bench", filename) || !owl_font("bench", size)) {
+    printf("cannot load font %s\n", filename);
+    owl_quit();
+    return -1;
+  }
+
+  text = paragraph(repeat);
+
+  if (!text) {
+    owl_quit();
+    return -1;
+  }
+
+  /* The first pass fills the advance and kerning caches */
+  start = owl_time(NULL, NULL);
+  width = owl_textWidth(text);
+  first = owl_time(NULL, NULL) - start;
+
+  start = owl_time(NULL, NULL);
+
+  for (i = 0; i < passes; ++i)
+    width += owl_textWidth(text);
+
+  warm = (owl_time(NULL, NULL) - start) / passes;
+
+  printf("%-10s %8u bytes  %8.3f ms cold  %8.3f ms warm  %8.1f MB/s "
+         "(%.0f)\n",
+         "textWidth", (u32)strlen(text), first * 1000.0, warm * 1000.0,
+         strlen(text) / warm / (1024.0 * 1024.0), width);
+
+  free(text);
+  owl_quit();
+  return 0;
+}
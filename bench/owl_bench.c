@@ -0,0 +1,51 @@
+/*
+ * owl_bench.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "SDL_main.h"
+#include "owl_bench.h"
+
+static const owl_Bench benches[] = {
+    {"jobs", "[particles] [frames]", bench_jobs},
+    {"shapes", "[shapes] [frames]", bench_shapes},
+    {"sprites", "[sprites] [frames]", bench_sprites},
+    {"table", "[keys] [rounds]", bench_table},
+    {"text", "[font] [size] [repeat]", bench_text},
+};
+
+#define OWL_NUM_BENCHES (s32)(sizeof(benches) / sizeof(*benches))
+
+static void usage(const char *self) {
+  s32 i;
+
+  printf("usage: %s <bench> [args...]\n\n", self);
+
+  for (i = 0; i < OWL_NUM_BENCHES; ++i)
+    printf("  %-10s %s\n", benches[i].name, benches[i].usage);
+}
+
+int main(int argc, char *argv[]) {
+  s32 i;
+
+  if (argc < 2) {
+    usage(argv[0]);
+    return -1;
+  }
+
+  for (i = 0; i < OWL_NUM_BENCHES; ++i)
+    if (0 == strcmp(argv[1], benches[i].name))
+      return benches[i].run(argc - 2, argv + 2);
+
+  usage(argv[0]);
+  return -1;
+}
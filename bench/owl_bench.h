@@ -0,0 +1,39 @@
+/*
+ * owl_bench.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_BENCH_H__
+#define __OWL_BENCH_H__
+
+#include "owl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef s32 (*owl_BenchFunc)(s32 argc, char *argv[]);
+
+typedef struct owl_Bench {
+  const char *name;
+  const char *usage;
+  owl_BenchFunc run;
+} owl_Bench;
+
+extern s32 bench_jobs(s32 argc, char *argv[]);
+extern s32 bench_shapes(s32 argc, char *argv[]);
+extern s32 bench_sprites(s32 argc, char *argv[]);
+extern s32 bench_table(s32 argc, char *argv[]);
+extern s32 bench_text(s32 argc, char *argv[]);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_BENCH_H__ */
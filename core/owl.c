@@ -9,15 +9,30 @@
  * Usage of Owl is subject to the appropriate license agreement.
  */
 
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "SDL_gpu.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 #include "owl.h"
+#include "owl_async.h"
+#include "owl_atlas.h"
+#include "owl_cache.h"
+#include "owl_command.h"
 #include "owl_font.h"
 #include "owl_framerate.h"
+#include "owl_job.h"
+#include "owl_lz.h"
+#include "owl_render.h"
+#include "owl_shader.h"
+#include "owl_shapes.h"
 #include "owl_sound.h"
+#include "owl_tex.h"
+#include "owl_vfs.h"
 
 #define OWL_WINDOW_FLAGS SDL_WINDOW_OPENGL | SDL_WINDOW_ALLOW_HIGHDPI
 
@@ -68,6 +83,16 @@ u64 owl_ticks(void) {
 
 void owl_sleep(u32 ms) { SDL_Delay(ms); }
 
+static u32 owl_refreshRate(void) {
+  SDL_DisplayMode mode;
+  s32 display = SDL_GetWindowDisplayIndex(app->window);
+
+  if (display < 0 || 0 != SDL_GetCurrentDisplayMode(display, &mode))
+    return 0;
+
+  return mode.refresh_rate > 0 ? (u32)mode.refresh_rate : 0;
+}
+
 bool owl_init(s32 width, s32 height, const char *title, s32 flags) {
   s32 x = SDL_WINDOWPOS_CENTERED, y = SDL_WINDOWPOS_CENTERED;
 
@@ -113,6 +138,12 @@ bool owl_init(s32 width, s32 height, const char *title, s32 flags) {
   app->width = width;
   app->height = height;
 
+  if (!owl_atlasInit())
+    goto error;
+
+  if (!owl_shapesInit())
+    goto error;
+
   if (!owl_fontInit())
     goto error;
 
@@ -120,6 +151,8 @@ bool owl_init(s32 width, s32 height, const char *title, s32 flags) {
     goto error;
 
   owl_setFPS(OWL_FRAMERATE_DEFAULT);
+  owl_frameRateSync(&app->fps, SDL_GL_GetSwapInterval() != 0,
+                    owl_refreshRate());
   return true;
 
 error:
@@ -128,8 +161,15 @@ error:
 }
 
 void owl_quit(void) {
+  owl_asyncQuit();
+  owl_cacheQuit();
   owl_soundQuit();
   owl_fontQuit();
+  owl_atlasQuit();
+  owl_shaderQuit();
+  owl_shapesQuit();
+  owl_jobQuit();
+  owl_vfsQuit();
 
   if (app->texture) {
     GPU_FreeImage(app->texture);
@@ -156,6 +196,24 @@ u32 owl_getFPS(void) { return app->fps.rate; }
 
 u32 owl_wait(void) { return owl_frameRateWait(&app->fps); }
 
+bool owl_vsync(bool onoff) {
+  bool ok;
+
+  /* Adaptive sync first, a late frame then tears instead of stalling */
+  if (onoff)
+    ok = 0 == SDL_GL_SetSwapInterval(-1) || 0 == SDL_GL_SetSwapInterval(1);
+  else
+    ok = 0 == SDL_GL_SetSwapInterval(0);
+
+  owl_frameRateSync(&app->fps, SDL_GL_GetSwapInterval() != 0,
+                    owl_refreshRate());
+  return ok;
+}
+
+void owl_frameStats(owl_FrameStats *stats) { *stats = app->fps.stats; }
+
+void owl_resetFrameStats(void) { owl_frameRateReset(&app->fps); }
+
 owl_Canvas *owl_screen(void) { return app->texture; }
 
 owl_Canvas *owl_canvas(s32 width, s32 height) {
@@ -218,49 +276,237 @@ owl_Canvas *owl_imagex(const u8 *data, s32 w, s32 h, owl_Pixel colorkey) {
   return owl_fromSurface(surface, true);
 }
 
-owl_Canvas *owl_load(const char *filename) {
-  owl_Canvas *canvas;
-  s32 w, h, format;
-  u8 *data;
+/* Points at the mapped rows when stored raw, otherwise unpacks a copy */
+static const u8 *owl_texPixels(const owl_TexHeader *tex, const u8 *data,
+                               u8 **buffer) {
+  *buffer = NULL;
+
+  if (tex->codec == OWL_TEX_RAW)
+    return data + tex->offset;
+
+  *buffer = (u8 *)malloc(tex->size);
 
-  if (!filename)
+  if (!*buffer)
     return NULL;
 
-  data = stbi_load(filename, &w, &h, &format, 0);
+  if (owl_lzDecompress(data + tex->offset, (s32)tex->packed, *buffer,
+                       (s32)tex->size) != (s32)tex->size) {
+    free(*buffer);
+    *buffer = NULL;
+  }
+  return *buffer;
+}
 
-  if (!data)
+void owl_imageFlags(owl_Canvas *canvas, u16 flags) {
+  if (canvas && (flags & OWL_TEX_PREMULTIPLIED))
+    GPU_SetBlendMode(canvas, GPU_BLEND_PREMULTIPLIED_ALPHA);
+}
+
+/* Pixels come from a cache mapping on a hit, otherwise from stb_image */
+static const u8 *owl_decodePixels(const owl_File *file, s32 *w, s32 *h,
+                                  s32 *format, s32 channels,
+                                  owl_CacheEntry *entry, u8 **decoded) {
+  u32 params[4], variant = (u32)channels;
+  u64 key;
+
+  *decoded = NULL;
+  memset(entry, 0, sizeof(owl_CacheEntry));
+
+  if (file->size > INT_MAX)
+    return NULL;
+
+  key = owl_cacheKey(OWL_CACHE_IMAGE, &variant, 1, file->data, file->size);
+
+  if (owl_cacheFind(key, OWL_CACHE_IMAGE, entry)) {
+    *w = (s32)entry->params[0];
+    *h = (s32)entry->params[1];
+    *format = (s32)entry->params[2];
+
+    if (entry->size == (u32)(*w * *h * (channels ? channels : *format)))
+      return entry->data;
+
+    owl_cacheClose(entry);
+  }
+
+  *decoded = stbi_load_from_memory(file->data, (s32)file->size, w, h, format,
+                                   channels);
+
+  if (*decoded && key) {
+    params[0] = (u32)*w;
+    params[1] = (u32)*h;
+    params[2] = (u32)*format;
+    params[3] = 0;
+
+    owl_cacheStore(key, OWL_CACHE_IMAGE, params, *decoded,
+                   (u32)(*w * *h * (channels ? channels : *format)));
+  }
+  return *decoded;
+}
+
+u8 *owl_decodeImage(const char *filename, s32 *w, s32 *h, s32 *format,
+                    s32 channels, u16 *flags) {
+  const owl_TexHeader *tex;
+  const u8 *pixels;
+  owl_CacheEntry entry;
+  owl_File file;
+  u8 *data = NULL;
+
+  if (flags)
+    *flags = 0;
+
+  if (!owl_vfsOpen(&file, filename))
     return NULL;
 
-  canvas = owl_image(data, w, h, format);
-  stbi_image_free(data);
+  tex = owl_texHeader(file.data, file.size);
+
+  if (tex) {
+    pixels = owl_texPixels(tex, file.data, &data);
+
+    /* Callers release the result with stbi_image_free, which is free */
+    if (pixels && !data && (data = (u8 *)malloc(tex->size)))
+      memcpy(data, pixels, tex->size);
+
+    if (data) {
+      *w = (s32)tex->width;
+      *h = (s32)tex->height;
+      *format = OWL_FORMAT_RGBA;
+
+      if (flags)
+        *flags = tex->flags;
+    }
+  } else {
+    pixels = owl_decodePixels(&file, w, h, format, channels, &entry, &data);
+
+    if (pixels && !data && (data = (u8 *)malloc(entry.size)))
+      memcpy(data, pixels, entry.size);
+
+    owl_cacheClose(&entry);
+  }
+
+  owl_vfsClose(&file);
+  return data;
+}
+
+static owl_Canvas *owl_loadTex(const owl_TexHeader *tex, const u8 *data) {
+  owl_Canvas *canvas = NULL;
+  const u8 *pixels;
+  u8 *buffer;
+
+  pixels = owl_texPixels(tex, data, &buffer);
+
+  if (pixels)
+    canvas = GPU_CreateImage((u16)tex->width, (u16)tex->height,
+                             GPU_FORMAT_RGBA);
+
+  if (canvas) {
+    GPU_UpdateImageBytes(canvas, NULL, pixels, (s32)tex->width * 4);
+    GPU_SetBlendMode(canvas, GPU_BLEND_NORMAL);
+    GPU_SetBlending(canvas, true);
+    owl_imageFlags(canvas, tex->flags);
+  }
+
+  if (buffer)
+    free(buffer);
 
   return canvas;
 }
 
-owl_Canvas *owl_loadex(const char *filename, owl_Pixel colorkey) {
+/* Premultiplied texels cannot share a page that blends normally */
+static owl_Canvas *owl_loadTexAtlas(owl_Atlas *atlas, const owl_TexHeader *tex,
+                                    const u8 *data) {
+  owl_Canvas *canvas = NULL;
+  const u8 *pixels;
+  u8 *buffer;
+
+  if (tex->flags & OWL_TEX_PREMULTIPLIED)
+    return owl_loadTex(tex, data);
+
+  pixels = owl_texPixels(tex, data, &buffer);
+
+  if (pixels)
+    canvas = owl_atlasImage(atlas, pixels, (s32)tex->width,
+                            (s32)tex->height, OWL_FORMAT_RGBA);
+
+  if (buffer)
+    free(buffer);
+
+  return canvas;
+}
+
+owl_Canvas *owl_loadPixels(const u8 *pixels, s32 w, s32 h, s32 format,
+                           const owl_Pixel *colorkey, u16 flags) {
+  owl_Atlas *atlas = owl_atlasLoading();
+  bool keyed = colorkey && format == STBI_rgb;
   owl_Canvas *canvas;
+
+  /* Only RGB and RGBA go into a page, and only blending normally */
+  if (format != STBI_rgb && format != STBI_rgb_alpha)
+    atlas = NULL;
+
+  if (flags & OWL_TEX_PREMULTIPLIED)
+    atlas = NULL;
+
+  if (atlas)
+    return keyed ? owl_atlasImagex(atlas, pixels, w, h, *colorkey)
+                 : owl_atlasImage(atlas, pixels, w, h, (u8)format);
+
+  canvas = keyed ? owl_imagex(pixels, w, h, *colorkey)
+                 : owl_image(pixels, w, h, (u8)format);
+
+  owl_imageFlags(canvas, flags);
+  return canvas;
+}
+
+static owl_Canvas *owl_loadImage(const char *filename,
+                                 const owl_Pixel *colorkey) {
+  owl_Atlas *atlas = owl_atlasLoading();
+  const owl_TexHeader *tex;
+  owl_Canvas *canvas = NULL;
+  owl_CacheEntry entry;
+  owl_File file;
+  const u8 *pixels;
   s32 w, h, format;
   u8 *data;
 
-  if (!filename)
+  if (!filename || !owl_vfsOpen(&file, filename))
     return NULL;
 
-  data = stbi_load(filename, &w, &h, &format, 0);
+  tex = owl_texHeader(file.data, file.size);
 
-  if (!data)
-    return NULL;
+  /* Containers are already RGBA, so any colorkey was applied offline */
+  if (tex)
+    canvas = atlas ? owl_loadTexAtlas(atlas, tex, file.data)
+                   : owl_loadTex(tex, file.data);
+  else {
+    pixels = owl_decodePixels(&file, &w, &h, &format, 0, &entry, &data);
+
+    if (pixels)
+      canvas = owl_loadPixels(pixels, w, h, format, colorkey, 0);
 
-  canvas = (format == STBI_rgb) ? owl_imagex(data, w, h, colorkey)
-                                : owl_image(data, w, h, format);
-  stbi_image_free(data);
+    if (data)
+      stbi_image_free(data);
 
+    owl_cacheClose(&entry);
+  }
+
+  owl_vfsClose(&file);
   return canvas;
 }
 
+owl_Canvas *owl_load(const char *filename) {
+  return owl_loadImage(filename, NULL);
+}
+
+owl_Canvas *owl_loadex(const char *filename, owl_Pixel colorkey) {
+  return owl_loadImage(filename, &colorkey);
+}
+
 void owl_freeCanvas(owl_Canvas *canvas) {
   if (canvas == app->texture)
     return;
 
+  owl_atlasRelease(canvas);
+
   if (GPU_GetTarget(canvas) == app->target)
     owl_target(app->texture);
 
@@ -305,6 +551,9 @@ void owl_blendMode(owl_Canvas *canvas, s32 mode) {
 void owl_target(owl_Canvas *canvas) {
   GPU_Target *target;
 
+  if (owl_recordTarget(canvas))
+    return;
+
   if (!canvas)
     canvas = app->texture;
 
@@ -318,103 +567,226 @@ void owl_target(owl_Canvas *canvas) {
   }
 }
 
-void owl_thickness(f32 thickness) { GPU_SetLineThickness(thickness); }
+void owl_thickness(f32 thickness) {
+  if (owl_recordThickness(thickness))
+    return;
+
+  GPU_SetLineThickness(thickness);
+}
+
+void owl_color(owl_Pixel color) {
+  if (owl_recordColor(color))
+    return;
+
+  app->color = color;
+}
 
-void owl_color(owl_Pixel color) { app->color = color; }
+owl_Pixel owl_drawColor(void) { return app->color; }
 
 void owl_clear(void) {
   owl_Pixel color = app->color;
+
+  if (owl_recordShape(OWL_CMD_CLEAR, NULL, 0))
+    return;
+
   GPU_ClearRGBA(app->target, color.r, color.g, color.b, color.a);
 }
 
 void owl_pixel(f32 x, f32 y) {
+  f32 args[] = {x, y};
+
+  if (owl_recordShape(OWL_CMD_PIXEL, args, 2))
+    return;
+
   GPU_Pixel(app->target, x, y, OWL_COLOR);
 }
 
 void owl_line(f32 x1, f32 y1, f32 x2, f32 y2) {
+  f32 args[] = {x1, y1, x2, y2};
+
+  if (owl_recordShape(OWL_CMD_LINE, args, 4))
+    return;
+
   GPU_Line(app->target, x1, y1, x2, y2, OWL_COLOR);
 }
 
 void owl_rect(f32 x, f32 y, f32 w, f32 h) {
   GPU_Rect rect = {x, y, w, h};
+  f32 args[] = {x, y, w, h};
+
+  if (owl_recordShape(OWL_CMD_RECT, args, 4))
+    return;
+
   GPU_Rectangle2(app->target, rect, OWL_COLOR);
 }
 
 void owl_fillRect(f32 x, f32 y, f32 w, f32 h) {
   GPU_Rect rect = {x, y, w, h};
+  f32 args[] = {x, y, w, h};
+
+  if (owl_recordShape(OWL_CMD_FILLRECT, args, 4))
+    return;
+
   GPU_RectangleFilled2(app->target, rect, OWL_COLOR);
 }
 
 void owl_arc(f32 x, f32 y, f32 radius, f32 start_angle, f32 end_angle) {
+  f32 args[] = {x, y, radius, start_angle, end_angle};
+
+  if (owl_recordShape(OWL_CMD_ARC, args, 5))
+    return;
+
   GPU_Arc(app->target, x, y, radius, start_angle, end_angle, OWL_COLOR);
 }
 
 void owl_fillArc(f32 x, f32 y, f32 radius, f32 start_angle, f32 end_angle) {
+  f32 args[] = {x, y, radius, start_angle, end_angle};
+
+  if (owl_recordShape(OWL_CMD_FILLARC, args, 5))
+    return;
+
   GPU_ArcFilled(app->target, x, y, radius, start_angle, end_angle, OWL_COLOR);
 }
 
 void owl_circle(f32 x, f32 y, f32 radius) {
+  f32 args[] = {x, y, radius};
+
+  if (owl_recordShape(OWL_CMD_CIRCLE, args, 3))
+    return;
+
   GPU_Circle(app->target, x, y, radius, OWL_COLOR);
 }
 
 void owl_fillCircle(f32 x, f32 y, f32 radius) {
+  f32 args[] = {x, y, radius};
+
+  if (owl_recordShape(OWL_CMD_FILLCIRCLE, args, 3))
+    return;
+
   GPU_CircleFilled(app->target, x, y, radius, OWL_COLOR);
 }
 
 void owl_ellipse(f32 x, f32 y, f32 rx, f32 ry, f32 degrees) {
+  f32 args[] = {x, y, rx, ry, degrees};
+
+  if (owl_recordShape(OWL_CMD_ELLIPSE, args, 5))
+    return;
+
   GPU_Ellipse(app->target, x, y, rx, ry, degrees, OWL_COLOR);
 }
 
 void owl_fillEllipse(f32 x, f32 y, f32 rx, f32 ry, f32 degrees) {
+  f32 args[] = {x, y, rx, ry, degrees};
+
+  if (owl_recordShape(OWL_CMD_FILLELLIPSE, args, 5))
+    return;
+
   GPU_EllipseFilled(app->target, x, y, rx, ry, degrees, OWL_COLOR);
 }
 
 void owl_sector(f32 x, f32 y, f32 inner_radius, f32 outer_radius,
                 f32 start_angle, f32 end_angle) {
+  f32 args[] = {x, y, inner_radius, outer_radius, start_angle, end_angle};
+
+  if (owl_recordShape(OWL_CMD_SECTOR, args, 6))
+    return;
+
   GPU_Sector(app->target, x, y, inner_radius, outer_radius, start_angle,
              end_angle, OWL_COLOR);
 }
 
 void owl_fillSector(f32 x, f32 y, f32 inner_radius, f32 outer_radius,
                       f32 start_angle, f32 end_angle) {
+  f32 args[] = {x, y, inner_radius, outer_radius, start_angle, end_angle};
+
+  if (owl_recordShape(OWL_CMD_FILLSECTOR, args, 6))
+    return;
+
   GPU_SectorFilled(app->target, x, y, inner_radius, outer_radius, start_angle,
                    end_angle, OWL_COLOR);
 }
 
 void owl_trigon(f32 x1, f32 y1, f32 x2, f32 y2, f32 x3, f32 y3) {
+  f32 args[] = {x1, y1, x2, y2, x3, y3};
+
+  if (owl_recordShape(OWL_CMD_TRIGON, args, 6))
+    return;
+
   GPU_Tri(app->target, x1, y1, x2, y2, x3, y3, OWL_COLOR);
 }
 
 void owl_fillTrigon(f32 x1, f32 y1, f32 x2, f32 y2, f32 x3, f32 y3) {
+  f32 args[] = {x1, y1, x2, y2, x3, y3};
+
+  if (owl_recordShape(OWL_CMD_FILLTRIGON, args, 6))
+    return;
+
   GPU_TriFilled(app->target, x1, y1, x2, y2, x3, y3, OWL_COLOR);
 }
 
 void owl_rectRound(f32 x, f32 y, f32 w, f32 h, f32 radius) {
   GPU_Rect rect = {x, y, w, h};
+  f32 args[] = {x, y, w, h, radius};
+
+  if (owl_recordShape(OWL_CMD_RECTROUND, args, 5))
+    return;
+
   GPU_RectangleRound2(app->target, rect, radius, OWL_COLOR);
 }
 
 void owl_fillRectRound(f32 x, f32 y, f32 w, f32 h, f32 radius) {
   GPU_Rect rect = {x, y, w, h};
+  f32 args[] = {x, y, w, h, radius};
+
+  if (owl_recordShape(OWL_CMD_FILLRECTROUND, args, 5))
+    return;
+
   GPU_RectangleRoundFilled2(app->target, rect, radius, OWL_COLOR);
 }
 
 void owl_polygon(const owl_Point *points, s32 num_points, bool close) {
+  if (owl_recordPoints(OWL_CMD_POLYGON, points, num_points, close))
+    return;
+
   GPU_Polyline(app->target, num_points, (f32 *)points, OWL_COLOR, close);
 }
 
 void owl_fillPolygon(const owl_Point *points, s32 num_points) {
+  if (owl_recordPoints(OWL_CMD_FILLPOLYGON, points, num_points, false))
+    return;
+
   GPU_PolygonFilled(app->target, num_points, (f32 *)points, OWL_COLOR);
 }
 
 void owl_geometry(owl_Canvas *texture, s32 type, const owl_Vertex *vertices,
                   s32 num_vertices, const u16 *indices, s32 num_indices) {
+  owl_Rect region;
+  bool coverage;
+
+  if (owl_recordGeometry(texture, type, vertices, num_vertices, indices,
+                         num_indices))
+    return;
+
+  if (owl_atlasRegion(texture, &region))
+    vertices = owl_atlasVertices(texture, &region, vertices, num_vertices);
+
+  if (!vertices)
+    return;
+
+  coverage = owl_coverageBegin(texture);
+
   GPU_PrimitiveBatchV(texture, app->target, type, num_vertices,
                       (void *)vertices, num_indices, (u16 *)indices,
                       GPU_BATCH_XY_ST_RGBA8);
+
+  if (coverage)
+    owl_coverageEnd();
 }
 
 void owl_clip(const owl_Rect *rect) {
+  if (owl_recordClip(rect))
+    return;
+
   if (rect)
     GPU_SetClipRect(app->target, *(GPU_Rect *)rect);
   else
@@ -431,7 +803,12 @@ void owl_viewport(const owl_Rect *rect) {
 void owl_blit(owl_Canvas *canvas, const owl_Rect *srcrect,
               const owl_Rect *dstrect, f32 degrees, const owl_Point *center,
               u8 flip) {
+  owl_Rect region, subrect;
   f32 pivot_x, pivot_y;
+  bool coverage;
+
+  if (owl_recordBlit(canvas, srcrect, dstrect, degrees, center, flip))
+    return;
 
   if (center) {
     pivot_x = center->x;
@@ -441,11 +818,29 @@ void owl_blit(owl_Canvas *canvas, const owl_Rect *srcrect,
     pivot_y = (srcrect ? srcrect->h : canvas->h) * 0.5f;
   }
 
+  if (owl_atlasRegion(canvas, &region)) {
+    subrect.x = region.x + (srcrect ? srcrect->x : 0);
+    subrect.y = region.y + (srcrect ? srcrect->y : 0);
+    subrect.w = srcrect ? srcrect->w : region.w;
+    subrect.h = srcrect ? srcrect->h : region.h;
+    srcrect = &subrect;
+  }
+
+  coverage = owl_coverageBegin(canvas);
+
   GPU_BlitRectX(canvas, (GPU_Rect *)srcrect, app->target, (GPU_Rect *)dstrect,
                 degrees, pivot_x, pivot_y, flip);
+
+  if (coverage)
+    owl_coverageEnd();
 }
 
+GPU_Target *owl_renderTarget(void) { return app->target; }
+
 void owl_present(void) {
   GPU_BlitRect(app->texture, NULL, app->renderer, NULL);
   GPU_Flip(app->renderer);
+
+  /* Uploads land after the flip so they eat into next frame's slack */
+  owl_asyncUpdate();
 }
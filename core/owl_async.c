@@ -0,0 +1,283 @@
+/*
+ * owl_async.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "stb_image.h"
+
+#include "owl_async.h"
+#include "owl_font.h"
+#include "owl_job.h"
+#include "owl_render.h"
+#include "owl_sound.h"
+
+#define OWL_ASYNC_BUDGET (4 * 1024 * 1024)
+
+struct owl_Async {
+  u8 type;
+  s32 status;
+  bool released;
+  char *name;
+  char *filename;
+  owl_AsyncDone done;
+  void *ud;
+  void *asset;
+  u8 *pixels;
+  s32 w, h, format;
+  u16 flags;
+  owl_Canvas *canvas;
+  struct owl_Async *next;
+};
+
+typedef struct owl_AsyncQueue {
+  owl_Async *head;
+  owl_Async *tail;
+} owl_AsyncQueue;
+
+static SDL_mutex *lock = NULL;
+static SDL_atomic_t quit;
+static SDL_atomic_t decoding;
+
+/* Decoded requests waiting for upload */
+static owl_AsyncQueue ready = {NULL, NULL};
+
+static s32 pending = 0;
+static u32 budget = OWL_ASYNC_BUDGET;
+
+static void owl_asyncPush(owl_AsyncQueue *queue, owl_Async *async) {
+  async->next = NULL;
+
+  if (queue->tail)
+    queue->tail->next = async;
+  else
+    queue->head = async;
+
+  queue->tail = async;
+}
+
+static owl_Async *owl_asyncPop(owl_AsyncQueue *queue) {
+  owl_Async *async = queue->head;
+
+  if (async) {
+    queue->head = async->next;
+
+    if (!queue->head)
+      queue->tail = NULL;
+  }
+  return async;
+}
+
+static void owl_asyncDecode(owl_Async *async) {
+  switch (async->type) {
+  case OWL_ASSET_IMAGE:
+    async->pixels = owl_decodeImage(async->filename, &async->w, &async->h,
+                                    &async->format, 0, &async->flags);
+    break;
+  case OWL_ASSET_FONT:
+    async->asset = owl_fontDecode(async->filename);
+    break;
+  case OWL_ASSET_SOUND:
+    async->asset = owl_soundDecode(async->filename);
+    break;
+  }
+}
+
+static void owl_asyncDiscard(owl_Async *async) {
+  if (async->pixels) {
+    stbi_image_free(async->pixels);
+    async->pixels = NULL;
+  }
+
+  if (async->asset) {
+    if (async->type == OWL_ASSET_FONT)
+      owl_fontDiscard((owl_Face *)async->asset);
+    else
+      owl_soundDiscard((owl_Sound *)async->asset);
+
+    async->asset = NULL;
+  }
+}
+
+static void owl_asyncFree(owl_Async *async) {
+  if (async->name)
+    free(async->name);
+
+  free(async->filename);
+  free(async);
+}
+
+static void owl_asyncJob(owl_Job *job, void *ud) {
+  owl_Async *async = (owl_Async *)ud;
+
+  if (!SDL_AtomicGet(&quit))
+    owl_asyncDecode(async);
+
+  SDL_LockMutex(lock);
+  owl_asyncPush(&ready, async);
+  SDL_UnlockMutex(lock);
+
+  SDL_AtomicAdd(&decoding, -1);
+}
+
+static void owl_asyncFinish(owl_Async *async) {
+  bool ok = false;
+
+  pending -= 1;
+
+  if (async->released) {
+    owl_asyncDiscard(async);
+    owl_asyncFree(async);
+    return;
+  }
+
+  switch (async->type) {
+  case OWL_ASSET_IMAGE:
+    if (async->pixels) {
+      async->canvas = owl_loadPixels(async->pixels, async->w, async->h,
+                                     async->format, NULL, async->flags);
+    }
+
+    ok = async->canvas != NULL;
+    break;
+  case OWL_ASSET_FONT:
+    ok = async->asset && owl_fontAdd(async->name, (owl_Face *)async->asset);
+    async->asset = NULL;
+    break;
+  case OWL_ASSET_SOUND:
+    ok = async->asset && owl_soundAdd(async->name, (owl_Sound *)async->asset);
+    async->asset = NULL;
+    break;
+  }
+
+  owl_asyncDiscard(async);
+  async->status = ok ? OWL_ASYNC_DONE : OWL_ASYNC_FAILED;
+
+  /* The callback may free the request, so it is not touched afterwards */
+  if (async->done)
+    async->done(async, async->ud);
+}
+
+void owl_asyncUpdate(void) {
+  owl_Async *async;
+  u32 bytes, used = 0;
+
+  if (!lock)
+    return;
+
+  for (;;) {
+    SDL_LockMutex(lock);
+    async = ready.head;
+
+    if (async) {
+      bytes = async->pixels ? (u32)(async->w * async->h * 4) : 0;
+
+      /* At least one upload a frame, so a huge image cannot stall */
+      if (budget > 0 && used > 0 && used + bytes > budget)
+        async = NULL;
+      else
+        owl_asyncPop(&ready);
+    }
+
+    SDL_UnlockMutex(lock);
+
+    if (!async)
+      break;
+
+    used += bytes;
+    owl_asyncFinish(async);
+  }
+}
+
+void owl_asyncQuit(void) {
+  owl_Async *async;
+
+  /* Requests not yet decoded skip the work and come straight back */
+  SDL_AtomicSet(&quit, 1);
+
+  while (SDL_AtomicGet(&decoding) > 0)
+    if (!owl_jobHelp())
+      SDL_Delay(1);
+
+  SDL_AtomicSet(&quit, 0);
+
+  while ((async = owl_asyncPop(&ready))) {
+    owl_asyncDiscard(async);
+    owl_asyncFree(async);
+  }
+
+  if (lock) {
+    SDL_DestroyMutex(lock);
+    lock = NULL;
+  }
+
+  pending = 0;
+}
+
+owl_Async *owl_loadAsync(u8 type, const char *name, const char *filename,
+                         owl_AsyncDone done, void *ud) {
+  owl_Async *async;
+
+  if (!filename || type > OWL_ASSET_SOUND)
+    return NULL;
+
+  if (type != OWL_ASSET_IMAGE && !name)
+    return NULL;
+
+  if (!lock && !(lock = SDL_CreateMutex()))
+    return NULL;
+
+  async = (owl_Async *)calloc(1, sizeof(owl_Async));
+
+  if (!async)
+    return NULL;
+
+  async->type = type;
+  async->status = OWL_ASYNC_PENDING;
+  async->name = name ? strdup(name) : NULL;
+  async->filename = strdup(filename);
+  async->done = done;
+  async->ud = ud;
+
+  if (!async->filename || (name && !async->name)) {
+    owl_asyncFree(async);
+    return NULL;
+  }
+
+  pending += 1;
+  SDL_AtomicIncRef(&decoding);
+
+  owl_job(owl_asyncJob, async, NULL, NULL);
+
+  return async;
+}
+
+s32 owl_asyncStatus(owl_Async *async) { return async->status; }
+
+owl_Canvas *owl_asyncCanvas(owl_Async *async) { return async->canvas; }
+
+void owl_freeAsync(owl_Async *async) {
+  if (!async)
+    return;
+
+  /* Still in flight: the result is dropped once it comes back */
+  if (async->status == OWL_ASYNC_PENDING) {
+    async->released = true;
+    return;
+  }
+
+  owl_asyncFree(async);
+}
+
+s32 owl_asyncPending(void) { return pending; }
+
+void owl_uploadBudget(u32 bytes) { budget = bytes; }
@@ -0,0 +1,28 @@
+/*
+ * owl_async.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_ASYNC_H__
+#define __OWL_ASYNC_H__
+
+#include "owl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void owl_asyncUpdate(void);
+extern void owl_asyncQuit(void);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_ASYNC_H__ */
@@ -0,0 +1,752 @@
+/*
+ * owl_atlas.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL_gpu.h"
+#include "stb_image.h"
+
+#include "owl_atlas.h"
+#include "owl_io.h"
+#include "owl_render.h"
+#include "owl_table.h"
+#include "owl_vfs.h"
+
+#define OWL_ATLAS_NAME 64
+#define OWL_ATLAS_PATH 260
+
+typedef struct owl_Region {
+  owl_Atlas *atlas;
+  owl_Canvas *page;
+  owl_Canvas *canvas;
+  owl_Rect rect, slot;
+  char name[OWL_ATLAS_NAME];
+  struct owl_Region *next;
+} owl_Region;
+
+typedef struct owl_AtlasPage {
+  owl_Canvas *image;
+  owl_Skyline sky;
+} owl_AtlasPage;
+
+struct owl_Atlas {
+  s32 width, height;
+  s32 padding;
+  s32 num_pages;
+  owl_AtlasPage *pages;
+  owl_Region *regions;
+  owl_Table *names;
+  struct owl_Atlas *next;
+};
+
+typedef struct owl_AtlasEntry {
+  char name[OWL_ATLAS_NAME];
+  u8 *data;
+  s32 w, h, format;
+  bool keyed;
+  owl_Pixel colorkey;
+} owl_AtlasEntry;
+
+static owl_Table *regions = NULL;
+static owl_Atlas *atlases = NULL;
+static owl_Atlas *loading = NULL;
+static owl_Vertex *scratch = NULL;
+static s32 scratch_size = 0;
+
+static void owl_freeRegion(owl_Region *region) {
+  if (region->canvas) {
+    owl_iDelTable(regions, (u64)(uword_t)region->canvas);
+    GPU_FreeImage(region->canvas);
+  }
+  free(region);
+}
+
+/* A given image was packed offline, so its page takes nothing more */
+static owl_AtlasPage *owl_atlasPage(owl_Atlas *atlas, owl_Canvas *image) {
+  owl_AtlasPage *pages, *page;
+  s32 w = image ? image->w : atlas->width;
+  s32 h = image ? image->h : atlas->height;
+
+  pages = (owl_AtlasPage *)realloc(
+      atlas->pages, (atlas->num_pages + 1) * sizeof(owl_AtlasPage));
+
+  if (!pages)
+    return NULL;
+
+  atlas->pages = pages;
+  page = &pages[atlas->num_pages];
+
+  page->image = image ? image : GPU_CreateImage(w, h, GPU_FORMAT_RGBA);
+
+  if (!page->image)
+    return NULL;
+
+  if (!owl_skyline(&page->sky, w, h)) {
+    if (!image)
+      GPU_FreeImage(page->image);
+    return NULL;
+  }
+
+  if (image)
+    page->sky.nodes[0].y = h;
+
+  GPU_SetBlendMode(page->image, GPU_BLEND_NORMAL);
+  GPU_SetBlending(page->image, true);
+
+  atlas->num_pages += 1;
+  return page;
+}
+
+static u8 *owl_extrude(const u8 *data, s32 w, s32 h, s32 format,
+                       const owl_Pixel *colorkey, s32 padding) {
+  s32 pw = w + padding * 2, ph = h + padding * 2;
+  s32 x, y, sx, sy;
+  const u8 *s;
+  u8 *pixels, *p;
+
+  pixels = (u8 *)malloc(pw * ph * 4);
+
+  if (!pixels)
+    return NULL;
+
+  p = pixels;
+
+  /* Border texels repeat the edge so filtering never samples a neighbour */
+  for (y = 0; y < ph; ++y) {
+    sy = y - padding;
+    sy = sy < 0 ? 0 : (sy >= h ? h - 1 : sy);
+
+    for (x = 0; x < pw; ++x) {
+      sx = x - padding;
+      sx = sx < 0 ? 0 : (sx >= w ? w - 1 : sx);
+
+      s = data + (sy * w + sx) * format;
+
+      p[0] = s[0];
+      p[1] = s[1];
+      p[2] = s[2];
+
+      if (format == OWL_FORMAT_RGBA)
+        p[3] = s[3];
+      else if (colorkey && s[0] == colorkey->r && s[1] == colorkey->g &&
+               s[2] == colorkey->b)
+        p[3] = 0;
+      else
+        p[3] = 0xFF;
+
+      p += 4;
+    }
+  }
+  return pixels;
+}
+
+/* The slot is the rect with its extruded border, what a free gives back */
+static owl_Canvas *owl_atlasTrack(owl_Atlas *atlas, owl_Canvas *page,
+                                  owl_Canvas *canvas, s32 x, s32 y, s32 w,
+                                  s32 h, s32 pad) {
+  owl_Region *region;
+
+  if (!canvas)
+    return NULL;
+
+  region = (owl_Region *)calloc(1, sizeof(owl_Region));
+
+  if (!region) {
+    GPU_FreeImage(canvas);
+    return NULL;
+  }
+
+  if (canvas != page) {
+    canvas->w = (u16)w;
+    canvas->h = (u16)h;
+  }
+
+  region->atlas = atlas;
+  region->page = page;
+  region->canvas = canvas;
+  region->rect.x = (f32)x;
+  region->rect.y = (f32)y;
+  region->rect.w = (f32)w;
+  region->rect.h = (f32)h;
+  region->slot.x = (f32)(x - pad);
+  region->slot.y = (f32)(y - pad);
+  region->slot.w = (f32)(w + pad * 2);
+  region->slot.h = (f32)(h + pad * 2);
+
+  region->next = atlas->regions;
+  atlas->regions = region;
+
+  owl_iSetTable(regions, (u64)(uword_t)canvas, region);
+  return canvas;
+}
+
+static void owl_atlasName(owl_Atlas *atlas, const char *name,
+                          owl_Canvas *canvas) {
+  owl_Region *region = (owl_Region *)owl_iGetTable(regions,
+                                                   (u64)(uword_t)canvas);
+
+  if (region)
+    snprintf(region->name, OWL_ATLAS_NAME, "%s", name);
+
+  owl_setTable(atlas->names, name, canvas);
+}
+
+static bool owl_atlasVacancy(owl_Atlas *atlas, owl_Canvas *page, f32 x,
+                             f32 y, f32 w, f32 h) {
+  owl_Region *region;
+
+  if (w <= 0 || h <= 0)
+    return true;
+
+  region = (owl_Region *)calloc(1, sizeof(owl_Region));
+
+  if (!region)
+    return false;
+
+  region->atlas = atlas;
+  region->page = page;
+  region->slot.x = x;
+  region->slot.y = y;
+  region->slot.w = w;
+  region->slot.h = h;
+
+  region->next = atlas->regions;
+  atlas->regions = region;
+  return true;
+}
+
+/* Best fit among freed slots, the rest is split off as two smaller ones */
+static owl_Canvas *owl_atlasReuse(owl_Atlas *atlas, s32 w, s32 h, s32 *x,
+                                  s32 *y) {
+  owl_Region **pp, **best = NULL, *region;
+  owl_Canvas *page;
+  owl_Rect slot;
+
+  for (pp = &atlas->regions; *pp; pp = &(*pp)->next) {
+    region = *pp;
+
+    if (region->canvas || region->slot.w < w || region->slot.h < h)
+      continue;
+
+    if (!best ||
+        region->slot.w * region->slot.h < (*best)->slot.w * (*best)->slot.h)
+      best = pp;
+  }
+
+  if (!best)
+    return NULL;
+
+  region = *best;
+  *best = region->next;
+
+  page = region->page;
+  slot = region->slot;
+  free(region);
+
+  *x = (s32)slot.x;
+  *y = (s32)slot.y;
+
+  /* Losing a remainder only leaves it unused until the page empties */
+  owl_atlasVacancy(atlas, page, slot.x + w, slot.y, slot.w - w, (f32)h);
+  owl_atlasVacancy(atlas, page, slot.x, slot.y + h, slot.w, slot.h - h);
+
+  return page;
+}
+
+/* Once nothing on a page is alive, its skyline starts over */
+static void owl_atlasVacate(owl_Atlas *atlas, owl_Canvas *page) {
+  owl_Region **pp = &atlas->regions, *region;
+  s32 i;
+
+  for (region = atlas->regions; region; region = region->next)
+    if (region->page == page && region->canvas)
+      return;
+
+  for (i = 0; i < atlas->num_pages; ++i)
+    if (atlas->pages[i].image == page)
+      break;
+
+  if (i == atlas->num_pages)
+    return;
+
+  while ((region = *pp)) {
+    if (region->page == page) {
+      *pp = region->next;
+      free(region);
+    } else
+      pp = &region->next;
+  }
+
+  owl_resetSkyline(&atlas->pages[i].sky);
+}
+
+static owl_Canvas *owl_atlasAdd(owl_Atlas *atlas, const u8 *data, s32 w,
+                                s32 h, s32 format, const owl_Pixel *colorkey) {
+  s32 pad = atlas->padding;
+  s32 i, x = 0, y = 0;
+  owl_AtlasPage *page;
+  owl_Canvas *image, *canvas;
+  GPU_Rect rect;
+  u8 *pixels;
+
+  if (!data || w <= 0 || h <= 0)
+    return NULL;
+
+  if (format != OWL_FORMAT_RGB)
+    colorkey = NULL;
+
+  /* Oversized images get a texture of their own but stay owned by the atlas */
+  if (w + pad * 2 > atlas->width || h + pad * 2 > atlas->height) {
+    canvas = colorkey ? owl_imagex(data, w, h, *colorkey)
+                      : owl_image(data, w, h, (u8)format);
+    return owl_atlasTrack(atlas, canvas, canvas, 0, 0, w, h, 0);
+  }
+
+  image = owl_atlasReuse(atlas, w + pad * 2, h + pad * 2, &x, &y);
+
+  for (i = 0; !image && i < atlas->num_pages; ++i)
+    if (owl_skylinePack(&atlas->pages[i].sky, w + pad * 2, h + pad * 2, &x,
+                        &y))
+      image = atlas->pages[i].image;
+
+  if (!image) {
+    page = owl_atlasPage(atlas, NULL);
+
+    if (!page)
+      return NULL;
+
+    if (!owl_skylinePack(&page->sky, w + pad * 2, h + pad * 2, &x, &y))
+      return NULL;
+
+    image = page->image;
+  }
+
+  pixels = owl_extrude(data, w, h, format, colorkey, pad);
+
+  if (!pixels)
+    return NULL;
+
+  rect.x = (f32)x;
+  rect.y = (f32)y;
+  rect.w = (f32)(w + pad * 2);
+  rect.h = (f32)(h + pad * 2);
+
+  GPU_UpdateImageBytes(image, &rect, pixels, (w + pad * 2) * 4);
+  free(pixels);
+
+  canvas = GPU_CreateAliasImage(image);
+  return owl_atlasTrack(atlas, image, canvas, x + pad, y + pad, w, h, pad);
+}
+
+static u8 *owl_atlasDecode(const char *filename, s32 *w, s32 *h, s32 *format) {
+  u8 *data = owl_decodeImage(filename, w, h, format, 0, NULL);
+
+  if (data && *format != STBI_rgb && *format != STBI_rgb_alpha) {
+    stbi_image_free(data);
+    data = owl_decodeImage(filename, w, h, format, STBI_rgb_alpha, NULL);
+    *format = STBI_rgb_alpha;
+  }
+  return data;
+}
+
+static s32 owl_atlasCompare(const void *a, const void *b) {
+  const owl_AtlasEntry *l = (const owl_AtlasEntry *)a;
+  const owl_AtlasEntry *r = (const owl_AtlasEntry *)b;
+
+  if (l->h != r->h)
+    return r->h - l->h;
+
+  return r->w - l->w;
+}
+
+static s32 owl_atlasParse(const char *manifest, char *text,
+                          owl_AtlasEntry *entries) {
+  char dir[OWL_ATLAS_PATH], file[OWL_ATLAS_PATH], path[OWL_ATLAS_PATH * 2];
+  char *line = text, *next;
+  u32 key;
+  s32 n, count = 0;
+
+  owl_dirName(dir, manifest);
+
+  while (line && *line) {
+    next = strchr(line, '\n');
+
+    if (next)
+      *next++ = '\0';
+
+    n = sscanf(line, "%63s %259s %x", entries[count].name, file, &key);
+
+    if (n >= 2 && entries[count].name[0] != '#') {
+      if (owl_pathType(file) == OWL_PATHTYPE_ABSOLUTE)
+        snprintf(path, sizeof(path), "%s", file);
+      else
+        snprintf(path, sizeof(path), "%s/%s", dir, file);
+
+      entries[count].data = owl_atlasDecode(path, &entries[count].w,
+                                            &entries[count].h,
+                                            &entries[count].format);
+      entries[count].keyed = (n == 3);
+      entries[count].colorkey =
+          owl_rgb((u8)(key >> 16), (u8)(key >> 8), (u8)key);
+
+      if (entries[count].data)
+        count += 1;
+    }
+    line = next;
+  }
+  return count;
+}
+
+static owl_Canvas *owl_atlasPageLoad(owl_Atlas *atlas, const char *dir,
+                                     const char *file) {
+  char path[OWL_ATLAS_PATH * 2];
+  owl_Atlas *saved = loading;
+  owl_AtlasPage *page;
+  owl_Canvas *image;
+
+  if (owl_pathType(file) == OWL_PATHTYPE_ABSOLUTE)
+    snprintf(path, sizeof(path), "%s", file);
+  else
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+
+  /* A page is a texture of its own, even while owl_load packs */
+  loading = NULL;
+  image = owl_load(path);
+  loading = saved;
+
+  if (!image)
+    return NULL;
+
+  page = owl_atlasPage(atlas, image);
+
+  if (!page) {
+    GPU_FreeImage(image);
+    return NULL;
+  }
+  return image;
+}
+
+/* Pages and rectangles come from the manifest, nothing is packed here */
+static s32 owl_atlasPacked(owl_Atlas *atlas, const char *manifest,
+                           char *text, s32 lines) {
+  char dir[OWL_ATLAS_PATH], file[OWL_ATLAS_PATH], name[OWL_ATLAS_NAME];
+  char *line = text, *next;
+  owl_Canvas **pages, *canvas;
+  s32 n, index, x, y, w, h, num_pages = 0, built = 0;
+
+  pages = (owl_Canvas **)calloc(lines, sizeof(owl_Canvas *));
+
+  if (!pages)
+    return -1;
+
+  owl_dirName(dir, manifest);
+
+  while (line && *line) {
+    next = strchr(line, '\n');
+
+    if (next)
+      *next++ = '\0';
+
+    if (1 == sscanf(line, "page %259s", file)) {
+      pages[num_pages++] = owl_atlasPageLoad(atlas, dir, file);
+    } else {
+      n = sscanf(line, "%63s %d %d %d %d %d", name, &index, &x, &y, &w, &h);
+
+      /* A stale manifest must not reach outside its page */
+      if (n == 6 && name[0] != '#' && index >= 0 && index < num_pages &&
+          pages[index] && w > 0 && h > 0 && x >= 0 && y >= 0 &&
+          x <= pages[index]->w - w && y <= pages[index]->h - h) {
+        canvas = owl_atlasTrack(atlas, pages[index],
+                                GPU_CreateAliasImage(pages[index]), x, y, w,
+                                h, 0);
+
+        if (canvas) {
+          owl_atlasName(atlas, name, canvas);
+          built += 1;
+        }
+      }
+    }
+    line = next;
+  }
+
+  free(pages);
+  return built;
+}
+
+bool owl_atlasInit(void) {
+  if (!regions)
+    regions = owl_table();
+  return regions != NULL;
+}
+
+void owl_atlasQuit(void) {
+  while (atlases)
+    owl_freeAtlas(atlases);
+
+  if (regions) {
+    owl_freeTable(regions, NULL);
+    regions = NULL;
+  }
+
+  if (scratch) {
+    free(scratch);
+    scratch = NULL;
+    scratch_size = 0;
+  }
+}
+
+owl_Canvas *owl_atlasRegion(owl_Canvas *canvas, owl_Rect *rect) {
+  owl_Region *region;
+
+  if (!canvas || !canvas->is_alias || !regions)
+    return NULL;
+
+  region = (owl_Region *)owl_iGetTable(regions, (u64)(uword_t)canvas);
+
+  if (!region || region->page == canvas)
+    return NULL;
+
+  if (rect)
+    *rect = region->rect;
+
+  return region->page;
+}
+
+const owl_Vertex *owl_atlasVertices(owl_Canvas *canvas, const owl_Rect *rect,
+                                    const owl_Vertex *vertices,
+                                    s32 num_vertices) {
+  f32 tw = canvas->texture_w, th = canvas->texture_h;
+  owl_Vertex *v;
+  s32 i;
+
+  if (num_vertices > scratch_size) {
+    v = (owl_Vertex *)realloc(scratch, num_vertices * sizeof(owl_Vertex));
+
+    if (!v)
+      return NULL;
+
+    scratch = v;
+    scratch_size = num_vertices;
+  }
+
+  for (i = 0; i < num_vertices; ++i) {
+    scratch[i] = vertices[i];
+    scratch[i].uv.x = (rect->x + vertices[i].uv.x * rect->w) / tw;
+    scratch[i].uv.y = (rect->y + vertices[i].uv.y * rect->h) / th;
+  }
+  return scratch;
+}
+
+void owl_atlasRelease(owl_Canvas *canvas) {
+  owl_Region **pp, *region;
+  owl_Atlas *atlas;
+
+  if (!canvas || !regions)
+    return;
+
+  region = (owl_Region *)owl_iGetTable(regions, (u64)(uword_t)canvas);
+
+  if (!region)
+    return;
+
+  owl_iDelTable(regions, (u64)(uword_t)canvas);
+  atlas = region->atlas;
+
+  if (region->name[0] && canvas == owl_getTable(atlas->names, region->name))
+    owl_setTable(atlas->names, region->name, NULL);
+
+  region->canvas = NULL;
+  region->name[0] = '\0';
+
+  /* A texture of its own goes away with it, packed space is kept for reuse */
+  if (region->page == canvas) {
+    for (pp = &atlas->regions; *pp != region; pp = &(*pp)->next)
+      ;
+    *pp = region->next;
+    free(region);
+    return;
+  }
+
+  owl_atlasVacate(atlas, region->page);
+}
+
+owl_Atlas *owl_atlas(s32 width, s32 height, s32 padding) {
+  owl_Atlas *atlas = (owl_Atlas *)calloc(1, sizeof(owl_Atlas));
+
+  if (!atlas)
+    return NULL;
+
+  atlas->names = owl_table();
+
+  if (!atlas->names) {
+    free(atlas);
+    return NULL;
+  }
+
+  atlas->width = width > 0 ? width : OWL_ATLAS_WIDTH;
+  atlas->height = height > 0 ? height : OWL_ATLAS_HEIGHT;
+  atlas->padding = padding > 0 ? padding : 0;
+
+  atlas->next = atlases;
+  atlases = atlas;
+
+  return atlas;
+}
+
+void owl_freeAtlas(owl_Atlas *atlas) {
+  owl_Atlas **pp = &atlases;
+  owl_Region *region;
+  s32 i;
+
+  if (!atlas)
+    return;
+
+  while (*pp && *pp != atlas)
+    pp = &(*pp)->next;
+
+  if (*pp)
+    *pp = atlas->next;
+
+  if (loading == atlas)
+    loading = NULL;
+
+  while (atlas->regions) {
+    region = atlas->regions;
+    atlas->regions = region->next;
+    owl_freeRegion(region);
+  }
+
+  for (i = 0; i < atlas->num_pages; ++i) {
+    GPU_FreeImage(atlas->pages[i].image);
+    owl_freeSkyline(&atlas->pages[i].sky);
+  }
+
+  if (atlas->pages)
+    free(atlas->pages);
+
+  owl_freeTable(atlas->names, NULL);
+  free(atlas);
+}
+
+owl_Canvas *owl_atlasImage(owl_Atlas *atlas, const u8 *data, s32 w, s32 h,
+                           u8 format) {
+  return owl_atlasAdd(atlas, data, w, h, format, NULL);
+}
+
+owl_Canvas *owl_atlasImagex(owl_Atlas *atlas, const u8 *data, s32 w, s32 h,
+                            owl_Pixel colorkey) {
+  return owl_atlasAdd(atlas, data, w, h, OWL_FORMAT_RGB, &colorkey);
+}
+
+owl_Canvas *owl_atlasLoad(owl_Atlas *atlas, const char *filename) {
+  owl_Canvas *canvas;
+  s32 w, h, format;
+  u8 *data;
+
+  if (!filename)
+    return NULL;
+
+  data = owl_atlasDecode(filename, &w, &h, &format);
+
+  if (!data)
+    return NULL;
+
+  canvas = owl_atlasAdd(atlas, data, w, h, format, NULL);
+  stbi_image_free(data);
+
+  return canvas;
+}
+
+owl_Canvas *owl_atlasLoadex(owl_Atlas *atlas, const char *filename,
+                            owl_Pixel colorkey) {
+  owl_Canvas *canvas;
+  s32 w, h, format;
+  u8 *data;
+
+  if (!filename)
+    return NULL;
+
+  data = owl_atlasDecode(filename, &w, &h, &format);
+
+  if (!data)
+    return NULL;
+
+  canvas = owl_atlasAdd(atlas, data, w, h, format, &colorkey);
+  stbi_image_free(data);
+
+  return canvas;
+}
+
+s32 owl_atlasBuild(owl_Atlas *atlas, const char *manifest) {
+  owl_AtlasEntry *entries;
+  owl_Canvas *canvas;
+  s32 i, lines = 1, count, built = 0;
+  char *text, *p;
+
+  if (!manifest)
+    return -1;
+
+  text = (char *)owl_vfsRead(manifest);
+
+  if (!text)
+    return -1;
+
+  for (p = text; *p; ++p)
+    if (*p == '\n')
+      lines += 1;
+
+  if (0 == strncmp(text, OWL_ATLAS_PACKED, strlen(OWL_ATLAS_PACKED))) {
+    built = owl_atlasPacked(atlas, manifest, text, lines);
+    free(text);
+    return built;
+  }
+
+  entries = (owl_AtlasEntry *)calloc(lines, sizeof(owl_AtlasEntry));
+
+  if (!entries) {
+    free(text);
+    return -1;
+  }
+
+  count = owl_atlasParse(manifest, text, entries);
+  free(text);
+
+  /* Every size is known up front, so pack tallest first for denser pages */
+  qsort(entries, count, sizeof(owl_AtlasEntry), owl_atlasCompare);
+
+  for (i = 0; i < count; ++i) {
+    canvas = owl_atlasAdd(atlas, entries[i].data, entries[i].w, entries[i].h,
+                          entries[i].format,
+                          entries[i].keyed ? &entries[i].colorkey : NULL);
+    stbi_image_free(entries[i].data);
+
+    if (!canvas)
+      continue;
+
+    owl_atlasName(atlas, entries[i].name, canvas);
+    built += 1;
+  }
+
+  free(entries);
+  return built;
+}
+
+void owl_loadAtlas(owl_Atlas *atlas) { loading = atlas; }
+
+owl_Atlas *owl_atlasLoading(void) { return loading; }
+
+owl_Canvas *owl_atlasGet(owl_Atlas *atlas, const char *name) {
+  return (owl_Canvas *)owl_getTable(atlas->names, name);
+}
+
+s32 owl_atlasPages(owl_Atlas *atlas) { return atlas->num_pages; }
@@ -0,0 +1,49 @@
+/*
+ * owl_atlas.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_ATLAS_H__
+#define __OWL_ATLAS_H__
+
+#include "owl.h"
+#include "owl_skyline.h"
+
+#define OWL_ATLAS_WIDTH 2048
+#define OWL_ATLAS_HEIGHT 2048
+
+/*
+ * A manifest packed by owlatlas starts with this tag. Each "page <file>"
+ * line names a page texture, and every other line places an image as
+ * "<name> <page> <x> <y> <w> <h>", counting pages from 0.
+ */
+#define OWL_ATLAS_PACKED "#owlatlas"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern bool owl_atlasInit(void);
+extern void owl_atlasQuit(void);
+
+extern owl_Canvas *owl_atlasRegion(owl_Canvas *canvas, owl_Rect *rect);
+extern const owl_Vertex *owl_atlasVertices(owl_Canvas *canvas,
+                                           const owl_Rect *rect,
+                                           const owl_Vertex *vertices,
+                                           s32 num_vertices);
+extern void owl_atlasRelease(owl_Canvas *canvas);
+
+/* The atlas owl_load packs into, or NULL for textures of their own */
+extern owl_Atlas *owl_atlasLoading(void);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_ATLAS_H__ */
@@ -0,0 +1,292 @@
+/*
+ * owl_batch.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "owl_atlas.h"
+#include "owl_batch.h"
+#include "owl_command.h"
+#include "owl_render.h"
+#include "owl_shader.h"
+
+struct owl_SpriteBatch {
+  owl_Vertex *vertices;
+  u16 *indices;
+  s32 capacity;
+  s32 count;
+  GPU_Target *target;
+  owl_Canvas *source;
+  owl_Canvas *texture;
+  GPU_bool blending;
+  GPU_BlendMode blend;
+};
+
+static bool owl_batchSameRun(owl_SpriteBatch *batch, GPU_Target *target,
+                             owl_Canvas *source, owl_Canvas *texture) {
+  if (batch->count == 0)
+    return false;
+
+  if (batch->target != target || batch->source != source)
+    return false;
+
+  if (batch->blending != texture->use_blending)
+    return false;
+
+  return 0 ==
+         memcmp(&batch->blend, &texture->blend_mode, sizeof(GPU_BlendMode));
+}
+
+static void owl_batchFlush(owl_SpriteBatch *batch) {
+  bool coverage;
+
+  if (batch->count == 0)
+    return;
+
+  /* The coordinates are in the source already, so record against it */
+  if (owl_recordGeometry(batch->source, OWL_GEOMETRY_TRIANGLES,
+                         batch->vertices, batch->count * 4, batch->indices,
+                         batch->count * 6)) {
+    batch->count = 0;
+    return;
+  }
+
+  coverage = owl_coverageBegin(batch->source);
+
+  GPU_PrimitiveBatchV(batch->texture, batch->target, GPU_TRIANGLES,
+                      (u16)(batch->count * 4), batch->vertices,
+                      batch->count * 6, batch->indices, GPU_BATCH_XY_ST_RGBA8);
+
+  if (coverage)
+    owl_coverageEnd();
+
+  batch->count = 0;
+}
+
+static owl_Vertex *owl_batchQuad(owl_SpriteBatch *batch, owl_Canvas *source,
+                                 owl_Canvas *texture) {
+  GPU_Target *target = owl_recording() ? NULL : owl_renderTarget();
+
+  /* Atlas regions share their page texture, so they batch together */
+  if (!owl_batchSameRun(batch, target, source, texture) ||
+      batch->count >= batch->capacity) {
+    owl_batchFlush(batch);
+
+    batch->target = target;
+    batch->source = source;
+    batch->texture = texture;
+    batch->blending = texture->use_blending;
+    batch->blend = texture->blend_mode;
+  }
+
+  return batch->vertices + (batch->count++) * 4;
+}
+
+owl_SpriteBatch *owl_spriteBatch(s32 capacity) {
+  owl_SpriteBatch *batch;
+  s32 i;
+
+  if (capacity <= 0)
+    capacity = OWL_BATCH_DEFAULT;
+
+  if (capacity > OWL_BATCH_LIMIT)
+    capacity = OWL_BATCH_LIMIT;
+
+  batch = (owl_SpriteBatch *)calloc(1, sizeof(owl_SpriteBatch));
+
+  if (!batch)
+    return NULL;
+
+  batch->vertices = (owl_Vertex *)malloc(capacity * 4 * sizeof(owl_Vertex));
+  batch->indices = (u16 *)malloc(capacity * 6 * sizeof(u16));
+
+  if (!batch->vertices || !batch->indices) {
+    owl_freeSpriteBatch(batch);
+    return NULL;
+  }
+
+  /* Two triangles per quad: (tl, tr, bl) and (bl, tr, br) */
+  for (i = 0; i < capacity; ++i) {
+    batch->indices[i * 6 + 0] = (u16)(i * 4 + 0);
+    batch->indices[i * 6 + 1] = (u16)(i * 4 + 1);
+    batch->indices[i * 6 + 2] = (u16)(i * 4 + 2);
+    batch->indices[i * 6 + 3] = (u16)(i * 4 + 2);
+    batch->indices[i * 6 + 4] = (u16)(i * 4 + 1);
+    batch->indices[i * 6 + 5] = (u16)(i * 4 + 3);
+  }
+
+  batch->capacity = capacity;
+  return batch;
+}
+
+void owl_freeSpriteBatch(owl_SpriteBatch *batch) {
+  if (!batch)
+    return;
+
+  if (batch->vertices)
+    free(batch->vertices);
+
+  if (batch->indices)
+    free(batch->indices);
+
+  free(batch);
+}
+
+void owl_batchBegin(owl_SpriteBatch *batch) {
+  batch->count = 0;
+  batch->target = NULL;
+  batch->source = NULL;
+  batch->texture = NULL;
+}
+
+void owl_batchDraw(owl_SpriteBatch *batch, owl_Canvas *canvas,
+                   const owl_Rect *srcrect, const owl_Rect *dstrect,
+                   f32 degrees, const owl_Point *center, u8 flip) {
+  owl_Canvas *source;
+  owl_Rect region;
+  owl_Vertex *quad;
+  owl_Pixel color;
+  f32 sx, sy, sw, sh, dx, dy, dw, dh;
+  f32 pivot_x, pivot_y, scale_x, scale_y, cosa, sina;
+  f32 s1, t1, s2, t2, x1, y1, x2, y2, px, py;
+  s32 i;
+
+  if (!canvas)
+    return;
+
+  if (srcrect) {
+    sx = srcrect->x, sy = srcrect->y;
+    sw = srcrect->w, sh = srcrect->h;
+  } else {
+    sx = 0, sy = 0;
+    sw = canvas->w, sh = canvas->h;
+  }
+
+  /* Nothing to sample, and the scale below would divide by zero */
+  if (sw <= 0 || sh <= 0)
+    return;
+
+  source = owl_atlasRegion(canvas, &region);
+
+  if (source) {
+    sx += region.x;
+    sy += region.y;
+  } else
+    source = canvas;
+
+  if (dstrect) {
+    dx = dstrect->x, dy = dstrect->y;
+    dw = dstrect->w, dh = dstrect->h;
+  } else {
+    dx = 0, dy = 0;
+    dw = sw, dh = sh;
+  }
+
+  if (center) {
+    pivot_x = center->x;
+    pivot_y = center->y;
+  } else {
+    pivot_x = sw * 0.5f;
+    pivot_y = sh * 0.5f;
+  }
+
+  scale_x = dw / sw;
+  scale_y = dh / sh;
+
+  /* Same flip convention as GPU_BlitRectX */
+  if (flip & OWL_FLIP_HORIZONTAL) {
+    scale_x = -scale_x;
+    dx += dw;
+    pivot_x = sw - pivot_x;
+  }
+
+  if (flip & OWL_FLIP_VERTICAL) {
+    scale_y = -scale_y;
+    dy += dh;
+    pivot_y = sh - pivot_y;
+  }
+
+  s1 = sx / canvas->texture_w;
+  t1 = sy / canvas->texture_h;
+  s2 = (sx + sw) / canvas->texture_w;
+  t2 = (sy + sh) / canvas->texture_h;
+
+  x1 = -pivot_x * scale_x;
+  y1 = -pivot_y * scale_y;
+  x2 = (sw - pivot_x) * scale_x;
+  y2 = (sh - pivot_y) * scale_y;
+
+  dx += pivot_x * scale_x;
+  dy += pivot_y * scale_y;
+
+  color = *(owl_Pixel *)&canvas->color;
+  quad = owl_batchQuad(batch, source, canvas);
+
+  quad[0].position.x = x1, quad[0].position.y = y1;
+  quad[0].uv.x = s1, quad[0].uv.y = t1;
+
+  quad[1].position.x = x2, quad[1].position.y = y1;
+  quad[1].uv.x = s2, quad[1].uv.y = t1;
+
+  quad[2].position.x = x1, quad[2].position.y = y2;
+  quad[2].uv.x = s1, quad[2].uv.y = t2;
+
+  quad[3].position.x = x2, quad[3].position.y = y2;
+  quad[3].uv.x = s2, quad[3].uv.y = t2;
+
+  if (degrees != 0.0f) {
+    cosa = cosf(degrees * (f32)OWL_RAD);
+    sina = sinf(degrees * (f32)OWL_RAD);
+  } else {
+    cosa = 1.0f;
+    sina = 0.0f;
+  }
+
+  for (i = 0; i < 4; ++i) {
+    px = quad[i].position.x;
+    py = quad[i].position.y;
+
+    quad[i].position.x = px * cosa - py * sina + dx;
+    quad[i].position.y = px * sina + py * cosa + dy;
+    quad[i].color = color;
+  }
+}
+
+void owl_batchRect(owl_SpriteBatch *batch, owl_Canvas *canvas,
+                   const owl_Rect *srcrect, const owl_Rect *dstrect,
+                   owl_Pixel color) {
+  owl_Vertex *quad = owl_batchQuad(batch, canvas, canvas);
+  f32 s1 = srcrect->x / canvas->texture_w;
+  f32 t1 = srcrect->y / canvas->texture_h;
+  f32 s2 = (srcrect->x + srcrect->w) / canvas->texture_w;
+  f32 t2 = (srcrect->y + srcrect->h) / canvas->texture_h;
+  f32 x1 = dstrect->x, y1 = dstrect->y;
+  f32 x2 = dstrect->x + dstrect->w, y2 = dstrect->y + dstrect->h;
+
+  quad[0].position.x = x1, quad[0].position.y = y1;
+  quad[0].uv.x = s1, quad[0].uv.y = t1;
+  quad[0].color = color;
+
+  quad[1].position.x = x2, quad[1].position.y = y1;
+  quad[1].uv.x = s2, quad[1].uv.y = t1;
+  quad[1].color = color;
+
+  quad[2].position.x = x1, quad[2].position.y = y2;
+  quad[2].uv.x = s1, quad[2].uv.y = t2;
+  quad[2].color = color;
+
+  quad[3].position.x = x2, quad[3].position.y = y2;
+  quad[3].uv.x = s2, quad[3].uv.y = t2;
+  quad[3].color = color;
+}
+
+void owl_batchEnd(owl_SpriteBatch *batch) { owl_batchFlush(batch); }
@@ -0,0 +1,32 @@
+/*
+ * owl_batch.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_BATCH_H__
+#define __OWL_BATCH_H__
+
+#include "owl.h"
+
+#define OWL_BATCH_DEFAULT 1024
+#define OWL_BATCH_LIMIT 16383
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void owl_batchRect(owl_SpriteBatch *batch, owl_Canvas *canvas,
+                          const owl_Rect *srcrect, const owl_Rect *dstrect,
+                          owl_Pixel color);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_BATCH_H__ */
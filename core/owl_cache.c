@@ -0,0 +1,328 @@
+/*
+ * owl_cache.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#include "owl_cache.h"
+#include "owl_io.h"
+
+#define OWL_CACHE_MAGIC 0x48434C4F /* "OLCH" */
+#define OWL_CACHE_VERSION 1
+#define OWL_CACHE_PATH 512
+#define OWL_CACHE_EXT ".owc"
+
+/* Bump these whenever a decoder's output changes */
+#define OWL_CACHE_IMAGE_DECODER 1
+#define OWL_CACHE_SOUND_DECODER 1
+
+typedef struct owl_CacheHeader {
+  u32 magic;
+  u32 version;
+  u64 key;
+  u32 kind;
+  u32 size;
+  u32 params[4];
+  u8 reserved[24];
+} owl_CacheHeader;
+
+typedef struct owl_CacheFile {
+  char *path;
+  s64 size;
+  s64 mtime;
+} owl_CacheFile;
+
+typedef struct owl_CacheScan {
+  owl_CacheFile *files;
+  s32 count;
+  s32 capacity;
+  u64 bytes;
+} owl_CacheScan;
+
+static char *root = NULL;
+static u64 limit = 0;
+static u64 total = 0;
+static SDL_mutex *lock = NULL;
+
+static SDL_atomic_t hits;
+static SDL_atomic_t misses;
+static SDL_atomic_t writes;
+static SDL_atomic_t evictions;
+static SDL_atomic_t serial;
+
+OWL_INLINE u64 owl_cacheMix(u64 h) {
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+static void owl_cachePath(char *path, u64 key, u32 kind) {
+  snprintf(path, OWL_CACHE_PATH, "%s/%c%016llx" OWL_CACHE_EXT, root,
+           kind == OWL_CACHE_IMAGE ? 'i' : 's', (unsigned long long)key);
+}
+
+static bool owl_cacheOwns(const char *path) {
+  size_t n = strlen(path), e = strlen(OWL_CACHE_EXT);
+  return n > e && 0 == strcmp(path + n - e, OWL_CACHE_EXT);
+}
+
+static void owl_cacheCollect(const char *path, s64 size, s64 mtime,
+                             void *ud) {
+  owl_CacheScan *scan = (owl_CacheScan *)ud;
+  owl_CacheFile *files;
+
+  if (!owl_cacheOwns(path))
+    return;
+
+  scan->bytes += (u64)size;
+
+  if (scan->count == scan->capacity) {
+    scan->capacity = scan->capacity ? scan->capacity * 2 : 64;
+    files = (owl_CacheFile *)realloc(scan->files,
+                                     scan->capacity * sizeof(owl_CacheFile));
+    if (!files)
+      return;
+
+    scan->files = files;
+  }
+
+  scan->files[scan->count].path = strdup(path);
+  scan->files[scan->count].size = size;
+  scan->files[scan->count].mtime = mtime;
+
+  if (scan->files[scan->count].path)
+    scan->count += 1;
+}
+
+static int owl_cacheOlder(const void *a, const void *b) {
+  s64 l = ((const owl_CacheFile *)a)->mtime;
+  s64 r = ((const owl_CacheFile *)b)->mtime;
+  return l < r ? -1 : (l > r ? 1 : 0);
+}
+
+/* Drops least recently used entries until the cache is 3/4 full */
+static void owl_cacheEvict(void) {
+  owl_CacheScan scan = {NULL, 0, 0, 0};
+  s32 i;
+
+  owl_eachFile(root, owl_cacheCollect, &scan);
+
+  if (scan.count > 0)
+    qsort(scan.files, scan.count, sizeof(owl_CacheFile), owl_cacheOlder);
+
+  for (i = 0; i < scan.count; ++i) {
+    if (limit == 0 || scan.bytes <= limit - limit / 4)
+      break;
+
+    if (0 == remove(scan.files[i].path)) {
+      scan.bytes -= (u64)scan.files[i].size;
+      SDL_AtomicIncRef(&evictions);
+    }
+  }
+
+  for (i = 0; i < scan.count; ++i)
+    free(scan.files[i].path);
+
+  if (scan.files)
+    free(scan.files);
+
+  total = scan.bytes;
+}
+
+u64 owl_cacheKey(u32 kind, const u32 *variant, s32 count, const u8 *source,
+                 s64 size) {
+  u64 h, w;
+  s64 i;
+  s32 j;
+
+  if (!root)
+    return 0;
+
+  h = 0x9E3779B97F4A7C15ULL ^ ((u64)size * 0xC2B2AE3D27D4EB4FULL);
+
+  for (i = 0; i + 8 <= size; i += 8) {
+    memcpy(&w, source + i, sizeof(w));
+    h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 29;
+  }
+
+  w = 0;
+
+  if (i < size)
+    memcpy(&w, source + i, (size_t)(size - i));
+
+  h = owl_cacheMix(h ^ w);
+
+  /* The decoder version and its settings are part of the key */
+  h = owl_cacheMix(h ^ kind ^
+                   ((u64)(kind == OWL_CACHE_IMAGE ? OWL_CACHE_IMAGE_DECODER
+                                                  : OWL_CACHE_SOUND_DECODER)
+                    << 32));
+
+  for (j = 0; j < count; ++j)
+    h = owl_cacheMix(h ^ variant[j]);
+
+  return h ? h : 1;
+}
+
+bool owl_cacheFind(u64 key, u32 kind, owl_CacheEntry *entry) {
+  const owl_CacheHeader *header;
+  char path[OWL_CACHE_PATH];
+
+  memset(entry, 0, sizeof(owl_CacheEntry));
+
+  if (!root || !key)
+    return false;
+
+  owl_cachePath(path, key, kind);
+  entry->map = owl_mapFile(path, &entry->map_size);
+
+  if (entry->map && entry->map_size >= (s64)sizeof(owl_CacheHeader)) {
+    header = (const owl_CacheHeader *)entry->map;
+
+    if (header->magic == OWL_CACHE_MAGIC &&
+        header->version == OWL_CACHE_VERSION && header->key == key &&
+        header->kind == kind &&
+        (s64)sizeof(owl_CacheHeader) + header->size <= entry->map_size) {
+      entry->data = entry->map + sizeof(owl_CacheHeader);
+      entry->size = header->size;
+      memcpy(entry->params, header->params, sizeof(entry->params));
+
+      /* The modification time doubles as the LRU stamp */
+      owl_touchFile(path);
+      SDL_AtomicIncRef(&hits);
+      return true;
+    }
+  }
+
+  owl_cacheClose(entry);
+  SDL_AtomicIncRef(&misses);
+  return false;
+}
+
+void owl_cacheStore(u64 key, u32 kind, const u32 *params, const void *data,
+                    u32 size) {
+  char path[OWL_CACHE_PATH], temp[OWL_CACHE_PATH + 16];
+  owl_CacheHeader header;
+  bool ok, over;
+  FILE *fp;
+
+  if (!root || !key)
+    return;
+
+  if (limit > 0 && sizeof(owl_CacheHeader) + (u64)size > limit / 2)
+    return;
+
+  memset(&header, 0, sizeof(header));
+  header.magic = OWL_CACHE_MAGIC;
+  header.version = OWL_CACHE_VERSION;
+  header.key = key;
+  header.kind = kind;
+  header.size = size;
+  memcpy(header.params, params, sizeof(header.params));
+
+  /* Written aside and renamed, so readers never map a partial entry */
+  owl_cachePath(path, key, kind);
+  snprintf(temp, sizeof(temp), "%s.%d.tmp", path,
+           SDL_AtomicAdd(&serial, 1));
+
+  fp = fopen(temp, "wb");
+
+  if (!fp)
+    return;
+
+  ok = 1 == fwrite(&header, sizeof(header), 1, fp);
+  ok = ok && (size == 0 || 1 == fwrite(data, size, 1, fp));
+  ok = (0 == fclose(fp)) && ok;
+
+  remove(path);
+
+  if (!ok || 0 != rename(temp, path)) {
+    remove(temp);
+    return;
+  }
+
+  SDL_AtomicIncRef(&writes);
+
+  SDL_LockMutex(lock);
+  total += sizeof(header) + size;
+  over = limit > 0 && total > limit;
+
+  if (over)
+    owl_cacheEvict();
+
+  SDL_UnlockMutex(lock);
+}
+
+void owl_cacheClose(owl_CacheEntry *entry) {
+  owl_unmapFile(entry->map, entry->map_size);
+  memset(entry, 0, sizeof(owl_CacheEntry));
+}
+
+void owl_cacheQuit(void) {
+  if (root) {
+    free(root);
+    root = NULL;
+  }
+
+  if (lock) {
+    SDL_DestroyMutex(lock);
+    lock = NULL;
+  }
+
+  limit = 0;
+  total = 0;
+}
+
+bool owl_assetCache(const char *dir, u64 bytes) {
+  owl_cacheQuit();
+
+  if (!dir)
+    return true;
+
+  if (!owl_makeDir(dir))
+    return false;
+
+  root = strdup(dir);
+  lock = SDL_CreateMutex();
+
+  if (!root || !lock) {
+    owl_cacheQuit();
+    return false;
+  }
+
+  limit = bytes;
+  owl_cacheEvict();
+
+  return true;
+}
+
+void owl_cacheStats(owl_CacheStats *stats) {
+  stats->hits = (u32)SDL_AtomicGet(&hits);
+  stats->misses = (u32)SDL_AtomicGet(&misses);
+  stats->writes = (u32)SDL_AtomicGet(&writes);
+  stats->evictions = (u32)SDL_AtomicGet(&evictions);
+
+  /* Workers update it under the lock, and a u64 can tear on 32 bits */
+  if (lock)
+    SDL_LockMutex(lock);
+
+  stats->bytes = total;
+
+  if (lock)
+    SDL_UnlockMutex(lock);
+}
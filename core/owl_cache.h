@@ -0,0 +1,44 @@
+/*
+ * owl_cache.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_CACHE_H__
+#define __OWL_CACHE_H__
+
+#include "owl.h"
+
+#define OWL_CACHE_IMAGE 1
+#define OWL_CACHE_SOUND 2
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct owl_CacheEntry {
+  const u8 *map;
+  s64 map_size;
+  const u8 *data;
+  u32 size;
+  u32 params[4];
+} owl_CacheEntry;
+
+extern u64 owl_cacheKey(u32 kind, const u32 *variant, s32 count,
+                        const u8 *source, s64 size);
+extern bool owl_cacheFind(u64 key, u32 kind, owl_CacheEntry *entry);
+extern void owl_cacheStore(u64 key, u32 kind, const u32 *params,
+                           const void *data, u32 size);
+extern void owl_cacheClose(owl_CacheEntry *entry);
+extern void owl_cacheQuit(void);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_CACHE_H__ */
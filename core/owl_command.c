@@ -0,0 +1,1085 @@
+/*
+ * owl_command.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#include "owl_atlas.h"
+#include "owl_command.h"
+#include "owl_render.h"
+#include "owl_table.h"
+
+#define OWL_CLIP_KEEP 0
+#define OWL_CLIP_SET 1
+#define OWL_CLIP_NONE 2
+
+#define OWL_BLIT_SRC 0x04
+#define OWL_BLIT_DST 0x08
+#define OWL_BLIT_CENTER 0x10
+#define OWL_BLIT_FLIP 0x03
+
+#define OWL_BLIT_ARGS 11
+
+#define OWL_SHAPES_RADII 0x01
+#define OWL_SHAPES_COLORS 0x02
+#define OWL_MERGE_VERTICES 0xFFFF
+
+#define OWL_ALIGN(n) (((n) + 7) & ~(u32)7)
+
+/* Target, clip and thickness in effect for a run of commands */
+typedef struct owl_CommandState {
+  owl_Canvas *target;
+  owl_Rect clip;
+  u32 clipping;
+  f32 thickness;
+} owl_CommandState;
+
+/*
+ * Commands are packed back to back. Arguments follow the header as f32s,
+ * points or vertices and their indices as the payload.
+ */
+typedef struct owl_Command {
+  u8 op;
+  u8 mode;
+  u16 layer;
+  u32 state;
+  u32 size;
+  u32 count;
+  u32 indices;
+  owl_Pixel color;
+  owl_Canvas *canvas;
+} owl_Command;
+
+typedef struct owl_CommandItem {
+  u64 key;
+  u32 offset;
+} owl_CommandItem;
+
+struct owl_CommandList {
+  u8 *buffer;
+  u32 size, capacity;
+
+  owl_CommandState *states;
+  u32 num_states, max_states;
+
+  owl_CommandState current;
+  owl_Pixel color;
+  u16 layer;
+
+  owl_CommandItem *items, *sorted;
+  u32 num_items, max_items;
+
+  owl_Vertex *vertices;
+  u16 *indices;
+  u32 max_vertices, max_indices;
+
+  owl_Rect *rects;
+  owl_Pixel *colors;
+  u32 max_rects;
+
+  owl_SpriteBatch *batch;
+  owl_Table *ids;
+
+  u8 *font;
+  u32 font_bytes, max_font;
+};
+
+typedef struct owl_Replay {
+  owl_CommandList *list;
+  owl_Canvas *target;
+  owl_Rect clip;
+  bool clipping;
+  f32 thickness;
+  owl_Pixel color;
+  owl_CommandState applied;
+  u32 state;
+  u32 next_target, next_texture;
+  u32 pass;
+
+  bool batching;
+  const owl_Command *geometry;
+  u32 num_vertices, num_indices;
+  bool merged;
+  u32 num_rects;
+} owl_Replay;
+
+static SDL_atomic_t recorders;
+static SDL_TLSID slot = 0;
+static SDL_SpinLock creating = 0;
+
+static owl_CommandList *owl_recorder(void) {
+  if (SDL_AtomicGet(&recorders) <= 0)
+    return NULL;
+
+  return (owl_CommandList *)SDL_TLSGet(slot);
+}
+
+static bool owl_commandGrow(void **array, u32 *capacity, u32 wanted,
+                            u32 unit) {
+  void *grown;
+  u32 n = *capacity ? *capacity : 64;
+
+  if (wanted <= *capacity)
+    return true;
+
+  while (n < wanted)
+    n *= 2;
+
+  grown = realloc(*array, (size_t)n * unit);
+
+  if (!grown)
+    return false;
+
+  *array = grown;
+  *capacity = n;
+  return true;
+}
+
+static bool owl_commandItems(owl_CommandList *list, u32 count) {
+  owl_CommandItem *items;
+
+  if (count <= list->max_items)
+    return true;
+
+  items = (owl_CommandItem *)realloc(list->items,
+                                     count * sizeof(owl_CommandItem));
+
+  if (!items)
+    return false;
+
+  list->items = items;
+  items = (owl_CommandItem *)realloc(list->sorted,
+                                     count * sizeof(owl_CommandItem));
+
+  if (!items)
+    return false;
+
+  list->sorted = items;
+  list->max_items = count;
+  return true;
+}
+
+static owl_Command *owl_commandPush(owl_CommandList *list, u8 op,
+                                    u32 extra) {
+  owl_CommandState *last;
+  owl_Command *cmd;
+  u32 size = OWL_ALIGN(sizeof(owl_Command) + extra);
+
+  if (!owl_commandGrow((void **)&list->buffer, &list->capacity,
+                       list->size + size, 1))
+    return NULL;
+
+  last = list->num_states ? &list->states[list->num_states - 1] : NULL;
+
+  /* Consecutive commands usually share their state */
+  if (!last || 0 != memcmp(last, &list->current, sizeof(owl_CommandState))) {
+    if (!owl_commandGrow((void **)&list->states, &list->max_states,
+                         list->num_states + 1, sizeof(owl_CommandState)))
+      return NULL;
+
+    list->states[list->num_states++] = list->current;
+  }
+
+  cmd = (owl_Command *)(list->buffer + list->size);
+  memset(cmd, 0, sizeof(owl_Command));
+
+  cmd->op = op;
+  cmd->layer = list->layer;
+  cmd->state = list->num_states - 1;
+  cmd->size = size;
+  cmd->color = list->color;
+
+  list->size += size;
+  return cmd;
+}
+
+bool owl_recording(void) { return owl_recorder() != NULL; }
+
+/* A failed allocation still swallows the call, it must not draw here */
+bool owl_recordShape(u8 op, const f32 *args, s32 num_args) {
+  owl_CommandList *list = owl_recorder();
+  owl_Command *cmd;
+
+  if (!list)
+    return false;
+
+  cmd = owl_commandPush(list, op, num_args * sizeof(f32));
+
+  if (cmd && num_args > 0) {
+    cmd->count = (u32)num_args;
+    memcpy(cmd + 1, args, num_args * sizeof(f32));
+  }
+  return true;
+}
+
+bool owl_recordPoints(u8 op, const owl_Point *points, s32 num_points,
+                      bool close) {
+  owl_CommandList *list = owl_recorder();
+  owl_Command *cmd;
+
+  if (!list)
+    return false;
+
+  if (!points || num_points <= 0)
+    return true;
+
+  cmd = owl_commandPush(list, op, num_points * sizeof(owl_Point));
+
+  if (cmd) {
+    cmd->mode = close ? 1 : 0;
+    cmd->count = (u32)num_points;
+    memcpy(cmd + 1, points, num_points * sizeof(owl_Point));
+  }
+  return true;
+}
+
+/* Items, then radii and colors when given, count of each */
+bool owl_recordShapes(u8 op, const void *items, u32 item_bytes,
+                      const f32 *radii, const owl_Pixel *colors, s32 count) {
+  owl_CommandList *list = owl_recorder();
+  owl_Command *cmd;
+  u32 bytes, extra;
+  u8 *payload;
+
+  if (!list)
+    return false;
+
+  if (!items || count <= 0)
+    return true;
+
+  bytes = (u32)count * item_bytes;
+  extra = bytes + (radii ? (u32)count * sizeof(f32) : 0) +
+          (colors ? (u32)count * sizeof(owl_Pixel) : 0);
+  cmd = owl_commandPush(list, op, extra);
+
+  if (!cmd)
+    return true;
+
+  cmd->count = (u32)count;
+  payload = (u8 *)(cmd + 1);
+
+  memcpy(payload, items, bytes);
+  payload += bytes;
+
+  if (radii) {
+    cmd->mode |= OWL_SHAPES_RADII;
+    memcpy(payload, radii, count * sizeof(f32));
+    payload += count * sizeof(f32);
+  }
+
+  if (colors) {
+    cmd->mode |= OWL_SHAPES_COLORS;
+    memcpy(payload, colors, count * sizeof(owl_Pixel));
+  }
+  return true;
+}
+
+bool owl_recordGeometry(owl_Canvas *texture, s32 type,
+                        const owl_Vertex *vertices, s32 num_vertices,
+                        const u16 *indices, s32 num_indices) {
+  owl_CommandList *list = owl_recorder();
+  owl_Command *cmd;
+  u32 bytes;
+
+  if (!list)
+    return false;
+
+  if (!vertices || num_vertices <= 0)
+    return true;
+
+  if (!indices)
+    num_indices = 0;
+
+  bytes = num_vertices * sizeof(owl_Vertex);
+  cmd = owl_commandPush(list, OWL_CMD_GEOMETRY, bytes + num_indices * 2);
+
+  if (cmd) {
+    cmd->mode = (u8)type;
+    cmd->count = (u32)num_vertices;
+    cmd->indices = (u32)num_indices;
+    cmd->canvas = texture;
+
+    memcpy(cmd + 1, vertices, bytes);
+
+    if (num_indices > 0)
+      memcpy((u8 *)(cmd + 1) + bytes, indices, num_indices * sizeof(u16));
+  }
+  return true;
+}
+
+bool owl_recordBlit(owl_Canvas *canvas, const owl_Rect *srcrect,
+                    const owl_Rect *dstrect, f32 degrees,
+                    const owl_Point *center, u8 flip) {
+  owl_CommandList *list = owl_recorder();
+  owl_Command *cmd;
+  f32 *args;
+
+  if (!list)
+    return false;
+
+  if (!canvas)
+    return true;
+
+  cmd = owl_commandPush(list, OWL_CMD_BLIT, OWL_BLIT_ARGS * sizeof(f32));
+
+  if (!cmd)
+    return true;
+
+  args = (f32 *)(cmd + 1);
+  memset(args, 0, OWL_BLIT_ARGS * sizeof(f32));
+
+  cmd->mode = flip & OWL_BLIT_FLIP;
+  cmd->canvas = canvas;
+
+  if (srcrect) {
+    memcpy(args, srcrect, sizeof(owl_Rect));
+    cmd->mode |= OWL_BLIT_SRC;
+  }
+
+  if (dstrect) {
+    memcpy(args + 4, dstrect, sizeof(owl_Rect));
+    cmd->mode |= OWL_BLIT_DST;
+  }
+
+  if (center) {
+    memcpy(args + 9, center, sizeof(owl_Point));
+    cmd->mode |= OWL_BLIT_CENTER;
+  }
+
+  args[8] = degrees;
+  return true;
+}
+
+bool owl_recordFont(const char *name, s32 size, const void *state,
+                    u32 bytes) {
+  owl_CommandList *list = owl_recorder();
+  owl_Command *cmd;
+  u32 len;
+
+  if (!list)
+    return false;
+
+  if (!owl_commandGrow((void **)&list->font, &list->max_font, bytes, 1))
+    return false;
+
+  len = (u32)strlen(name) + 1;
+  cmd = owl_commandPush(list, OWL_CMD_FONT, len);
+
+  if (!cmd)
+    return false;
+
+  cmd->count = (u32)size;
+  memcpy(cmd + 1, name, len);
+
+  memcpy(list->font, state, bytes);
+  list->font_bytes = bytes;
+  return true;
+}
+
+const void *owl_recordedFont(void) {
+  owl_CommandList *list = owl_recorder();
+  return list && list->font_bytes ? list->font : NULL;
+}
+
+bool owl_recordText(f32 x, f32 y, const char *text, owl_Pixel color) {
+  owl_CommandList *list = owl_recorder();
+  owl_Command *cmd;
+  f32 *args;
+  u32 len;
+
+  if (!list)
+    return false;
+
+  len = (u32)strlen(text) + 1;
+  cmd = owl_commandPush(list, OWL_CMD_TEXT, 2 * sizeof(f32) + len);
+
+  if (!cmd)
+    return true;
+
+  args = (f32 *)(cmd + 1);
+  args[0] = x;
+  args[1] = y;
+
+  cmd->color = color;
+  memcpy(args + 2, text, len);
+  return true;
+}
+
+bool owl_recordTarget(owl_Canvas *canvas) {
+  owl_CommandList *list = owl_recorder();
+
+  if (!list)
+    return false;
+
+  list->current.target = canvas ? canvas : owl_screen();
+  list->current.clipping = OWL_CLIP_KEEP;
+  memset(&list->current.clip, 0, sizeof(owl_Rect));
+  return true;
+}
+
+bool owl_recordClip(const owl_Rect *rect) {
+  owl_CommandList *list = owl_recorder();
+
+  if (!list)
+    return false;
+
+  if (rect) {
+    list->current.clip = *rect;
+    list->current.clipping = OWL_CLIP_SET;
+  } else {
+    memset(&list->current.clip, 0, sizeof(owl_Rect));
+    list->current.clipping = OWL_CLIP_NONE;
+  }
+  return true;
+}
+
+bool owl_recordColor(owl_Pixel color) {
+  owl_CommandList *list = owl_recorder();
+
+  if (!list)
+    return false;
+
+  list->color = color;
+  return true;
+}
+
+bool owl_recordThickness(f32 thickness) {
+  owl_CommandList *list = owl_recorder();
+
+  if (!list)
+    return false;
+
+  list->current.thickness = thickness;
+  return true;
+}
+
+static void owl_replayGeometryFlush(owl_Replay *r) {
+  const owl_Command *cmd = r->geometry;
+
+  if (!cmd)
+    return;
+
+  if (r->merged)
+    owl_geometry(cmd->canvas, OWL_GEOMETRY_TRIANGLES, r->list->vertices,
+                 (s32)r->num_vertices, r->list->indices,
+                 (s32)r->num_indices);
+  else
+    owl_geometry(cmd->canvas, cmd->mode, (const owl_Vertex *)(cmd + 1),
+                 (s32)cmd->count,
+                 cmd->indices ? (const u16 *)((const owl_Vertex *)(cmd + 1) +
+                                              cmd->count)
+                              : NULL,
+                 (s32)cmd->indices);
+
+  r->geometry = NULL;
+  r->merged = false;
+}
+
+/* Ends every pending run except the one the next command continues */
+static void owl_replayFlush(owl_Replay *r, u8 keep) {
+  if (r->batching && keep != OWL_CMD_BLIT) {
+    owl_batchEnd(r->list->batch);
+    r->batching = false;
+  }
+
+  if (r->num_rects > 0 && keep != OWL_CMD_FILLRECT) {
+    if (r->num_rects > 1)
+      owl_fillRects(r->list->rects, r->list->colors, (s32)r->num_rects);
+    else {
+      owl_color(r->list->colors[0]);
+      owl_fillRect(r->list->rects[0].x, r->list->rects[0].y,
+                   r->list->rects[0].w, r->list->rects[0].h);
+    }
+
+    r->num_rects = 0;
+  }
+
+  if (r->geometry && keep != OWL_CMD_GEOMETRY)
+    owl_replayGeometryFlush(r);
+}
+
+/* Appends a triangle list to the merge buffer, numbering plain lists */
+static bool owl_replayAppend(owl_Replay *r, const owl_Command *cmd) {
+  owl_CommandList *list = r->list;
+  const owl_Vertex *vertices = (const owl_Vertex *)(cmd + 1);
+  const u16 *indices = (const u16 *)(vertices + cmd->count);
+  u32 i, n = cmd->indices ? cmd->indices : cmd->count;
+
+  if (!owl_commandGrow((void **)&list->vertices, &list->max_vertices,
+                       r->num_vertices + cmd->count, sizeof(owl_Vertex)) ||
+      !owl_commandGrow((void **)&list->indices, &list->max_indices,
+                       r->num_indices + n, sizeof(u16)))
+    return false;
+
+  memcpy(list->vertices + r->num_vertices, vertices,
+         cmd->count * sizeof(owl_Vertex));
+
+  for (i = 0; i < n; ++i)
+    list->indices[r->num_indices + i] =
+        (u16)(r->num_vertices + (cmd->indices ? indices[i] : i));
+
+  r->num_vertices += cmd->count;
+  r->num_indices += n;
+  return true;
+}
+
+static void owl_replayGeometry(owl_Replay *r, const owl_Command *cmd) {
+  const owl_Command *first = r->geometry;
+  bool mergeable = cmd->mode == OWL_GEOMETRY_TRIANGLES;
+
+  /* Consecutive triangle lists on one texture become a single draw */
+  if (first && mergeable && first->mode == OWL_GEOMETRY_TRIANGLES &&
+      first->canvas == cmd->canvas &&
+      r->num_vertices + cmd->count <= OWL_MERGE_VERTICES) {
+    if (!r->merged) {
+      r->num_vertices = 0;
+      r->num_indices = 0;
+      r->merged = owl_replayAppend(r, first);
+    }
+
+    if (r->merged && owl_replayAppend(r, cmd))
+      return;
+  }
+
+  owl_replayGeometryFlush(r);
+
+  r->geometry = cmd;
+  r->num_vertices = cmd->count;
+  r->merged = false;
+}
+
+static void owl_replayBlit(owl_Replay *r, const owl_Command *cmd) {
+  const f32 *args = (const f32 *)(cmd + 1);
+  const owl_Rect *srcrect, *dstrect;
+  const owl_Point *center;
+  owl_CommandList *list = r->list;
+
+  srcrect = (cmd->mode & OWL_BLIT_SRC) ? (const owl_Rect *)args : NULL;
+  dstrect = (cmd->mode & OWL_BLIT_DST) ? (const owl_Rect *)(args + 4) : NULL;
+  center = (cmd->mode & OWL_BLIT_CENTER) ? (const owl_Point *)(args + 9)
+                                         : NULL;
+
+  if (!list->batch && !owl_recording())
+    list->batch = owl_spriteBatch(0);
+
+  /* Adjacent blits sharing a texture and blend merge in the batch */
+  if (!list->batch || owl_recording()) {
+    owl_blit(cmd->canvas, srcrect, dstrect, args[8], center,
+             cmd->mode & OWL_BLIT_FLIP);
+    return;
+  }
+
+  if (!r->batching) {
+    owl_batchBegin(list->batch);
+    r->batching = true;
+  }
+
+  owl_batchDraw(list->batch, cmd->canvas, srcrect, dstrect, args[8], center,
+                cmd->mode & OWL_BLIT_FLIP);
+}
+
+static void owl_replayState(owl_Replay *r, u32 index) {
+  const owl_CommandState *state = &r->list->states[index];
+  owl_CommandState applied;
+
+  if (index == r->state)
+    return;
+
+  memset(&applied, 0, sizeof(applied));
+  applied.target = state->target ? state->target : r->target;
+  applied.thickness = state->thickness > 0.0f ? state->thickness
+                                              : r->thickness;
+
+  /* Only the target that was current keeps its clip when none was set */
+  if (state->clipping == OWL_CLIP_SET) {
+    applied.clip = state->clip;
+    applied.clipping = OWL_CLIP_SET;
+  } else if (state->clipping == OWL_CLIP_KEEP &&
+             applied.target == r->target && r->clipping) {
+    applied.clip = r->clip;
+    applied.clipping = OWL_CLIP_SET;
+  } else
+    applied.clipping = OWL_CLIP_NONE;
+
+  r->state = index;
+
+  /* Different entries often resolve to the same thing, like the screen */
+  if (0 == memcmp(&applied, &r->applied, sizeof(owl_CommandState)))
+    return;
+
+  owl_replayFlush(r, 0);
+
+  owl_target(applied.target);
+  owl_clip(applied.clipping == OWL_CLIP_SET ? &applied.clip : NULL);
+  owl_thickness(applied.thickness);
+
+  r->applied = applied;
+}
+
+static void owl_replayShape(const owl_Command *cmd) {
+  const f32 *a = (const f32 *)(cmd + 1);
+
+  owl_color(cmd->color);
+
+  switch (cmd->op) {
+  case OWL_CMD_CLEAR:
+    owl_clear();
+    break;
+  case OWL_CMD_PIXEL:
+    owl_pixel(a[0], a[1]);
+    break;
+  case OWL_CMD_LINE:
+    owl_line(a[0], a[1], a[2], a[3]);
+    break;
+  case OWL_CMD_RECT:
+    owl_rect(a[0], a[1], a[2], a[3]);
+    break;
+  case OWL_CMD_FILLRECT:
+    owl_fillRect(a[0], a[1], a[2], a[3]);
+    break;
+  case OWL_CMD_ARC:
+    owl_arc(a[0], a[1], a[2], a[3], a[4]);
+    break;
+  case OWL_CMD_FILLARC:
+    owl_fillArc(a[0], a[1], a[2], a[3], a[4]);
+    break;
+  case OWL_CMD_CIRCLE:
+    owl_circle(a[0], a[1], a[2]);
+    break;
+  case OWL_CMD_FILLCIRCLE:
+    owl_fillCircle(a[0], a[1], a[2]);
+    break;
+  case OWL_CMD_ELLIPSE:
+    owl_ellipse(a[0], a[1], a[2], a[3], a[4]);
+    break;
+  case OWL_CMD_FILLELLIPSE:
+    owl_fillEllipse(a[0], a[1], a[2], a[3], a[4]);
+    break;
+  case OWL_CMD_SECTOR:
+    owl_sector(a[0], a[1], a[2], a[3], a[4], a[5]);
+    break;
+  case OWL_CMD_FILLSECTOR:
+    owl_fillSector(a[0], a[1], a[2], a[3], a[4], a[5]);
+    break;
+  case OWL_CMD_TRIGON:
+    owl_trigon(a[0], a[1], a[2], a[3], a[4], a[5]);
+    break;
+  case OWL_CMD_FILLTRIGON:
+    owl_fillTrigon(a[0], a[1], a[2], a[3], a[4], a[5]);
+    break;
+  case OWL_CMD_RECTROUND:
+    owl_rectRound(a[0], a[1], a[2], a[3], a[4]);
+    break;
+  case OWL_CMD_FILLRECTROUND:
+    owl_fillRectRound(a[0], a[1], a[2], a[3], a[4]);
+    break;
+  case OWL_CMD_POLYGON:
+    owl_polygon((const owl_Point *)a, (s32)cmd->count, cmd->mode != 0);
+    break;
+  case OWL_CMD_FILLPOLYGON:
+    owl_fillPolygon((const owl_Point *)a, (s32)cmd->count);
+    break;
+  }
+}
+
+/* Filled rectangles in a row go out as one owl_fillRects stream */
+static bool owl_replayRect(owl_Replay *r, const owl_Command *cmd) {
+  owl_CommandList *list = r->list;
+
+  owl_Rect *rects;
+  owl_Pixel *colors;
+  u32 n = list->max_rects ? list->max_rects * 2 : 64;
+
+  if (r->num_rects == list->max_rects) {
+    rects = (owl_Rect *)realloc(list->rects, n * sizeof(owl_Rect));
+
+    if (!rects)
+      return false;
+
+    list->rects = rects;
+    colors = (owl_Pixel *)realloc(list->colors, n * sizeof(owl_Pixel));
+
+    if (!colors)
+      return false;
+
+    list->colors = colors;
+    list->max_rects = n;
+  }
+
+  memcpy(&list->rects[r->num_rects], cmd + 1, sizeof(owl_Rect));
+  list->colors[r->num_rects++] = cmd->color;
+  return true;
+}
+
+static void owl_replayShapes(const owl_Command *cmd) {
+  const u8 *payload = (const u8 *)(cmd + 1);
+  const owl_Pixel *colors = NULL;
+  const f32 *radii = NULL;
+  s32 count = (s32)cmd->count;
+  u32 bytes;
+
+  switch (cmd->op) {
+  case OWL_CMD_LINES:
+    bytes = cmd->count * 2 * sizeof(owl_Point);
+    break;
+  case OWL_CMD_RECTS:
+  case OWL_CMD_FILLRECTS:
+    bytes = cmd->count * sizeof(owl_Rect);
+    break;
+  default:
+    bytes = cmd->count * sizeof(owl_Point);
+    break;
+  }
+
+  if (cmd->mode & OWL_SHAPES_RADII) {
+    radii = (const f32 *)(payload + bytes);
+    bytes += cmd->count * sizeof(f32);
+  }
+
+  if (cmd->mode & OWL_SHAPES_COLORS)
+    colors = (const owl_Pixel *)(payload + bytes);
+
+  owl_color(cmd->color);
+
+  switch (cmd->op) {
+  case OWL_CMD_PIXELS:
+    owl_pixels((const owl_Point *)payload, colors, count);
+    break;
+  case OWL_CMD_LINES:
+    owl_lines((const owl_Point *)payload, colors, count);
+    break;
+  case OWL_CMD_RECTS:
+    owl_rects((const owl_Rect *)payload, colors, count);
+    break;
+  case OWL_CMD_FILLRECTS:
+    owl_fillRects((const owl_Rect *)payload, colors, count);
+    break;
+  case OWL_CMD_CIRCLES:
+    owl_circles((const owl_Point *)payload, radii, colors, count);
+    break;
+  }
+}
+
+static void owl_replayText(const owl_Command *cmd) {
+  const f32 *a = (const f32 *)(cmd + 1);
+  owl_drawText(a[0], a[1], (const char *)(a + 2), cmd->color);
+}
+
+static void owl_replayRun(owl_Replay *r, const owl_Command *cmd) {
+  owl_replayState(r, cmd->state);
+  owl_replayFlush(r, owl_recording() ? 0 : cmd->op);
+
+  if (cmd->op == OWL_CMD_BLIT)
+    owl_replayBlit(r, cmd);
+  else if (cmd->op == OWL_CMD_GEOMETRY)
+    owl_replayGeometry(r, cmd);
+  else if (cmd->op == OWL_CMD_FONT)
+    owl_font((const char *)(cmd + 1), (s32)cmd->count);
+  else if (cmd->op == OWL_CMD_TEXT)
+    owl_replayText(cmd);
+  else if (cmd->op >= OWL_CMD_PIXELS && cmd->op <= OWL_CMD_CIRCLES)
+    owl_replayShapes(cmd);
+  else if (cmd->op != OWL_CMD_FILLRECT || !owl_replayRect(r, cmd))
+    owl_replayShape(cmd);
+}
+
+/* Ids follow first appearance, so passes keep their recorded order */
+static u32 owl_replayId(owl_Replay *r, const void *object, u64 tag,
+                        u32 *next, u32 limit) {
+  owl_Table *ids = r->list->ids;
+  u64 key = (u64)(uword_t)object | tag;
+  u32 id = (u32)(uword_t)owl_iGetTable(ids, key);
+
+  if (id)
+    return id - 1;
+
+  id = *next < limit ? (*next)++ : limit;
+  owl_iSetTable(ids, key, (void *)(uword_t)(id + 1));
+  return id;
+}
+
+static u32 owl_replayBlend(owl_Canvas *canvas) {
+  const u8 *p = (const u8 *)&canvas->blend_mode;
+  u32 h = 2166136261u;
+  size_t i;
+
+  if (!canvas->use_blending)
+    return 0;
+
+  for (i = 0; i < sizeof(GPU_BlendMode); ++i)
+    h = (h ^ p[i]) * 16777619u;
+
+  return h % 255 + 1;
+}
+
+/* Sort key: target (8 bits), layer (16), blend (8), texture (16) */
+static owl_Canvas *owl_replayTarget(owl_Replay *r, const owl_Command *cmd) {
+  const owl_CommandState *state = &r->list->states[cmd->state];
+  return state->target ? state->target : r->target;
+}
+
+/* The texture a command samples, as the page it lives in */
+static owl_Canvas *owl_replaySample(const owl_Command *cmd) {
+  owl_Canvas *page;
+  owl_Rect region;
+
+  if (cmd->op != OWL_CMD_BLIT && cmd->op != OWL_CMD_GEOMETRY)
+    return NULL;
+
+  if (!cmd->canvas)
+    return NULL;
+
+  page = owl_atlasRegion(cmd->canvas, &region);
+  return page ? page : cmd->canvas;
+}
+
+static u64 owl_replayKey(owl_Replay *r, const owl_Command *cmd) {
+  owl_Canvas *target = owl_replayTarget(r, cmd);
+  owl_Canvas *texture = NULL, *page;
+  owl_Rect region;
+  u32 target_id, blend, texture_id = 0;
+
+  target_id = owl_replayId(r, target, 1, &r->next_target, 0xFF);
+
+  if (cmd->op == OWL_CMD_BLIT || cmd->op == OWL_CMD_GEOMETRY)
+    texture = cmd->canvas;
+
+  if (texture) {
+    page = owl_atlasRegion(texture, &region);
+    texture_id = 1 + owl_replayId(r, page ? page : texture, 0,
+                                  &r->next_texture, 0xFFFE);
+  }
+
+  blend = owl_replayBlend(texture ? texture : target);
+
+  return (u64)target_id << 56 | (u64)cmd->layer << 40 | (u64)blend << 32 |
+         (u64)texture_id << 16;
+}
+
+/* Stable LSD radix sort on the bytes of the key that are in use */
+static owl_CommandItem *owl_replaySort(owl_CommandList *list) {
+  owl_CommandItem *from = list->items, *to = list->sorted, *swap;
+  u32 counts[256], i, n = list->num_items, sum, c;
+  s32 shift;
+
+  for (shift = 16; shift < 64; shift += 8) {
+    memset(counts, 0, sizeof(counts));
+
+    for (i = 0; i < n; ++i)
+      counts[(from[i].key >> shift) & 0xFF] += 1;
+
+    if (counts[(from[0].key >> shift) & 0xFF] == n)
+      continue;
+
+    for (i = 0, sum = 0; i < 256; ++i) {
+      c = counts[i];
+      counts[i] = sum;
+      sum += c;
+    }
+
+    for (i = 0; i < n; ++i)
+      to[counts[(from[i].key >> shift) & 0xFF]++] = from[i];
+
+    swap = from;
+    from = to;
+    to = swap;
+  }
+  return from;
+}
+
+static void owl_replayPending(owl_Replay *r) {
+  owl_CommandList *list = r->list;
+  owl_CommandItem *items = list->items;
+  u32 i;
+
+  if (list->num_items == 0)
+    return;
+
+  if (list->num_items > 1)
+    items = owl_replaySort(list);
+
+  for (i = 0; i < list->num_items; ++i)
+    owl_replayRun(r, (const owl_Command *)(list->buffer + items[i].offset));
+
+  list->num_items = 0;
+  r->pass += 1;
+}
+
+/*
+ * Sorting groups by target, so a canvas could be sampled before the pending
+ * draws into it, or drawn into before the pending commands that sample it.
+ * Either one runs the pending commands first. Marks only count for the
+ * current pass, tag 2 as a pending target and tag 4 as a pending sample.
+ */
+static void owl_replayBarrier(owl_Replay *r, const owl_Command *cmd) {
+  owl_Table *ids = r->list->ids;
+  owl_Canvas *target = owl_replayTarget(r, cmd);
+  owl_Canvas *sample = owl_replaySample(cmd);
+  void *pass = (void *)(uword_t)r->pass;
+
+  if ((sample && owl_iGetTable(ids, (u64)(uword_t)sample | 2) == pass) ||
+      owl_iGetTable(ids, (u64)(uword_t)target | 4) == pass) {
+    owl_replayPending(r);
+    pass = (void *)(uword_t)r->pass;
+  }
+
+  owl_iSetTable(ids, (u64)(uword_t)target | 2, pass);
+
+  if (sample)
+    owl_iSetTable(ids, (u64)(uword_t)sample | 4, pass);
+}
+
+owl_CommandList *owl_commandList(void) {
+  owl_CommandList *list;
+
+  SDL_AtomicLock(&creating);
+
+  if (!slot)
+    slot = SDL_TLSCreate();
+
+  SDL_AtomicUnlock(&creating);
+
+  if (!slot)
+    return NULL;
+
+  list = (owl_CommandList *)calloc(1, sizeof(owl_CommandList));
+
+  if (!list)
+    return NULL;
+
+  list->ids = owl_table();
+
+  if (!list->ids) {
+    free(list);
+    return NULL;
+  }
+
+  list->color = owl_drawColor();
+  return list;
+}
+
+void owl_freeCommandList(owl_CommandList *list) {
+  if (!list)
+    return;
+
+  if (owl_recorder() == list)
+    owl_record(NULL);
+
+  if (list->batch)
+    owl_freeSpriteBatch(list->batch);
+
+  owl_freeTable(list->ids, NULL);
+
+  free(list->buffer);
+  free(list->states);
+  free(list->items);
+  free(list->sorted);
+  free(list->vertices);
+  free(list->indices);
+  free(list->rects);
+  free(list->colors);
+  free(list->font);
+  free(list);
+}
+
+void owl_clearCommandList(owl_CommandList *list) {
+  list->size = 0;
+  list->num_states = 0;
+}
+
+void owl_record(owl_CommandList *list) {
+  owl_CommandList *current;
+
+  if (!slot)
+    return;
+
+  current = (owl_CommandList *)SDL_TLSGet(slot);
+
+  if (current == list)
+    return;
+
+  if (current)
+    SDL_AtomicAdd(&recorders, -1);
+
+  /* Every recording starts from the state current at replay */
+  if (list) {
+    memset(&list->current, 0, sizeof(owl_CommandState));
+    list->color = owl_drawColor();
+    list->layer = 0;
+    list->font_bytes = 0;
+    SDL_AtomicIncRef(&recorders);
+  }
+
+  SDL_TLSSet(slot, list, NULL);
+}
+
+void owl_layer(u16 layer) {
+  owl_CommandList *list = owl_recorder();
+
+  if (list)
+    list->layer = layer;
+}
+
+void owl_replay(owl_CommandList *list, bool sort) {
+  GPU_Target *target = owl_renderTarget();
+  const owl_Command *cmd;
+  owl_Replay r;
+  u32 offset, count = 0;
+
+  if (!list || list->size == 0 || owl_recorder() == list)
+    return;
+
+  for (offset = 0; offset < list->size; offset += cmd->size, ++count)
+    cmd = (const owl_Command *)(list->buffer + offset);
+
+  if (sort && !owl_commandItems(list, count))
+    sort = false;
+
+  memset(&r, 0, sizeof(r));
+  r.list = list;
+  r.target = target->image;
+  r.clipping = target->use_clip_rect;
+  memcpy(&r.clip, &target->clip_rect, sizeof(owl_Rect));
+  r.thickness = GPU_GetLineThickness();
+  r.color = owl_drawColor();
+  r.state = (u32)-1;
+  r.pass = 1;
+
+  owl_clearTable(list->ids, NULL);
+  list->num_items = 0;
+
+  for (offset = 0; offset < list->size; offset += cmd->size) {
+    cmd = (const owl_Command *)(list->buffer + offset);
+
+    /* A clear wipes what came before it, text needs its font, neither moves */
+    if (!sort || cmd->op == OWL_CMD_CLEAR || cmd->op == OWL_CMD_FONT) {
+      owl_replayPending(&r);
+      owl_replayRun(&r, cmd);
+      continue;
+    }
+
+    owl_replayBarrier(&r, cmd);
+
+    list->items[list->num_items].key = owl_replayKey(&r, cmd);
+    list->items[list->num_items].offset = offset;
+    list->num_items += 1;
+  }
+
+  owl_replayPending(&r);
+  owl_replayFlush(&r, 0);
+
+  owl_target(r.target);
+  owl_clip(r.clipping ? &r.clip : NULL);
+  owl_thickness(r.thickness);
+  owl_color(r.color);
+}
@@ -0,0 +1,81 @@
+/*
+ * owl_command.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_COMMAND_H__
+#define __OWL_COMMAND_H__
+
+#include "owl.h"
+
+#define OWL_CMD_CLEAR 1
+#define OWL_CMD_PIXEL 2
+#define OWL_CMD_LINE 3
+#define OWL_CMD_RECT 4
+#define OWL_CMD_FILLRECT 5
+#define OWL_CMD_ARC 6
+#define OWL_CMD_FILLARC 7
+#define OWL_CMD_CIRCLE 8
+#define OWL_CMD_FILLCIRCLE 9
+#define OWL_CMD_ELLIPSE 10
+#define OWL_CMD_FILLELLIPSE 11
+#define OWL_CMD_SECTOR 12
+#define OWL_CMD_FILLSECTOR 13
+#define OWL_CMD_TRIGON 14
+#define OWL_CMD_FILLTRIGON 15
+#define OWL_CMD_RECTROUND 16
+#define OWL_CMD_FILLRECTROUND 17
+#define OWL_CMD_POLYGON 18
+#define OWL_CMD_FILLPOLYGON 19
+#define OWL_CMD_GEOMETRY 20
+#define OWL_CMD_BLIT 21
+#define OWL_CMD_FONT 22
+#define OWL_CMD_TEXT 23
+#define OWL_CMD_PIXELS 24
+#define OWL_CMD_LINES 25
+#define OWL_CMD_RECTS 26
+#define OWL_CMD_FILLRECTS 27
+#define OWL_CMD_CIRCLES 28
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern bool owl_recording(void);
+
+/* Each returns true when the call was recorded instead of drawn */
+extern bool owl_recordShape(u8 op, const f32 *args, s32 num_args);
+extern bool owl_recordPoints(u8 op, const owl_Point *points, s32 num_points,
+                             bool close);
+/* Shape arrays are expanded on replay, with the color and width then */
+extern bool owl_recordShapes(u8 op, const void *items, u32 item_bytes,
+                             const f32 *radii, const owl_Pixel *colors,
+                             s32 count);
+extern bool owl_recordGeometry(owl_Canvas *texture, s32 type,
+                               const owl_Vertex *vertices, s32 num_vertices,
+                               const u16 *indices, s32 num_indices);
+extern bool owl_recordBlit(owl_Canvas *canvas, const owl_Rect *srcrect,
+                           const owl_Rect *dstrect, f32 degrees,
+                           const owl_Point *center, u8 flip);
+extern bool owl_recordTarget(owl_Canvas *canvas);
+extern bool owl_recordClip(const owl_Rect *rect);
+extern bool owl_recordColor(owl_Pixel color);
+extern bool owl_recordThickness(f32 thickness);
+
+/* Fonts and text replay on the render thread, the state is opaque here */
+extern bool owl_recordFont(const char *name, s32 size, const void *state,
+                           u32 bytes);
+extern const void *owl_recordedFont(void);
+extern bool owl_recordText(f32 x, f32 y, const char *text, owl_Pixel color);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_COMMAND_H__ */
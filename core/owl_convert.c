@@ -0,0 +1,390 @@
+/*
+ * owl_convert.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "owl_convert.h"
+#include "owl_platform.h"
+
+#if OWL_SSE2
+#include <emmintrin.h>
+#elif OWL_NEON
+#include <arm_neon.h>
+#endif
+
+static f32 *owl_sdlFloat(const SDL_AudioSpec *spec, const u8 *data, u32 size,
+                         u32 *count) {
+  SDL_AudioStream *stream;
+  f32 *samples = NULL;
+  s32 bytes;
+
+  stream = SDL_NewAudioStream(spec->format, spec->channels, spec->freq,
+                              AUDIO_F32SYS, spec->channels, spec->freq);
+  if (!stream)
+    return NULL;
+
+  if (0 == SDL_AudioStreamPut(stream, data, (s32)size) &&
+      0 == SDL_AudioStreamFlush(stream)) {
+    bytes = SDL_AudioStreamAvailable(stream);
+    samples = (f32 *)malloc(bytes > 0 ? (size_t)bytes : sizeof(f32));
+
+    if (samples) {
+      bytes = SDL_AudioStreamGet(stream, samples, bytes);
+      *count = bytes > 0 ? (u32)bytes / sizeof(f32) : 0;
+    }
+  }
+
+  SDL_FreeAudioStream(stream);
+  return samples;
+}
+
+static f32 *owl_toFloat(const SDL_AudioSpec *spec, const u8 *data, u32 size,
+                        u32 *count) {
+  u32 i, n = size / (SDL_AUDIO_BITSIZE(spec->format) / 8);
+  f32 *samples;
+
+  switch (spec->format) {
+  case AUDIO_U8:
+  case AUDIO_S8:
+  case AUDIO_U16SYS:
+  case AUDIO_S16SYS:
+  case AUDIO_S32SYS:
+  case AUDIO_F32SYS:
+    break;
+  default:
+    /* Byte swapped formats are rare enough to let SDL handle them */
+    return owl_sdlFloat(spec, data, size, count);
+  }
+
+  samples = (f32 *)malloc((n > 0 ? n : 1) * sizeof(f32));
+
+  if (!samples)
+    return NULL;
+
+  switch (spec->format) {
+  case AUDIO_U8:
+    for (i = 0; i < n; ++i)
+      samples[i] = ((s32)data[i] - 128) * (1.0f / 128.0f);
+    break;
+  case AUDIO_S8:
+    for (i = 0; i < n; ++i)
+      samples[i] = ((const s8 *)data)[i] * (1.0f / 128.0f);
+    break;
+  case AUDIO_U16SYS:
+    for (i = 0; i < n; ++i)
+      samples[i] = ((s32)((const u16 *)data)[i] - 32768) * (1.0f / 32768.0f);
+    break;
+  case AUDIO_S16SYS:
+    i = 0;
+#if OWL_SSE2
+    for (; i + 8 <= n; i += 8) {
+      __m128i x = _mm_loadu_si128((const __m128i *)(data + i * 2));
+      __m128 k = _mm_set1_ps(1.0f / 32768.0f);
+
+      /* Sign extend by shifting each half into the top of a 32 bit lane */
+      _mm_storeu_ps(samples + i,
+                    _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(
+                                   _mm_unpacklo_epi16(x, x), 16)),
+                               k));
+      _mm_storeu_ps(samples + i + 4,
+                    _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(
+                                   _mm_unpackhi_epi16(x, x), 16)),
+                               k));
+    }
+#elif OWL_NEON
+    for (; i + 8 <= n; i += 8) {
+      int16x8_t x = vld1q_s16((const s16 *)data + i);
+
+      vst1q_f32(samples + i,
+                vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))),
+                            1.0f / 32768.0f));
+      vst1q_f32(samples + i + 4,
+                vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))),
+                            1.0f / 32768.0f));
+    }
+#endif
+    for (; i < n; ++i)
+      samples[i] = ((const s16 *)data)[i] * (1.0f / 32768.0f);
+    break;
+  case AUDIO_S32SYS:
+    for (i = 0; i < n; ++i)
+      samples[i] = (f32)(((const s32 *)data)[i] * (1.0 / 2147483648.0));
+    break;
+  case AUDIO_F32SYS:
+    memcpy(samples, data, n * sizeof(f32));
+    break;
+  }
+
+  *count = n;
+  return samples;
+}
+
+#define OWL_MIX_MAX 8
+#define OWL_MIX_C 0.7071068f
+#define OWL_MIX_LFE 0.5f
+
+/* Left and right gains per source channel, in SDL's channel order */
+static const f32 owl_downmix[OWL_MIX_MAX - 2][OWL_MIX_MAX][2] = {
+    /* FL FR LFE */
+    {{1, 0}, {0, 1}, {OWL_MIX_LFE, OWL_MIX_LFE}},
+    /* FL FR BL BR */
+    {{1, 0}, {0, 1}, {OWL_MIX_C, 0}, {0, OWL_MIX_C}},
+    /* FL FR LFE BL BR */
+    {{1, 0},
+     {0, 1},
+     {OWL_MIX_LFE, OWL_MIX_LFE},
+     {OWL_MIX_C, 0},
+     {0, OWL_MIX_C}},
+    /* FL FR FC LFE BL BR */
+    {{1, 0},
+     {0, 1},
+     {OWL_MIX_C, OWL_MIX_C},
+     {OWL_MIX_LFE, OWL_MIX_LFE},
+     {OWL_MIX_C, 0},
+     {0, OWL_MIX_C}},
+    /* FL FR FC LFE BC SL SR */
+    {{1, 0},
+     {0, 1},
+     {OWL_MIX_C, OWL_MIX_C},
+     {OWL_MIX_LFE, OWL_MIX_LFE},
+     {OWL_MIX_C, OWL_MIX_C},
+     {OWL_MIX_C, 0},
+     {0, OWL_MIX_C}},
+    /* FL FR FC LFE BL BR SL SR */
+    {{1, 0},
+     {0, 1},
+     {OWL_MIX_C, OWL_MIX_C},
+     {OWL_MIX_LFE, OWL_MIX_LFE},
+     {OWL_MIX_C, 0},
+     {0, OWL_MIX_C},
+     {OWL_MIX_C, 0},
+     {0, OWL_MIX_C}},
+};
+
+/* Gains for each output of each source channel, scaled so none can clip */
+static bool owl_mixGains(u32 channels, u32 target, f32 *gains) {
+  f32 sum = 0;
+  u32 c;
+
+  if (channels == 1) {
+    gains[0] = gains[1] = 1.0f;
+    return true;
+  }
+
+  if (channels > OWL_MIX_MAX)
+    return false;
+
+  for (c = 0; c < channels; ++c) {
+    gains[c * 2 + 0] = channels == 2 ? (f32)(c == 0)
+                                     : owl_downmix[channels - 3][c][0];
+    gains[c * 2 + 1] = channels == 2 ? (f32)(c == 1)
+                                     : owl_downmix[channels - 3][c][1];
+    sum += gains[c * 2 + 0];
+  }
+
+  for (c = 0; c < channels * 2; ++c)
+    gains[c] /= sum;
+
+  /* Mono is the middle of the stereo downmix */
+  if (target == 1)
+    for (c = 0; c < channels; ++c)
+      gains[c] = (gains[c * 2 + 0] + gains[c * 2 + 1]) * 0.5f;
+
+  return true;
+}
+
+/* Mono is duplicated, wider layouts go through a downmix matrix */
+static f32 *owl_remix(const f32 *src, u32 frames, u32 channels, u32 target) {
+  f32 gains[OWL_MIX_MAX * 2], *dst, l, r;
+  u32 i = 0, c;
+
+  if ((target != 1 && target != 2) || channels == 0)
+    return NULL;
+
+  dst = (f32 *)malloc((frames > 0 ? frames : 1) * target * sizeof(f32));
+
+  if (!dst)
+    return NULL;
+
+  if (channels == target) {
+    memcpy(dst, src, frames * target * sizeof(f32));
+    return dst;
+  }
+
+  if (!owl_mixGains(channels, target, gains)) {
+    free(dst);
+    return NULL;
+  }
+
+#if OWL_SSE2 || OWL_NEON
+  /* Four frames per vector, one lane per frame */
+  for (; i + 4 <= frames; i += 4, src += channels * 4) {
+#if OWL_SSE2
+    __m128 x, vl = _mm_setzero_ps(), vr = _mm_setzero_ps();
+
+    for (c = 0; c < channels; ++c) {
+      x = _mm_set_ps(src[channels * 3 + c], src[channels * 2 + c],
+                     src[channels + c], src[c]);
+
+      if (target == 2) {
+        vl = _mm_add_ps(vl, _mm_mul_ps(x, _mm_set1_ps(gains[c * 2 + 0])));
+        vr = _mm_add_ps(vr, _mm_mul_ps(x, _mm_set1_ps(gains[c * 2 + 1])));
+      } else
+        vl = _mm_add_ps(vl, _mm_mul_ps(x, _mm_set1_ps(gains[c])));
+    }
+
+    if (target == 2) {
+      _mm_storeu_ps(dst + i * 2, _mm_unpacklo_ps(vl, vr));
+      _mm_storeu_ps(dst + i * 2 + 4, _mm_unpackhi_ps(vl, vr));
+    } else
+      _mm_storeu_ps(dst + i, vl);
+#else
+    float32x4_t x, vl = vdupq_n_f32(0), vr = vdupq_n_f32(0);
+    float32x4x2_t lr;
+    f32 lanes[4];
+
+    for (c = 0; c < channels; ++c) {
+      lanes[0] = src[c];
+      lanes[1] = src[channels + c];
+      lanes[2] = src[channels * 2 + c];
+      lanes[3] = src[channels * 3 + c];
+      x = vld1q_f32(lanes);
+
+      if (target == 2) {
+        vl = vmlaq_n_f32(vl, x, gains[c * 2 + 0]);
+        vr = vmlaq_n_f32(vr, x, gains[c * 2 + 1]);
+      } else
+        vl = vmlaq_n_f32(vl, x, gains[c]);
+    }
+
+    if (target == 2) {
+      lr.val[0] = vl;
+      lr.val[1] = vr;
+      vst2q_f32(dst + i * 2, lr);
+    } else
+      vst1q_f32(dst + i, vl);
+#endif
+  }
+#endif
+
+  for (; i < frames; ++i, src += channels) {
+    for (l = 0, r = 0, c = 0; c < channels; ++c) {
+      if (target == 2) {
+        l += src[c] * gains[c * 2 + 0];
+        r += src[c] * gains[c * 2 + 1];
+      } else
+        l += src[c] * gains[c];
+    }
+
+    if (target == 2) {
+      dst[i * 2 + 0] = l;
+      dst[i * 2 + 1] = r;
+    } else
+      dst[i] = l;
+  }
+  return dst;
+}
+
+/* Linear interpolation, positions in 32.32 fixed point */
+static f32 *owl_resample(const f32 *src, u32 frames, u32 channels, u32 from,
+                         u32 to, u32 *outframes) {
+  u64 step = ((u64)from << 32) / to, pos = 0;
+  u32 n = (u32)((u64)frames * to / from), i = 0, c, idx, next;
+  f32 *dst, t;
+
+  dst = (f32 *)malloc((n > 0 ? n : 1) * channels * sizeof(f32));
+
+  if (!dst)
+    return NULL;
+
+#if OWL_SSE2 || OWL_NEON
+  /* Two stereo frames per vector while both neighbours are in range */
+  if (channels == 2)
+    for (; i + 1 < n && ((pos + step) >> 32) + 1 < frames; i += 2) {
+      u32 i0 = (u32)(pos >> 32), i1 = (u32)((pos + step) >> 32);
+      f32 t0 = (pos & 0xFFFFFFFF) * (1.0f / 4294967296.0f);
+      f32 t1 = ((pos + step) & 0xFFFFFFFF) * (1.0f / 4294967296.0f);
+#if OWL_SSE2
+      __m128 a = _mm_setzero_ps(), b = _mm_setzero_ps();
+
+      a = _mm_loadl_pi(a, (const __m64 *)(src + i0 * 2));
+      a = _mm_loadh_pi(a, (const __m64 *)(src + i1 * 2));
+      b = _mm_loadl_pi(b, (const __m64 *)(src + i0 * 2 + 2));
+      b = _mm_loadh_pi(b, (const __m64 *)(src + i1 * 2 + 2));
+
+      _mm_storeu_ps(dst + i * 2,
+                    _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a),
+                                             _mm_set_ps(t1, t1, t0, t0))));
+#else
+      float32x4_t a = vcombine_f32(vld1_f32(src + i0 * 2),
+                                   vld1_f32(src + i1 * 2));
+      float32x4_t b = vcombine_f32(vld1_f32(src + i0 * 2 + 2),
+                                   vld1_f32(src + i1 * 2 + 2));
+      float32x4_t k = vcombine_f32(vdup_n_f32(t0), vdup_n_f32(t1));
+
+      vst1q_f32(dst + i * 2, vmlaq_f32(a, vsubq_f32(b, a), k));
+#endif
+      pos += step * 2;
+    }
+#endif
+
+  for (; i < n; ++i, pos += step) {
+    idx = (u32)(pos >> 32);
+    next = idx + 1 < frames ? idx + 1 : frames - 1;
+    t = (pos & 0xFFFFFFFF) * (1.0f / 4294967296.0f);
+
+    for (c = 0; c < channels; ++c)
+      dst[i * channels + c] =
+          src[idx * channels + c] +
+          (src[next * channels + c] - src[idx * channels + c]) * t;
+  }
+
+  *outframes = n;
+  return dst;
+}
+
+f32 *owl_convertAudio(const SDL_AudioSpec *spec, const u8 *data, u32 size,
+                      const SDL_AudioSpec *output, u32 *outsize) {
+  u32 count = 0, frames;
+  f32 *samples, *remixed, *resampled;
+
+  if (output->format != AUDIO_F32SYS || spec->channels == 0 ||
+      spec->freq <= 0 || output->freq <= 0)
+    return NULL;
+
+  samples = owl_toFloat(spec, data, size, &count);
+
+  if (!samples)
+    return NULL;
+
+  frames = count / spec->channels;
+  remixed = owl_remix(samples, frames, spec->channels, output->channels);
+  free(samples);
+
+  if (!remixed)
+    return NULL;
+
+  if (spec->freq == output->freq || frames == 0) {
+    *outsize = frames * output->channels * sizeof(f32);
+    return remixed;
+  }
+
+  resampled = owl_resample(remixed, frames, output->channels, spec->freq,
+                           output->freq, &frames);
+  free(remixed);
+
+  if (!resampled)
+    return NULL;
+
+  *outsize = frames * output->channels * sizeof(f32);
+  return resampled;
+}
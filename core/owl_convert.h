@@ -0,0 +1,31 @@
+/*
+ * owl_convert.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_CONVERT_H__
+#define __OWL_CONVERT_H__
+
+#include "SDL.h"
+
+#include "owl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern f32 *owl_convertAudio(const SDL_AudioSpec *spec, const u8 *data,
+                             u32 size, const SDL_AudioSpec *output,
+                             u32 *outsize);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_CONVERT_H__ */
@@ -16,14 +16,63 @@
 
 #include "utf8.h"
 
+#include "owl_atlas.h"
+#include "owl_batch.h"
+#include "owl_command.h"
 #include "owl_font.h"
-#include "owl_io.h"
+#include "owl_shader.h"
 #include "owl_table.h"
+#include "owl_vfs.h"
+
+#define OWL_GLYPH_PAGE 512
+#define OWL_GLYPH_PADDING 1
+
+#define OWL_ADVANCE_BMP 0x10000
+#define OWL_ADVANCE_NONE 0xFFFF
+
+#define OWL_KERN_BITS 12
+#define OWL_KERN_CACHE (1 << OWL_KERN_BITS)
 
 typedef struct stbtt_fontinfo owl_TrueType;
 
+typedef struct owl_Glyph {
+  owl_Canvas *page;
+  owl_Rect rect;
+  f32 xoff, yoff;
+} owl_Glyph;
+
+typedef struct owl_GlyphPage {
+  owl_Canvas *image;
+  owl_Skyline sky;
+} owl_GlyphPage;
+
+typedef struct owl_GlyphCache {
+  f32 scale;
+  owl_Table *glyphs;
+  s32 num_pages;
+  owl_GlyphPage *pages;
+} owl_GlyphCache;
+
+typedef struct owl_KernPair {
+  ucs4_t first, second;
+  s32 kern;
+} owl_KernPair;
+
+/* Advances and kerning are kept in font units, so all sizes share them */
+struct owl_Face {
+  owl_TrueType ttf;
+  owl_File file;
+  owl_Table *caches;
+  bool kerning;
+  u16 *advances;
+  owl_Table *wides;
+  owl_KernPair *kerns;
+};
+
 typedef struct owl_Font {
+  owl_Face *face;
   owl_TrueType *ttf;
+  owl_GlyphCache *cache;
   s32 ascent;
   s32 descent;
   s32 linegap;
@@ -33,48 +82,307 @@ typedef struct owl_Font {
 } owl_Font;
 
 static owl_Table *ttfs = NULL;
+static SDL_mutex *ttfs_lock = NULL;
 static owl_Font font = {0};
-static SDL_PixelFormat *format = NULL;
+static owl_SpriteBatch *batch = NULL;
+static u8 *scratch = NULL;
+static s32 scratch_size = 0;
 
-static owl_TrueType *owl_loadTTF(const char *filename) {
-  u8 *data = owl_readFile(filename);
-  owl_TrueType *ttf;
+static owl_Face *owl_loadTTF(const char *filename) {
+  owl_Face *face;
+  owl_File file;
   s32 offset;
 
-  if (!data)
+  /* stb_truetype reads the font in place, so a read-only view will do */
+  if (!owl_vfsOpen(&file, filename))
+    return NULL;
+
+  face = (owl_Face *)calloc(1, sizeof(owl_Face));
+
+  if (!face) {
+    owl_vfsClose(&file);
     return NULL;
+  }
 
-  ttf = (owl_TrueType *)malloc(sizeof(owl_TrueType));
+  face->file = file;
+  offset = stbtt_GetFontOffsetForIndex(file.data, 0);
 
-  if (!ttf) {
-    free(data);
+  if (!stbtt_InitFont(&face->ttf, file.data, offset)) {
+    free(face);
+    owl_vfsClose(&file);
     return NULL;
   }
 
-  offset = stbtt_GetFontOffsetForIndex(data, 0);
+  face->caches = owl_table();
+  face->wides = owl_table();
+
+  if (!face->caches || !face->wides) {
+    if (face->caches)
+      owl_freeTable(face->caches, NULL);
 
-  if (!stbtt_InitFont(ttf, data, offset)) {
-    free(data);
+    if (face->wides)
+      owl_freeTable(face->wides, NULL);
+
+    free(face);
+    owl_vfsClose(&file);
     return NULL;
   }
 
-  return ttf;
+  face->kerning = face->ttf.kern || face->ttf.gpos;
+  return face;
 }
 
-static void owl_freeTTF(owl_TrueType *ttf) {
-  free(ttf->data);
-  free(ttf);
+static void owl_freeGlyphCache(owl_GlyphCache *cache) {
+  s32 i;
+
+  owl_freeTable(cache->glyphs, free);
+
+  for (i = 0; i < cache->num_pages; ++i) {
+    GPU_FreeImage(cache->pages[i].image);
+    owl_freeSkyline(&cache->pages[i].sky);
+  }
+
+  if (cache->pages)
+    free(cache->pages);
+
+  free(cache);
 }
 
-static f32 owl_fontWide(owl_Font *font, ucs4_t ch, ucs4_t last) {
-  s32 ax, lsb, kern = 0;
+static void owl_freeTTF(owl_Face *face) {
+  owl_freeTable(face->caches, (owl_Dtor)owl_freeGlyphCache);
+  owl_freeTable(face->wides, NULL);
+
+  if (face->advances)
+    free(face->advances);
+
+  if (face->kerns)
+    free(face->kerns);
+
+  owl_vfsClose(&face->file);
+  free(face);
+}
+
+static owl_GlyphCache *owl_glyphCache(owl_Face *face, s32 size) {
+  owl_GlyphCache *cache = (owl_GlyphCache *)owl_iGetTable(face->caches, size);
+
+  if (cache)
+    return cache;
+
+  cache = (owl_GlyphCache *)calloc(1, sizeof(owl_GlyphCache));
+
+  if (!cache)
+    return NULL;
+
+  cache->glyphs = owl_table();
+
+  if (!cache->glyphs) {
+    free(cache);
+    return NULL;
+  }
+
+  cache->scale = stbtt_ScaleForMappingEmToPixels(&face->ttf, (f32)size);
+  owl_iSetTable(face->caches, size, cache);
+
+  return cache;
+}
+
+static u8 *owl_scratch(s32 size) {
+  u8 *buffer;
+
+  if (size <= scratch_size)
+    return scratch;
+
+  buffer = (u8 *)realloc(scratch, size);
+
+  if (!buffer)
+    return NULL;
+
+  scratch = buffer;
+  scratch_size = size;
+
+  return scratch;
+}
+
+static owl_GlyphPage *owl_glyphPage(owl_GlyphCache *cache) {
+  owl_GlyphPage *pages, *page;
+  u8 *pixels;
+
+  pages = (owl_GlyphPage *)realloc(
+      cache->pages, (cache->num_pages + 1) * sizeof(owl_GlyphPage));
+
+  if (!pages)
+    return NULL;
+
+  cache->pages = pages;
+  page = &pages[cache->num_pages];
+
+  pixels = (u8 *)calloc(OWL_GLYPH_PAGE * OWL_GLYPH_PAGE, 1);
+
+  if (!pixels)
+    return NULL;
 
-  stbtt_GetCodepointHMetrics(font->ttf, ch, &ax, &lsb);
+  page->image = owl_coverageImage(OWL_GLYPH_PAGE, OWL_GLYPH_PAGE);
 
-  if (last)
-    kern = stbtt_GetCodepointKernAdvance(font->ttf, ch, last);
+  if (!page->image) {
+    free(pixels);
+    return NULL;
+  }
+
+  /* Padding around each glyph must read as empty coverage */
+  owl_coverageUpload(page->image, NULL, pixels, OWL_GLYPH_PAGE);
+  free(pixels);
+
+  if (!owl_skyline(&page->sky, OWL_GLYPH_PAGE, OWL_GLYPH_PAGE)) {
+    GPU_FreeImage(page->image);
+    return NULL;
+  }
+
+  cache->num_pages += 1;
+  return page;
+}
+
+static bool owl_glyphPack(owl_GlyphCache *cache, s32 w, s32 h,
+                          owl_Canvas **image, s32 *x, s32 *y) {
+  owl_GlyphPage *page;
+  s32 i;
+
+  for (i = 0; i < cache->num_pages; ++i)
+    if (owl_skylinePack(&cache->pages[i].sky, w, h, x, y)) {
+      *image = cache->pages[i].image;
+      return true;
+    }
+
+  page = owl_glyphPage(cache);
+
+  if (!page || !owl_skylinePack(&page->sky, w, h, x, y))
+    return false;
+
+  *image = page->image;
+  return true;
+}
+
+static bool owl_glyphRaster(owl_TrueType *ttf, owl_GlyphCache *cache,
+                            owl_Glyph *glyph, ucs4_t ch) {
+  s32 pad = OWL_GLYPH_PADDING;
+  s32 x, y, w, h, x1, y1, x2, y2;
+  owl_Canvas *image;
+  GPU_Rect rect;
+  u8 *bitmap;
+
+  stbtt_GetCodepointBitmapBox(ttf, ch, cache->scale, cache->scale, &x1, &y1,
+                              &x2, &y2);
+  w = x2 - x1;
+  h = y2 - y1;
+
+  glyph->xoff = (f32)x1;
+  glyph->yoff = (f32)y1;
+
+  if (w <= 0 || h <= 0)
+    return true;
+
+  if (!owl_glyphPack(cache, w + pad * 2, h + pad * 2, &image, &x, &y))
+    return false;
+
+  bitmap = owl_scratch(w * h);
+
+  if (!bitmap)
+    return false;
+
+  stbtt_MakeCodepointBitmap(ttf, bitmap, w, h, w, cache->scale, cache->scale,
+                            ch);
+  rect.x = (f32)(x + pad);
+  rect.y = (f32)(y + pad);
+  rect.w = (f32)w;
+  rect.h = (f32)h;
+
+  if (!owl_coverageUpload(image, &rect, bitmap, w))
+    return false;
+
+  glyph->page = image;
+  glyph->rect.x = rect.x;
+  glyph->rect.y = rect.y;
+  glyph->rect.w = rect.w;
+  glyph->rect.h = rect.h;
+
+  return true;
+}
+
+static owl_Glyph *owl_glyph(owl_Font *font, ucs4_t ch) {
+  owl_GlyphCache *cache = font->cache;
+  owl_Glyph *glyph = (owl_Glyph *)owl_iGetTable(cache->glyphs, ch);
+
+  if (glyph)
+    return glyph;
+
+  glyph = (owl_Glyph *)calloc(1, sizeof(owl_Glyph));
+
+  if (!glyph)
+    return NULL;
+
+  /* A glyph that does not fit is cached empty so it is not retried */
+  owl_glyphRaster(font->ttf, cache, glyph, ch);
+  owl_iSetTable(cache->glyphs, ch, glyph);
 
-  return (ax + kern) * font->scale;
+  return glyph;
+}
+
+static s32 owl_faceAdvance(owl_Face *face, ucs4_t ch) {
+  void *value;
+  s32 ax, lsb;
+
+  if (ch < OWL_ADVANCE_BMP) {
+    if (!face->advances) {
+      face->advances = (u16 *)malloc(OWL_ADVANCE_BMP * sizeof(u16));
+
+      if (face->advances)
+        memset(face->advances, 0xFF, OWL_ADVANCE_BMP * sizeof(u16));
+    }
+
+    if (face->advances && face->advances[ch] != OWL_ADVANCE_NONE)
+      return face->advances[ch];
+  } else if (!!(value = owl_iGetTable(face->wides, ch)))
+    return (s32)((uword_t)value - 1);
+
+  stbtt_GetCodepointHMetrics(&face->ttf, ch, &ax, &lsb);
+
+  if (ch >= OWL_ADVANCE_BMP)
+    owl_iSetTable(face->wides, ch, (void *)(uword_t)(ax + 1));
+  else if (face->advances && ax >= 0 && ax < OWL_ADVANCE_NONE)
+    face->advances[ch] = (u16)ax;
+
+  return ax;
+}
+
+static s32 owl_faceKern(owl_Face *face, ucs4_t ch, ucs4_t last) {
+  owl_KernPair *pair;
+  u32 slot;
+
+  if (!face->kerning || !last)
+    return 0;
+
+  if (!face->kerns) {
+    face->kerns = (owl_KernPair *)calloc(OWL_KERN_CACHE, sizeof(owl_KernPair));
+
+    if (!face->kerns)
+      return stbtt_GetCodepointKernAdvance(&face->ttf, ch, last);
+  }
+
+  /* Direct mapped, a colliding pair simply replaces the old one */
+  slot = ((u32)ch * 0x9E3779B1u) ^ ((u32)last * 0x85EBCA77u);
+  pair = &face->kerns[slot >> (32 - OWL_KERN_BITS)];
+
+  if (pair->first != ch || pair->second != last) {
+    pair->first = ch;
+    pair->second = last;
+    pair->kern = stbtt_GetCodepointKernAdvance(&face->ttf, ch, last);
+  }
+
+  return pair->kern;
+}
+
+static f32 owl_fontWide(owl_Font *font, ucs4_t ch, ucs4_t last) {
+  s32 ax = owl_faceAdvance(font->face, ch);
+  return (ax + owl_faceKern(font->face, ch, last)) * font->scale;
 }
 
 static f32 owl_fontWidth(owl_Font *font, const char *text) {
@@ -138,68 +446,148 @@ bool owl_fontInit(void) {
   if (!ttfs)
     ttfs = owl_table();
 
-  format = SDL_AllocFormat(SDL_PIXELFORMAT_RGBA32);
-  return ttfs != NULL;
+  if (!ttfs_lock)
+    ttfs_lock = SDL_CreateMutex();
+
+  if (!batch)
+    batch = owl_spriteBatch(0);
+
+  return ttfs != NULL && ttfs_lock != NULL && batch != NULL;
 }
 
 void owl_fontQuit(void) {
-  if (format) {
-    SDL_FreeFormat(format);
-    format = NULL;
+  if (batch) {
+    owl_freeSpriteBatch(batch);
+    batch = NULL;
+  }
+
+  if (scratch) {
+    free(scratch);
+    scratch = NULL;
+    scratch_size = 0;
   }
 
   if (ttfs) {
     owl_freeTable(ttfs, (owl_Dtor)owl_freeTTF);
     ttfs = NULL;
   }
+
+  if (ttfs_lock) {
+    SDL_DestroyMutex(ttfs_lock);
+    ttfs_lock = NULL;
+  }
   memset(&font, 0, sizeof(owl_Font));
 }
 
+owl_Face *owl_fontDecode(const char *filename) {
+  return owl_loadTTF(filename);
+}
+
+/*
+ * Recording threads look faces up while the render thread adds them. Faces
+ * live until owl_fontQuit, so a found one stays valid once unlocked.
+ */
+static owl_Face *owl_fontFind(const char *name) {
+  owl_Face *face;
+
+  SDL_LockMutex(ttfs_lock);
+  face = (owl_Face *)owl_getTable(ttfs, name);
+  SDL_UnlockMutex(ttfs_lock);
+
+  return face;
+}
+
+static bool owl_fontInsert(const char *name, owl_Face *face) {
+  bool added = false;
+
+  SDL_LockMutex(ttfs_lock);
+
+  if (!owl_getTable(ttfs, name)) {
+    owl_setTable(ttfs, name, face);
+    added = true;
+  }
+
+  SDL_UnlockMutex(ttfs_lock);
+
+  if (!added)
+    owl_freeTTF(face);
+
+  return true;
+}
+
+bool owl_fontAdd(const char *name, owl_Face *face) {
+  if (!name) {
+    owl_freeTTF(face);
+    return false;
+  }
+
+  return owl_fontInsert(name, face);
+}
+
+void owl_fontDiscard(owl_Face *face) { owl_freeTTF(face); }
+
 bool owl_loadFont(const char *name, const char *filename) {
-  owl_TrueType *ttf = (owl_TrueType *)owl_getTable(ttfs, name);
+  owl_Face *face = owl_fontFind(name);
 
-  if (ttf)
+  if (face)
     return true;
 
   if (!filename)
     return false;
 
-  ttf = owl_loadTTF(filename);
+  face = owl_loadTTF(filename);
 
-  if (!ttf)
+  if (!face)
     return false;
 
-  owl_setTable(ttfs, name, ttf);
-  return true;
+  return owl_fontInsert(name, face);
 }
 
-bool owl_font(const char *name, s32 size) {
-  owl_TrueType *ttf = (owl_TrueType *)owl_getTable(ttfs, name);
+static void owl_fontSelect(owl_Font *font, owl_Face *face, s32 size,
+                           owl_GlyphCache *cache) {
+  owl_TrueType *ttf = &face->ttf;
   s32 ascent, descent, linegap;
 
-  if (!ttf)
+  stbtt_GetFontVMetrics(ttf, &ascent, &descent, &linegap);
+
+  font->face = face;
+  font->ttf = ttf;
+  font->cache = cache;
+  font->ascent = ascent;
+  font->descent = descent;
+  font->linegap = linegap;
+  font->scale = stbtt_ScaleForMappingEmToPixels(ttf, (f32)size);
+  font->baseline = ceilf(ascent * font->scale);
+  font->height = ceilf((ascent - descent) * font->scale);
+}
+
+bool owl_font(const char *name, s32 size) {
+  owl_Face *face = owl_fontFind(name);
+  owl_GlyphCache *cache;
+  owl_Font recorded;
+
+  if (!face || size <= 0)
     return false;
 
-  stbtt_GetFontVMetrics(ttf, &ascent, &descent, &linegap);
+  /* The glyph cache belongs to the render thread, replay selects it */
+  if (owl_recording()) {
+    owl_fontSelect(&recorded, face, size, NULL);
+    return owl_recordFont(name, size, &recorded, sizeof(owl_Font));
+  }
 
-  font.ttf = ttf;
-  font.ascent = ascent;
-  font.descent = descent;
-  font.linegap = linegap;
-  font.scale = stbtt_ScaleForMappingEmToPixels(ttf, (f32)size);
-  font.baseline = ceilf(ascent * font.scale);
-  font.height = ceilf((ascent - descent) * font.scale);
+  cache = owl_glyphCache(face, size);
 
+  if (!cache)
+    return false;
+
+  owl_fontSelect(&font, face, size, cache);
   return true;
 }
 
 owl_Canvas *owl_text(const char *text, owl_Pixel color) {
-  f32 alpha = (f32)color.a / 255.0f;
-  SDL_Surface *surface;
   owl_Canvas *canvas;
   u8 *bitmap;
-  u32 *pixels;
-  s32 i, w, h;
+  s32 w, h;
 
   if (!text)
     return NULL;
@@ -209,36 +597,117 @@ owl_Canvas *owl_text(const char *text, owl_Pixel color) {
   if (!bitmap)
     return NULL;
 
-  surface = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_RGBA32);
+  canvas = owl_coverageImage(w, h);
 
-  if (!surface) {
-    free(bitmap);
-    return NULL;
+  if (canvas && !owl_coverageUpload(canvas, NULL, bitmap, w)) {
+    GPU_FreeImage(canvas);
+    canvas = NULL;
   }
 
-  if (SDL_MUSTLOCK(surface))
-    SDL_LockSurface(surface);
+  free(bitmap);
 
-  pixels = (u32 *)surface->pixels;
+  if (canvas)
+    GPU_SetColor(canvas, *(SDL_Color *)&color);
 
-  for (i = 0; i < w * h; ++i) {
-    u8 a = (u8)ceilf(alpha * bitmap[i]);
-    pixels[i] = SDL_MapRGBA(format, color.r, color.g, color.b, a);
-  }
+  return canvas;
+}
 
-  if (SDL_MUSTLOCK(surface))
-    SDL_UnlockSurface(surface);
+owl_Canvas *owl_textTint(owl_Canvas *text, owl_Pixel color) {
+  owl_Canvas *canvas;
 
-  canvas = GPU_CopyImageFromSurface(surface);
+  if (!text)
+    return NULL;
 
-  SDL_FreeSurface(surface);
-  free(bitmap);
+  /* Aliases share the coverage texture, only the tint differs */
+  canvas = GPU_CreateAliasImage(text);
+
+  if (canvas)
+    GPU_SetColor(canvas, *(SDL_Color *)&color);
 
   return canvas;
 }
 
+/* Straight from the font data, the advance caches are not thread safe */
+static f32 owl_fontMeasure(const owl_Font *font, const char *text) {
+  const char *p = text;
+  f32 width = 0;
+  ucs4_t ch, last = 0;
+  s32 ax, lsb, kern;
+
+  while (*p) {
+    p += utf8_tounicode(p, &ch);
+    stbtt_GetCodepointHMetrics(font->ttf, ch, &ax, &lsb);
+
+    kern = font->face->kerning && last
+               ? stbtt_GetCodepointKernAdvance(font->ttf, ch, last)
+               : 0;
+
+    width += (ax + kern) * font->scale;
+    last = ch;
+  }
+  return width;
+}
+
+/* Glyphs are rasterized and uploaded on replay, recording only measures */
+static f32 owl_recordString(f32 x, f32 y, const char *text,
+                            owl_Pixel color) {
+  const owl_Font *recorded = (const owl_Font *)owl_recordedFont();
+
+  if (!recorded)
+    return -1.0f;
+
+  owl_recordText(x, y, text, color);
+  return owl_fontMeasure(recorded, text);
+}
+
+f32 owl_drawText(f32 x, f32 y, const char *text, owl_Pixel color) {
+  const char *p = text;
+  ucs4_t ch, last = 0;
+  owl_Glyph *glyph;
+  owl_Rect dstrect;
+  f32 pen = 0;
+
+  if (text && owl_recording())
+    return owl_recordString(x, y, text, color);
+
+  if (!text || !font.ttf)
+    return -1.0f;
+
+  x = floorf(x + 0.5f);
+  y = floorf(y + 0.5f);
+
+  owl_batchBegin(batch);
+
+  while (*p) {
+    p += utf8_tounicode(p, &ch);
+    glyph = owl_glyph(&font, ch);
+
+    if (glyph && glyph->page) {
+      dstrect.x = x + floorf(pen + 0.5f) + glyph->xoff;
+      dstrect.y = y + font.baseline + glyph->yoff;
+      dstrect.w = glyph->rect.w;
+      dstrect.h = glyph->rect.h;
+
+      owl_batchRect(batch, glyph->page, &glyph->rect, &dstrect, color);
+    }
+
+    pen += owl_fontWide(&font, ch, last);
+    last = ch;
+  }
+
+  owl_batchEnd(batch);
+  return pen;
+}
+
 f32 owl_textWidth(const char *text) {
-  if (!text)
+  const owl_Font *recorded;
+
+  if (text && owl_recording()) {
+    recorded = (const owl_Font *)owl_recordedFont();
+    return recorded ? owl_fontMeasure(recorded, text) : -1.0f;
+  }
+
+  if (!text || !font.face)
     return -1.0f;
 
   return owl_fontWidth(&font, text);
@@ -18,9 +18,15 @@
 extern "C" {
 #endif
 
+typedef struct owl_Face owl_Face;
+
 extern bool owl_fontInit(void);
 extern void owl_fontQuit(void);
 
+extern owl_Face *owl_fontDecode(const char *filename);
+extern bool owl_fontAdd(const char *name, owl_Face *face);
+extern void owl_fontDiscard(owl_Face *face);
+
 #ifdef __cplusplus
 };
 #endif
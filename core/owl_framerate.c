@@ -9,44 +9,156 @@
  * Usage of Owl is subject to the appropriate license agreement.
  */
 
+#include <string.h>
+
+#include "SDL.h"
+
 #include "owl_framerate.h"
 
-#define OWL_FRAMERATE_UPPER_LIMIT 100
+#define OWL_FRAMERATE_UPPER_LIMIT 1000
 #define OWL_FRAMERATE_LOWER_LIMIT 1
 
+/* How late SDL_Delay may wake up, in microseconds */
+#define OWL_FRAMERATE_SLACK 2000
+#define OWL_FRAMERATE_MIN_SLACK 250
+#define OWL_FRAMERATE_MAX_SLACK 4000
+
+/* Closer to the deadline than this the wait spins, in microseconds */
+#define OWL_FRAMERATE_SPIN 200
+
+static u64 owl_frameRateUs(owl_FrameRate *fr, u64 us) {
+  return fr->freq * us / 1000000;
+}
+
+static f64 owl_frameRateMs(owl_FrameRate *fr, u64 ticks) {
+  return (f64)ticks * 1000.0 / (f64)fr->freq;
+}
+
+/* Sleeps while the OS timer is safe, then yields and spins the rest */
+static void owl_frameRateSleep(owl_FrameRate *fr, u64 target) {
+  u64 now = SDL_GetPerformanceCounter(), before, asked, late;
+  u64 spin = owl_frameRateUs(fr, OWL_FRAMERATE_SPIN);
+  u32 ms;
+
+  if (target > now + fr->slack) {
+    ms = (u32)((target - now - fr->slack) * 1000 / fr->freq);
+
+    if (ms > 0) {
+      before = now;
+      SDL_Delay(ms);
+      now = SDL_GetPerformanceCounter();
+
+      asked = fr->freq * ms / 1000;
+      late = now - before > asked ? now - before - asked : 0;
+
+      /* Learn a late wake up at once, forget it slowly */
+      if (late > fr->slack)
+        fr->slack = late;
+      else
+        fr->slack -= (fr->slack - late) / 16;
+
+      if (fr->slack < owl_frameRateUs(fr, OWL_FRAMERATE_MIN_SLACK))
+        fr->slack = owl_frameRateUs(fr, OWL_FRAMERATE_MIN_SLACK);
+
+      if (fr->slack > owl_frameRateUs(fr, OWL_FRAMERATE_MAX_SLACK))
+        fr->slack = owl_frameRateUs(fr, OWL_FRAMERATE_MAX_SLACK);
+    }
+  }
+
+  while (now < target) {
+    if (target - now > spin)
+      SDL_Delay(0);
+
+    now = SDL_GetPerformanceCounter();
+  }
+}
+
+static void owl_frameRateRecord(owl_FrameRate *fr, u64 elapsed, bool paced) {
+  owl_FrameStats *stats = &fr->stats;
+  f64 ms = owl_frameRateMs(fr, elapsed), expected, error;
+
+  stats->frames += 1;
+  stats->last = ms;
+
+  if (stats->frames == 1) {
+    stats->average = ms;
+    stats->min = ms;
+    stats->max = ms;
+  } else {
+    stats->average += (ms - stats->average) / 16;
+
+    if (ms < stats->min)
+      stats->min = ms;
+
+    if (ms > stats->max)
+      stats->max = ms;
+  }
+
+  expected = paced ? owl_frameRateMs(fr, fr->period) : stats->average;
+  error = ms > expected ? ms - expected : expected - ms;
+  stats->jitter += (error - stats->jitter) / 16;
+}
+
 bool owl_frameRateSet(owl_FrameRate *fr, u32 rate) {
-  if (rate < OWL_FRAMERATE_LOWER_LIMIT || rate > OWL_FRAMERATE_UPPER_LIMIT)
+  /* Zero leaves pacing to vsync, or runs unlimited without it */
+  if (rate != 0 &&
+      (rate < OWL_FRAMERATE_LOWER_LIMIT || rate > OWL_FRAMERATE_UPPER_LIMIT))
     return false;
 
-  fr->framecount = 0;
+  fr->freq = SDL_GetPerformanceFrequency();
   fr->rate = rate;
-  fr->rateticks = 1000.0f / (f32)rate;
-  fr->baseticks = owl_ticks();
-  fr->lastticks = fr->baseticks;
+  fr->period = rate ? (fr->freq + rate / 2) / rate : 0;
+  fr->last = SDL_GetPerformanceCounter();
+  fr->target = fr->last + fr->period;
+
+  if (fr->slack == 0)
+    fr->slack = owl_frameRateUs(fr, OWL_FRAMERATE_SLACK);
 
+  owl_frameRateReset(fr);
   return true;
 }
 
+void owl_frameRateSync(owl_FrameRate *fr, bool vsync, u32 refresh) {
+  fr->vsync = vsync;
+  fr->refresh = refresh;
+}
+
 u32 owl_frameRateWait(owl_FrameRate *fr) {
-  u64 current_ticks;
-  u64 target_ticks;
-  u32 time_passed;
+  u64 now = SDL_GetPerformanceCounter(), target = fr->target, early = 0;
+  u64 elapsed;
+  bool paced = fr->period > 0;
 
-  fr->framecount += 1;
+  /* The swap already blocks for anything at or above the refresh rate */
+  if (fr->vsync && fr->refresh > 0 && fr->rate >= fr->refresh)
+    paced = false;
 
-  current_ticks = owl_ticks();
-  time_passed = (u32)(current_ticks - fr->lastticks);
+  if (paced) {
+    if (now > target) {
+      fr->stats.missed += 1;
 
-  fr->lastticks = current_ticks;
+      /* More than a frame behind, start over instead of rushing */
+      if (now - target > fr->period)
+        target = now;
+    } else {
+      /* Wake half a refresh early so the next swap meets its vblank */
+      if (fr->vsync && fr->refresh > 0)
+        early = fr->freq / fr->refresh / 2;
 
-  target_ticks = fr->baseticks + (u64)((f32)fr->framecount * fr->rateticks);
+      owl_frameRateSleep(fr, target - early);
+    }
 
-  if (current_ticks <= target_ticks)
-    owl_sleep((u32)(target_ticks - current_ticks));
-  else {
-    fr->framecount = 0;
-    fr->baseticks = owl_ticks();
+    fr->target = target + fr->period;
   }
 
-  return time_passed;
+  now = SDL_GetPerformanceCounter();
+  elapsed = now - fr->last;
+  fr->last = now;
+
+  owl_frameRateRecord(fr, elapsed, paced);
+
+  return (u32)((elapsed * 1000 + fr->freq / 2) / fr->freq);
+}
+
+void owl_frameRateReset(owl_FrameRate *fr) {
+  memset(&fr->stats, 0, sizeof(owl_FrameStats));
 }
@@ -20,16 +20,23 @@
 extern "C" {
 #endif
 
+/* Everything but the stats is in performance counter ticks */
 typedef struct owl_FrameRate {
   u32 rate;
-  u32 framecount;
-  f32 rateticks;
-  u64 baseticks;
-  u64 lastticks;
+  u32 refresh;
+  bool vsync;
+  u64 freq;
+  u64 period;
+  u64 target;
+  u64 last;
+  u64 slack;
+  owl_FrameStats stats;
 } owl_FrameRate;
 
 extern bool owl_frameRateSet(owl_FrameRate *fr, u32 rate);
+extern void owl_frameRateSync(owl_FrameRate *fr, bool vsync, u32 refresh);
 extern u32 owl_frameRateWait(owl_FrameRate *fr);
+extern void owl_frameRateReset(owl_FrameRate *fr);
 
 #ifdef __cplusplus
 };
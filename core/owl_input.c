@@ -19,6 +19,9 @@ static u8 keyboard[OWL_KEY_MAX] = {0};
 static char input_text[32] = {0};
 static char edit_text[32] = {0};
 
+/* Set while the video thread pumps events for another thread to read */
+static SDL_atomic_t pumped;
+
 OWL_INLINE u8 owl_mapSDLButton(u8 button) {
   switch (button) {
   case SDL_BUTTON_RIGHT:
@@ -269,12 +272,22 @@ OWL_INLINE s32 owl_mapsSDLKey(s32 scancode) {
   return keymap[scancode];
 }
 
+static bool owl_nextEvent(SDL_Event *e) {
+  if (!SDL_AtomicGet(&pumped))
+    return SDL_PollEvent(e);
+
+  return SDL_PeepEvents(e, 1, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT) >
+         0;
+}
+
+void owl_inputPumped(bool onoff) { SDL_AtomicSet(&pumped, onoff ? 1 : 0); }
+
 bool owl_event(owl_Event *event) {
   SDL_Event e;
 
   memset(event, 0, sizeof(owl_Event));
 
-  while (SDL_PollEvent(&e)) {
+  while (owl_nextEvent(&e)) {
     switch (e.type) {
     case SDL_QUIT:
       event->type = OWL_EVENT_QUIT;
@@ -18,6 +18,8 @@
 extern "C" {
 #endif
 
+extern void owl_inputPumped(bool onoff);
+
 #ifdef __cplusplus
 };
 #endif
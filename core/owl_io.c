@@ -16,7 +16,10 @@
 #include <sys/stat.h>
 
 #ifndef _WIN32
+#include <dirent.h>
+#include <sys/mman.h>
 #include <unistd.h>
+#include <utime.h>
 
 #if defined(__APPLE__)
 /* link CoreFoundation.framework */
@@ -30,7 +33,9 @@
 #define OWL_PATHSEP '/'
 #else /* _WIN32 */
 #include <Windows.h>
+#include <direct.h>
 #include <io.h>
+#include <sys/utime.h>
 
 #define lstat stat
 
@@ -44,6 +49,8 @@
 #define S_ISLNK(m) S_ISTYPE(m, S_IFLNK)
 
 #define access _access
+#define mkdir(path, mode) _mkdir(path)
+#define utime _utime
 
 #define OWL_PATHSEP '\\'
 #endif /* _WIN32 */
@@ -118,6 +125,132 @@ u8 *owl_readFile(const char *filename) {
   return data;
 }
 
+const u8 *owl_mapFile(const char *filename, s64 *size) {
+  void *data = NULL;
+#ifdef _WIN32
+  HANDLE file, mapping;
+  LARGE_INTEGER length;
+
+  file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                     OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+  if (file == INVALID_HANDLE_VALUE)
+    return NULL;
+
+  if (!GetFileSizeEx(file, &length) || length.QuadPart <= 0) {
+    CloseHandle(file);
+    return NULL;
+  }
+
+  mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+
+  if (!mapping)
+    return NULL;
+
+  /* The view keeps the mapping object alive */
+  data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+
+  if (!data)
+    return NULL;
+
+  *size = (s64)length.QuadPart;
+#else
+  struct stat st;
+  int fp;
+
+  fp = open(filename, O_RDONLY | O_BINARY);
+
+  if (fp < 0)
+    return NULL;
+
+  if (fstat(fp, &st) < 0 || st.st_size <= 0) {
+    close(fp);
+    return NULL;
+  }
+
+  data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fp, 0);
+  close(fp);
+
+  if (data == MAP_FAILED)
+    return NULL;
+
+  *size = (s64)st.st_size;
+#endif
+  return (const u8 *)data;
+}
+
+void owl_unmapFile(const void *data, s64 size) {
+  if (!data)
+    return;
+
+#ifdef _WIN32
+  UnmapViewOfFile(data);
+#else
+  munmap((void *)data, (size_t)size);
+#endif
+}
+
+void owl_touchFile(const char *filename) { utime(filename, NULL); }
+
+bool owl_eachFile(const char *dir, owl_EachFile each, void *ud) {
+  char path[MAX_PATH];
+#ifdef _WIN32
+  WIN32_FIND_DATAA find;
+  ULARGE_INTEGER value;
+  HANDLE handle;
+
+  snprintf(path, sizeof(path), "%s\\*", dir);
+  handle = FindFirstFileA(path, &find);
+
+  if (handle == INVALID_HANDLE_VALUE)
+    return false;
+
+  do {
+    if (find.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+      continue;
+
+    snprintf(path, sizeof(path), "%s\\%s", dir, find.cFileName);
+
+    /* FILETIME counts 100ns ticks since 1601 */
+    value.LowPart = find.ftLastWriteTime.dwLowDateTime;
+    value.HighPart = find.ftLastWriteTime.dwHighDateTime;
+
+    each(path,
+         ((s64)find.nFileSizeHigh << 32) | (s64)find.nFileSizeLow,
+         (s64)(value.QuadPart / 10000000ULL) - 11644473600LL, ud);
+  } while (FindNextFileA(handle, &find));
+
+  FindClose(handle);
+#else
+  struct dirent *entry;
+  struct stat st;
+  DIR *handle = opendir(dir);
+
+  if (!handle)
+    return false;
+
+  while ((entry = readdir(handle))) {
+    snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+
+    if (0 == stat(path, &st) && S_ISREG(st.st_mode))
+      each(path, (s64)st.st_size, (s64)st.st_mtime, ud);
+  }
+
+  closedir(handle);
+#endif
+  return true;
+}
+
+bool owl_makeDir(const char *path) {
+  if (owl_isDir(path))
+    return true;
+
+  mkdir(path, 0755);
+  return owl_isDir(path);
+}
+
 int owl_tempFile(const char *filename) {
   int fd = -1;
 
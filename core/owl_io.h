@@ -22,8 +22,15 @@
 extern "C" {
 #endif
 
+typedef void (*owl_EachFile)(const char *path, s64 size, s64 mtime, void *ud);
+
 extern s64 owl_fileSize(const char *filename);
 extern u8 *owl_readFile(const char *filename);
+extern const u8 *owl_mapFile(const char *filename, s64 *size);
+extern void owl_unmapFile(const void *data, s64 size);
+extern void owl_touchFile(const char *filename);
+extern bool owl_eachFile(const char *dir, owl_EachFile each, void *ud);
+extern bool owl_makeDir(const char *path);
 extern int owl_tempFile(const char *filename);
 
 extern const char *owl_selfName(void);
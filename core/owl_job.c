@@ -0,0 +1,566 @@
+/*
+ * owl_job.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <stdlib.h>
+
+#include "SDL.h"
+
+#include "owl_job.h"
+
+#define OWL_JOB_WORKERS 16
+#define OWL_JOB_DEQUE 4096
+#define OWL_JOB_MASK (OWL_JOB_DEQUE - 1)
+#define OWL_JOB_SPINS 64
+#define OWL_JOB_FREE 256
+
+/*
+ * A job stays unfinished while its function or any of its children is
+ * running. One reference belongs to the handle, the other to completion.
+ */
+struct owl_Job {
+  owl_JobFunc func;
+  void *ud;
+  struct owl_Job *parent;
+  SDL_atomic_t unfinished;
+  SDL_atomic_t refs;
+  s32 first, last;
+  struct owl_Job *next;
+};
+
+/*
+ * Each worker pushes and pops at the bottom of its own deque, while idle
+ * threads steal from the top. Threads outside the pool share deque 0.
+ */
+typedef struct owl_JobDeque {
+  SDL_SpinLock lock;
+  u32 top;
+  u32 bottom;
+  owl_Job *jobs[OWL_JOB_DEQUE];
+} owl_JobDeque;
+
+typedef struct owl_JobLoop {
+  owl_ForFunc func;
+  void *ud;
+  s32 grain;
+} owl_JobLoop;
+
+static SDL_Thread *workers[OWL_JOB_WORKERS];
+static owl_JobDeque *deques = NULL;
+static s32 wanted = 0;
+static SDL_sem *wake = NULL;
+static SDL_TLSID slot = 0;
+static SDL_SpinLock starting = 0;
+
+/* Latency bound jobs skip the pool and get a thread of their own */
+static owl_JobDeque urgent;
+static SDL_Thread *urgent_worker = NULL;
+static SDL_sem *urgent_wake = NULL;
+
+/* Workers already running read the count while later ones are created */
+static SDL_atomic_t num_workers;
+static SDL_atomic_t started;
+static SDL_atomic_t quit;
+static SDL_atomic_t queued;
+static SDL_atomic_t sleepers;
+
+/* Finished jobs are recycled, parallel loops allocate a lot of them */
+static SDL_SpinLock pool_lock = 0;
+static owl_Job *pool = NULL;
+static s32 pool_size = 0;
+
+static s32 owl_jobSelf(void) { return (s32)(uword_t)SDL_TLSGet(slot); }
+
+static bool owl_jobPush(owl_JobDeque *deque, owl_Job *job) {
+  bool ok;
+
+  SDL_AtomicLock(&deque->lock);
+  ok = deque->bottom - deque->top < OWL_JOB_DEQUE;
+
+  if (ok)
+    deque->jobs[deque->bottom++ & OWL_JOB_MASK] = job;
+
+  SDL_AtomicUnlock(&deque->lock);
+  return ok;
+}
+
+static owl_Job *owl_jobPop(owl_JobDeque *deque) {
+  owl_Job *job = NULL;
+
+  SDL_AtomicLock(&deque->lock);
+
+  if (deque->bottom != deque->top)
+    job = deque->jobs[--deque->bottom & OWL_JOB_MASK];
+
+  SDL_AtomicUnlock(&deque->lock);
+  return job;
+}
+
+static owl_Job *owl_jobSteal(owl_JobDeque *deque) {
+  owl_Job *job = NULL;
+
+  SDL_AtomicLock(&deque->lock);
+
+  if (deque->bottom != deque->top)
+    job = deque->jobs[deque->top++ & OWL_JOB_MASK];
+
+  SDL_AtomicUnlock(&deque->lock);
+  return job;
+}
+
+static owl_Job *owl_jobTake(s32 self) {
+  owl_Job *job;
+  s32 i, n = SDL_AtomicGet(&num_workers) + 1;
+
+  if (SDL_AtomicGet(&queued) <= 0)
+    return NULL;
+
+  /* Newest first from a worker's own deque, oldest first from deque 0 */
+  job = self > 0 ? owl_jobPop(&deques[self]) : owl_jobSteal(&deques[0]);
+
+  for (i = 1; !job && i < n; ++i)
+    job = owl_jobSteal(&deques[(self + i) % n]);
+
+  if (job)
+    SDL_AtomicAdd(&queued, -1);
+
+  return job;
+}
+
+static owl_Job *owl_jobAlloc(owl_JobFunc func, void *ud, owl_Job *parent) {
+  owl_Job *job;
+
+  SDL_AtomicLock(&pool_lock);
+  job = pool;
+
+  if (job) {
+    pool = job->next;
+    pool_size -= 1;
+  }
+
+  SDL_AtomicUnlock(&pool_lock);
+
+  if (!job && !(job = (owl_Job *)malloc(sizeof(owl_Job))))
+    return NULL;
+
+  job->func = func;
+  job->ud = ud;
+  job->parent = parent;
+  job->first = 0;
+  job->last = 0;
+  job->next = NULL;
+
+  SDL_AtomicSet(&job->unfinished, 1);
+  SDL_AtomicSet(&job->refs, 2);
+
+  if (parent)
+    SDL_AtomicIncRef(&parent->unfinished);
+
+  return job;
+}
+
+static void owl_jobFinish(owl_Job *job) {
+  owl_Job *parent;
+
+  while (job && SDL_AtomicDecRef(&job->unfinished)) {
+    parent = job->parent;
+    owl_releaseJob(job);
+    job = parent;
+  }
+}
+
+static void owl_jobRun(owl_Job *job) {
+  job->func(job, job->ud);
+  owl_jobFinish(job);
+}
+
+static void owl_jobSubmit(owl_Job *job) {
+  SDL_AtomicIncRef(&queued);
+
+  /* A full deque means the caller is far ahead, so it does the work */
+  if (!owl_jobPush(&deques[owl_jobSelf()], job)) {
+    SDL_AtomicAdd(&queued, -1);
+    owl_jobRun(job);
+    return;
+  }
+
+  if (SDL_AtomicGet(&sleepers) > 0)
+    SDL_SemPost(wake);
+}
+
+static int SDLCALL owl_jobWorker(void *data) {
+  s32 self = (s32)(uword_t)data, spins = 0;
+  owl_Job *job;
+
+  SDL_TLSSet(slot, data, NULL);
+
+  while (!SDL_AtomicGet(&quit)) {
+    job = owl_jobTake(self);
+
+    if (job) {
+      owl_jobRun(job);
+      spins = 0;
+      continue;
+    }
+
+    if (++spins < OWL_JOB_SPINS)
+      continue;
+
+    spins = 0;
+
+    /* Announced before the last look, so a push cannot slip past */
+    SDL_AtomicIncRef(&sleepers);
+
+    if (SDL_AtomicGet(&queued) <= 0 && !SDL_AtomicGet(&quit))
+      SDL_SemWait(wake);
+
+    SDL_AtomicAdd(&sleepers, -1);
+  }
+  return 0;
+}
+
+static int SDLCALL owl_jobUrgentWorker(void *data) {
+  owl_Job *job;
+
+  while (!SDL_AtomicGet(&quit)) {
+    SDL_SemWait(urgent_wake);
+
+    while ((job = owl_jobSteal(&urgent)))
+      owl_jobRun(job);
+  }
+  return 0;
+}
+
+static bool owl_jobStart(void) {
+  s32 i, count;
+
+  if (SDL_AtomicGet(&started))
+    return SDL_AtomicGet(&num_workers) > 0;
+
+  SDL_AtomicLock(&starting);
+
+  if (!SDL_AtomicGet(&started)) {
+    count = wanted > 0 ? wanted : SDL_GetCPUCount() - 1;
+
+    if (count < 1)
+      count = 1;
+
+    if (count > OWL_JOB_WORKERS)
+      count = OWL_JOB_WORKERS;
+
+    if (!slot)
+      slot = SDL_TLSCreate();
+
+    deques = (owl_JobDeque *)calloc(count + 1, sizeof(owl_JobDeque));
+    wake = SDL_CreateSemaphore(0);
+    SDL_AtomicSet(&quit, 0);
+
+    /* Worker i owns deque i, so creation stops at the first failure */
+    for (i = 1; slot && deques && wake && i <= count; ++i) {
+      workers[i - 1] =
+          SDL_CreateThread(owl_jobWorker, "owl_job", (void *)(uword_t)i);
+
+      if (!workers[i - 1])
+        break;
+
+      SDL_AtomicAdd(&num_workers, 1);
+    }
+
+    urgent_wake = SDL_CreateSemaphore(0);
+
+    if (urgent_wake)
+      urgent_worker =
+          SDL_CreateThread(owl_jobUrgentWorker, "owl_urgent", NULL);
+
+    SDL_AtomicSet(&started, 1);
+  }
+
+  SDL_AtomicUnlock(&starting);
+  return SDL_AtomicGet(&num_workers) > 0;
+}
+
+bool owl_jobHelp(void) {
+  owl_Job *job = NULL;
+
+  if (SDL_AtomicGet(&started) && SDL_AtomicGet(&num_workers) > 0)
+    job = owl_jobTake(owl_jobSelf());
+
+  if (job)
+    owl_jobRun(job);
+
+  return job != NULL;
+}
+
+void owl_jobQuit(void) {
+  owl_Job *job;
+  s32 i, n;
+
+  if (!SDL_AtomicGet(&started))
+    return;
+
+  n = SDL_AtomicGet(&num_workers);
+
+  SDL_AtomicSet(&quit, 1);
+
+  for (i = 0; i < n; ++i)
+    SDL_SemPost(wake);
+
+  for (i = 0; i < n; ++i)
+    SDL_WaitThread(workers[i], NULL);
+
+  if (urgent_worker) {
+    SDL_SemPost(urgent_wake);
+    SDL_WaitThread(urgent_worker, NULL);
+    urgent_worker = NULL;
+  }
+
+  while ((job = owl_jobSteal(&urgent)))
+    owl_jobRun(job);
+
+  /* Detached jobs may still own resources, so they run to completion */
+  while (n > 0 && (job = owl_jobTake(0)))
+    owl_jobRun(job);
+
+  SDL_AtomicSet(&num_workers, 0);
+
+  if (deques) {
+    free(deques);
+    deques = NULL;
+  }
+
+  if (wake) {
+    SDL_DestroySemaphore(wake);
+    wake = NULL;
+  }
+
+  if (urgent_wake) {
+    SDL_DestroySemaphore(urgent_wake);
+    urgent_wake = NULL;
+  }
+
+  while ((job = pool)) {
+    pool = job->next;
+    free(job);
+  }
+
+  pool_size = 0;
+
+  SDL_AtomicSet(&queued, 0);
+  SDL_AtomicSet(&sleepers, 0);
+  SDL_AtomicSet(&started, 0);
+}
+
+/* Adding a child only succeeds while the parent is still unfinished */
+static bool owl_jobAdopt(owl_Job *parent) {
+  s32 n;
+
+  do {
+    n = SDL_AtomicGet(&parent->unfinished);
+
+    if (n <= 0)
+      return false;
+  } while (!SDL_AtomicCAS(&parent->unfinished, n, n + 1));
+
+  return true;
+}
+
+/*
+ * Without a pool the work still gets done, right here. The job lives on
+ * the stack but counts like any other, so children it spawns keep their
+ * parent and are waited for before it goes out of scope.
+ */
+static void owl_jobInline(owl_JobFunc func, void *ud, owl_Job *parent) {
+  owl_Job job = {0};
+  s32 spins = 0;
+
+  job.func = func;
+  job.ud = ud;
+  job.parent = parent;
+
+  /* One reference more than finishing drops, so it is never recycled */
+  SDL_AtomicSet(&job.unfinished, 1);
+  SDL_AtomicSet(&job.refs, 2);
+
+  if (parent)
+    SDL_AtomicIncRef(&parent->unfinished);
+
+  owl_jobRun(&job);
+
+  /* Whoever finishes it drops that reference last, then leaves it alone */
+  while (SDL_AtomicGet(&job.refs) > 1)
+    if (!owl_jobHelp() && ++spins >= OWL_JOB_SPINS) {
+      SDL_Delay(0);
+      spins = 0;
+    }
+}
+
+/*
+ * A finished parent may be recycled already, so a child for it is
+ * rejected and its function never runs. The parent is held while the
+ * child is attached.
+ */
+bool owl_job(owl_JobFunc func, void *ud, owl_Job *parent, owl_Job **handle) {
+  owl_Job *job;
+
+  if (handle)
+    *handle = NULL;
+
+  if (!func || (parent && !owl_jobAdopt(parent)))
+    return false;
+
+  job = owl_jobStart() ? owl_jobAlloc(func, ud, parent) : NULL;
+
+  if (job) {
+    owl_jobSubmit(job);
+
+    if (handle)
+      *handle = job;
+    else
+      owl_releaseJob(job);
+  } else
+    owl_jobInline(func, ud, parent);
+
+  owl_jobFinish(parent);
+  return true;
+}
+
+/* Never runs inline, the caller may be the audio callback */
+owl_Job *owl_jobUrgent(owl_JobFunc func, void *ud) {
+  owl_Job *job;
+
+  if (!func || !owl_jobStart() || !urgent_worker)
+    return NULL;
+
+  job = owl_jobAlloc(func, ud, NULL);
+
+  if (!job)
+    return NULL;
+
+  if (!owl_jobPush(&urgent, job)) {
+    owl_releaseJob(job);
+    owl_releaseJob(job);
+    return NULL;
+  }
+
+  SDL_SemPost(urgent_wake);
+  return job;
+}
+
+void owl_waitJob(owl_Job *job) {
+  owl_Job *next;
+  s32 self, spins = 0;
+
+  if (!job)
+    return;
+
+  self = owl_jobSelf();
+
+  /* Waiting threads help out instead of blocking */
+  while (SDL_AtomicGet(&job->unfinished) > 0) {
+    next = owl_jobTake(self);
+
+    if (next) {
+      owl_jobRun(next);
+      spins = 0;
+    } else if (++spins >= OWL_JOB_SPINS) {
+      SDL_Delay(0);
+      spins = 0;
+    }
+  }
+
+  owl_releaseJob(job);
+}
+
+void owl_releaseJob(owl_Job *job) {
+  if (!job || !SDL_AtomicDecRef(&job->refs))
+    return;
+
+  SDL_AtomicLock(&pool_lock);
+
+  if (pool_size < OWL_JOB_FREE) {
+    job->next = pool;
+    pool = job;
+    pool_size += 1;
+    job = NULL;
+  }
+
+  SDL_AtomicUnlock(&pool_lock);
+
+  if (job)
+    free(job);
+}
+
+static void owl_jobSplit(owl_JobLoop *loop, owl_Job *parent, s32 first,
+                         s32 last);
+
+static void owl_jobRange(owl_Job *job, void *ud) {
+  owl_jobSplit((owl_JobLoop *)ud, job, job->first, job->last);
+}
+
+/* Hands the upper half to thieves until the range fits in one grain */
+static void owl_jobSplit(owl_JobLoop *loop, owl_Job *parent, s32 first,
+                         s32 last) {
+  owl_Job *child;
+  s32 mid;
+
+  while (last - first > loop->grain) {
+    mid = first + (last - first) / 2;
+    child = owl_jobAlloc(owl_jobRange, loop, parent);
+
+    if (child) {
+      child->first = mid;
+      child->last = last;
+      owl_jobSubmit(child);
+      owl_releaseJob(child);
+    } else
+      owl_jobSplit(loop, parent, mid, last);
+
+    last = mid;
+  }
+
+  loop->func(first, last, loop->ud);
+}
+
+void owl_parallelFor(s32 count, s32 grain, owl_ForFunc func, void *ud) {
+  owl_JobLoop loop;
+  owl_Job *root;
+
+  if (count <= 0 || !func)
+    return;
+
+  root = owl_jobStart() ? owl_jobAlloc(NULL, &loop, NULL) : NULL;
+
+  if (!root) {
+    func(0, count, ud);
+    return;
+  }
+
+  if (grain < 1)
+    grain = count / ((SDL_AtomicGet(&num_workers) + 1) * 8);
+
+  loop.func = func;
+  loop.ud = ud;
+  loop.grain = grain < 1 ? 1 : grain;
+
+  /* The root never runs, the caller splits the range and takes part */
+  owl_jobSplit(&loop, root, 0, count);
+  owl_jobFinish(root);
+  owl_waitJob(root);
+}
+
+void owl_jobWorkers(s32 count) {
+  owl_jobQuit();
+  wanted = count;
+}
+
+s32 owl_jobThreads(void) {
+  owl_jobStart();
+  return SDL_AtomicGet(&num_workers);
+}
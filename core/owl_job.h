@@ -0,0 +1,35 @@
+/*
+ * owl_job.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_JOB_H__
+#define __OWL_JOB_H__
+
+#include "owl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern bool owl_jobHelp(void);
+
+/*
+ * Queued ahead of everything on a thread of its own, for work with a
+ * deadline such as refilling a stream that the audio callback drains.
+ * Returns NULL without running the job when it cannot be queued.
+ */
+extern owl_Job *owl_jobUrgent(owl_JobFunc func, void *ud);
+extern void owl_jobQuit(void);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_JOB_H__ */
@@ -0,0 +1,178 @@
+/*
+ * owl_loop.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include "owl_input.h"
+#include "owl_loop.h"
+
+static owl_Loop owl_current = {.clamp = OWL_LOOP_CLAMP};
+static owl_Loop *loop = &owl_current;
+
+static bool owl_loopStart(u32 hz) {
+  if (hz == 0 || hz > OWL_LOOP_UPPER_LIMIT)
+    return false;
+
+  if (!SDL_AtomicCAS(&loop->running, 0, 1))
+    return false;
+
+  loop->step = SDL_GetPerformanceFrequency() / hz;
+  loop->accumulator = 0;
+  loop->last = SDL_GetPerformanceCounter();
+
+  return true;
+}
+
+/*
+ * Pays the real time since the last call out in fixed steps, and returns
+ * how far the present lies between the last two simulated states.
+ */
+static f64 owl_loopAdvance(owl_UpdateFunc update, f64 dt, void *ud) {
+  u64 now = SDL_GetPerformanceCounter(), frame = now - loop->last;
+
+  loop->last = now;
+
+  /* Past the clamp the simulation slows down rather than spiral */
+  if (frame > loop->step * loop->clamp)
+    frame = loop->step * loop->clamp;
+
+  loop->accumulator += frame;
+
+  while (SDL_AtomicGet(&loop->running) && loop->accumulator >= loop->step) {
+    if (!update(dt, ud))
+      SDL_AtomicSet(&loop->running, 0);
+
+    loop->accumulator -= loop->step;
+  }
+
+  return (f64)loop->accumulator / (f64)loop->step;
+}
+
+/*
+ * Simulation runs in fixed steps, rendering once per frame at whatever
+ * rate owl_wait allows. A slow frame costs rendered frames, never
+ * simulation accuracy.
+ */
+bool owl_loop(u32 hz, owl_UpdateFunc update, owl_RenderFunc render,
+              void *ud) {
+  f64 alpha;
+
+  if (!update || !owl_loopStart(hz))
+    return false;
+
+  while (SDL_AtomicGet(&loop->running)) {
+    alpha = owl_loopAdvance(update, 1.0 / hz, ud);
+
+    if (!SDL_AtomicGet(&loop->running))
+      break;
+
+    if (render)
+      render(alpha, ud);
+
+    owl_present();
+    owl_wait();
+  }
+
+  return true;
+}
+
+static int SDLCALL owl_loopSimulate(void *data) {
+  const owl_Pipeline *pipeline = (const owl_Pipeline *)data;
+  f64 alpha;
+  u32 n = 0;
+
+  for (;;) {
+    SDL_SemWait(loop->vacant);
+
+    if (!SDL_AtomicGet(&loop->running))
+      break;
+
+    alpha = owl_loopAdvance(pipeline->update, 1.0 / pipeline->hz,
+                            pipeline->ud);
+
+    if (!SDL_AtomicGet(&loop->running))
+      break;
+
+    if (pipeline->record)
+      pipeline->record(pipeline->frames[n & 1], alpha, pipeline->ud);
+
+    n += 1;
+    SDL_SemPost(loop->filled);
+  }
+
+  /* Wakes the render thread should it be waiting for a frame */
+  SDL_SemPost(loop->filled);
+  return 0;
+}
+
+/*
+ * The simulation thread records frame N + 1 into one buffer while the
+ * calling thread, which owns the GL context, submits frame N from the
+ * other. Events are pumped here and read there through owl_event.
+ */
+bool owl_pipeline(const owl_Pipeline *pipeline) {
+  SDL_Thread *thread = NULL;
+  u32 n = 0;
+
+  if (!pipeline->update || !pipeline->submit ||
+      !owl_loopStart(pipeline->hz))
+    return false;
+
+  loop->filled = SDL_CreateSemaphore(0);
+  loop->vacant = SDL_CreateSemaphore(2);
+
+  if (loop->filled && loop->vacant) {
+    owl_inputPumped(true);
+    thread = SDL_CreateThread(owl_loopSimulate, "owl_simulate",
+                              (void *)pipeline);
+  }
+
+  while (thread && SDL_AtomicGet(&loop->running)) {
+    SDL_PumpEvents();
+    SDL_SemWait(loop->filled);
+
+    if (!SDL_AtomicGet(&loop->running))
+      break;
+
+    pipeline->submit(pipeline->frames[n & 1], pipeline->ud);
+    n += 1;
+
+    /* The draw calls are issued, so the buffer can be recorded again */
+    SDL_SemPost(loop->vacant);
+
+    owl_present();
+    owl_wait();
+  }
+
+  SDL_AtomicSet(&loop->running, 0);
+
+  if (thread) {
+    SDL_SemPost(loop->vacant);
+    SDL_WaitThread(thread, NULL);
+  }
+
+  owl_inputPumped(false);
+
+  if (loop->filled)
+    SDL_DestroySemaphore(loop->filled);
+
+  if (loop->vacant)
+    SDL_DestroySemaphore(loop->vacant);
+
+  loop->filled = NULL;
+  loop->vacant = NULL;
+
+  return thread != NULL;
+}
+
+void owl_loopClamp(u32 steps) {
+  loop->clamp = steps > 0 ? steps : OWL_LOOP_CLAMP;
+}
+
+void owl_stopLoop(void) { SDL_AtomicSet(&loop->running, 0); }
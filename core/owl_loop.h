@@ -0,0 +1,40 @@
+/*
+ * owl_loop.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_LOOP_H__
+#define __OWL_LOOP_H__
+
+#include "SDL.h"
+
+#include "owl.h"
+
+#define OWL_LOOP_CLAMP 8
+#define OWL_LOOP_UPPER_LIMIT 1000
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct owl_Loop {
+  u64 step;
+  u64 accumulator;
+  u64 last;
+  u32 clamp;
+  SDL_atomic_t running;
+  SDL_sem *filled;
+  SDL_sem *vacant;
+} owl_Loop;
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_LOOP_H__ */
@@ -0,0 +1,209 @@
+/*
+ * owl_lz.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <string.h>
+
+#include "owl_lz.h"
+
+/*
+ * The stream uses the LZ4 block layout: a token with 4-bit literal and
+ * match lengths, 255-run length extensions, literals, and a 16-bit
+ * little-endian offset. The last 5 bytes are always literals.
+ */
+
+#define OWL_LZ_MINMATCH 4
+#define OWL_LZ_LASTLITERALS 5
+#define OWL_LZ_MFLIMIT 12
+#define OWL_LZ_WINDOW 65535
+#define OWL_LZ_HASH_BITS 12
+#define OWL_LZ_RUN 15
+
+OWL_INLINE u32 owl_lzRead32(const u8 *p) {
+  u32 v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+OWL_INLINE u32 owl_lzHash(u32 v) {
+  return (v * 2654435761U) >> (32 - OWL_LZ_HASH_BITS);
+}
+
+OWL_INLINE s32 owl_lzRunBytes(s32 length) {
+  return length >= OWL_LZ_RUN ? (length - OWL_LZ_RUN) / 255 + 1 : 0;
+}
+
+static u8 *owl_lzRun(u8 *op, s32 length) {
+  length -= OWL_LZ_RUN;
+
+  while (length >= 255) {
+    *op++ = 255;
+    length -= 255;
+  }
+
+  *op++ = (u8)length;
+  return op;
+}
+
+static u8 *owl_lzSequence(u8 *op, u8 *oend, const u8 *anchor, s32 literals,
+                          s32 offset, s32 length) {
+  s32 match = length - OWL_LZ_MINMATCH;
+  u8 *token;
+
+  if (oend - op < 1 + owl_lzRunBytes(literals) + literals +
+                      (length ? 2 + owl_lzRunBytes(match) : 0))
+    return NULL;
+
+  token = op++;
+
+  if (literals >= OWL_LZ_RUN) {
+    *token = OWL_LZ_RUN << 4;
+    op = owl_lzRun(op, literals);
+  } else
+    *token = (u8)(literals << 4);
+
+  memcpy(op, anchor, literals);
+  op += literals;
+
+  /* A zero length marks the trailing literal-only sequence */
+  if (!length)
+    return op;
+
+  *op++ = (u8)(offset & 0xFF);
+  *op++ = (u8)(offset >> 8);
+
+  if (match >= OWL_LZ_RUN) {
+    *token |= OWL_LZ_RUN;
+    op = owl_lzRun(op, match);
+  } else
+    *token |= (u8)match;
+
+  return op;
+}
+
+s32 owl_lzBound(s32 size) { return size + size / 255 + 16; }
+
+s32 owl_lzCompress(const u8 *src, s32 size, u8 *dst, s32 capacity) {
+  s32 table[1 << OWL_LZ_HASH_BITS];
+  const u8 *ip = src, *anchor = src, *match, *iend = src + size;
+  const u8 *mflimit = iend - OWL_LZ_MFLIMIT;
+  const u8 *matchlimit = iend - OWL_LZ_LASTLITERALS;
+  u8 *op = dst, *oend = dst + capacity;
+  s32 i, ref, length;
+  u32 h;
+
+  if (size < 0 || capacity <= 0)
+    return 0;
+
+  for (i = 0; i < (1 << OWL_LZ_HASH_BITS); ++i)
+    table[i] = -1;
+
+  while (size > OWL_LZ_MFLIMIT && ip < mflimit) {
+    h = owl_lzHash(owl_lzRead32(ip));
+    ref = table[h];
+    table[h] = (s32)(ip - src);
+
+    if (ref < 0 || ip - (src + ref) > OWL_LZ_WINDOW ||
+        owl_lzRead32(src + ref) != owl_lzRead32(ip)) {
+      ip += 1;
+      continue;
+    }
+
+    match = src + ref;
+
+    while (ip > anchor && match > src && ip[-1] == match[-1])
+      ip -= 1, match -= 1;
+
+    length = OWL_LZ_MINMATCH;
+
+    while (ip + length < matchlimit && ip[length] == match[length])
+      length += 1;
+
+    op = owl_lzSequence(op, oend, anchor, (s32)(ip - anchor),
+                        (s32)(ip - match), length);
+
+    if (!op)
+      return 0;
+
+    ip += length;
+    anchor = ip;
+  }
+
+  op = owl_lzSequence(op, oend, anchor, (s32)(iend - anchor), 0, 0);
+  return op ? (s32)(op - dst) : 0;
+}
+
+s32 owl_lzDecompress(const u8 *src, s32 size, u8 *dst, s32 capacity) {
+  const u8 *ip = src, *iend = src + size, *match;
+  u8 *op = dst, *oend = dst + capacity;
+  size_t literals, length, offset;
+  u8 token, s;
+
+  while (ip < iend) {
+    token = *ip++;
+    literals = token >> 4;
+
+    if (literals == OWL_LZ_RUN)
+      do {
+        if (ip >= iend)
+          return -1;
+
+        s = *ip++;
+        literals += s;
+      } while (s == 255);
+
+    if (literals > (size_t)(iend - ip) || literals > (size_t)(oend - op))
+      return -1;
+
+    memcpy(op, ip, literals);
+    op += literals;
+    ip += literals;
+
+    if (ip >= iend)
+      break;
+
+    if (iend - ip < 2)
+      return -1;
+
+    offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+
+    if (offset == 0 || offset > (size_t)(op - dst))
+      return -1;
+
+    length = token & OWL_LZ_RUN;
+
+    if (length == OWL_LZ_RUN)
+      do {
+        if (ip >= iend)
+          return -1;
+
+        s = *ip++;
+        length += s;
+      } while (s == 255);
+
+    length += OWL_LZ_MINMATCH;
+
+    if (length > (size_t)(oend - op))
+      return -1;
+
+    match = op - offset;
+
+    /* Overlapping matches repeat the last offset bytes */
+    if (offset >= length) {
+      memcpy(op, match, length);
+      op += length;
+    } else
+      while (length--)
+        *op++ = *match++;
+  }
+
+  return (s32)(op - dst);
+}
@@ -0,0 +1,29 @@
+/*
+ * owl_lz.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_LZ_H__
+#define __OWL_LZ_H__
+
+#include "owl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern s32 owl_lzBound(s32 size);
+extern s32 owl_lzCompress(const u8 *src, s32 size, u8 *dst, s32 capacity);
+extern s32 owl_lzDecompress(const u8 *src, s32 size, u8 *dst, s32 capacity);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_LZ_H__ */
@@ -0,0 +1,427 @@
+/*
+ * owl_mesh.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "owl_mesh.h"
+#include "owl_render.h"
+
+struct owl_Mesh {
+  owl_Vertex *vertices;
+  u16 *indices;
+  s32 num_vertices, max_vertices;
+  s32 num_indices, max_indices;
+  owl_Vertex *scratch;
+  s32 max_scratch;
+};
+
+static bool owl_meshGrow(void **array, s32 *capacity, s32 wanted, s32 unit) {
+  void *grown;
+  s32 n = *capacity ? *capacity : 64;
+
+  if (wanted <= *capacity)
+    return true;
+
+  while (n < wanted)
+    n *= 2;
+
+  grown = realloc(*array, (size_t)n * unit);
+
+  if (!grown)
+    return false;
+
+  *array = grown;
+  *capacity = n;
+  return true;
+}
+
+/* Room for a piece, whose indices are relative to the returned base */
+static owl_Vertex *owl_meshAlloc(owl_Mesh *mesh, s32 num_vertices,
+                                 s32 num_indices, u16 **indices, u16 *base) {
+  owl_Vertex *vertices;
+  owl_Pixel color = owl_drawColor();
+  s32 i;
+
+  if (mesh->num_vertices + num_vertices > OWL_MESH_VERTICES)
+    return NULL;
+
+  if (!owl_meshGrow((void **)&mesh->vertices, &mesh->max_vertices,
+                    mesh->num_vertices + num_vertices, sizeof(owl_Vertex)) ||
+      !owl_meshGrow((void **)&mesh->indices, &mesh->max_indices,
+                    mesh->num_indices + num_indices, sizeof(u16)))
+    return NULL;
+
+  vertices = mesh->vertices + mesh->num_vertices;
+  *indices = mesh->indices + mesh->num_indices;
+  *base = (u16)mesh->num_vertices;
+
+  for (i = 0; i < num_vertices; ++i) {
+    vertices[i].uv.x = 0.0f;
+    vertices[i].uv.y = 0.0f;
+    vertices[i].color = color;
+  }
+
+  mesh->num_vertices += num_vertices;
+  mesh->num_indices += num_indices;
+  return vertices;
+}
+
+s32 owl_meshSegments(f32 radius, f32 degrees) {
+  f64 step;
+  s32 n;
+
+  if (radius <= OWL_MESH_TOLERANCE)
+    return 3;
+
+  /* Each chord may stray from the curve by the tolerance at most */
+  step = 2.0 * acos(1.0 - OWL_MESH_TOLERANCE / radius);
+  n = (s32)ceil(fabs(degrees) * OWL_RAD / step);
+
+  return n < 3 ? 3 : (n > OWL_MESH_SEGMENTS ? OWL_MESH_SEGMENTS : n);
+}
+
+/* Filled ring between two radii, or a fan when there is no inner one */
+static bool owl_meshRing(owl_Mesh *mesh, f32 x, f32 y, f32 inner, f32 outer,
+                         f32 start_angle, f32 end_angle) {
+  owl_Vertex *v;
+  u16 *idx, base;
+  f32 sweep = end_angle - start_angle, a;
+  s32 i, n, ring;
+
+  if (sweep > 360.0f)
+    sweep = 360.0f;
+  else if (sweep < -360.0f)
+    sweep = -360.0f;
+
+  n = owl_meshSegments(outer, sweep);
+  ring = inner > 0.0f ? 2 : 1;
+  v = owl_meshAlloc(mesh, (n + 1) * ring + (2 - ring), n * 3 * ring, &idx,
+                    &base);
+
+  if (!v)
+    return false;
+
+  for (i = 0; i <= n; ++i) {
+    a = (f32)((start_angle + sweep * i / n) * OWL_RAD);
+
+    v[i].position.x = x + outer * cosf(a);
+    v[i].position.y = y + outer * sinf(a);
+
+    if (ring == 2) {
+      v[n + 1 + i].position.x = x + inner * cosf(a);
+      v[n + 1 + i].position.y = y + inner * sinf(a);
+    }
+  }
+
+  if (ring == 1) {
+    v[n + 1].position.x = x;
+    v[n + 1].position.y = y;
+
+    for (i = 0; i < n; ++i) {
+      *idx++ = (u16)(base + n + 1);
+      *idx++ = (u16)(base + i);
+      *idx++ = (u16)(base + i + 1);
+    }
+    return true;
+  }
+
+  for (i = 0; i < n; ++i) {
+    *idx++ = (u16)(base + i);
+    *idx++ = (u16)(base + i + 1);
+    *idx++ = (u16)(base + n + 1 + i);
+    *idx++ = (u16)(base + n + 1 + i);
+    *idx++ = (u16)(base + i + 1);
+    *idx++ = (u16)(base + n + 2 + i);
+  }
+  return true;
+}
+
+/* Convex outlines are filled as a fan from their first vertex */
+static void owl_meshFan(u16 *idx, u16 base, s32 count) {
+  s32 i;
+
+  for (i = 1; i + 1 < count; ++i) {
+    *idx++ = base;
+    *idx++ = (u16)(base + i);
+    *idx++ = (u16)(base + i + 1);
+  }
+}
+
+OWL_INLINE f32 owl_meshCross(const owl_Point *a, const owl_Point *b,
+                             const owl_Point *c) {
+  return (b->x - a->x) * (c->y - a->y) - (b->y - a->y) * (c->x - a->x);
+}
+
+static bool owl_meshEar(const owl_Point *points, const s32 *next, s32 p,
+                        s32 v, s32 q, f32 sign) {
+  const owl_Point *a = &points[p], *b = &points[v], *c = &points[q];
+  s32 r;
+
+  if (owl_meshCross(a, b, c) * sign <= 0.0f)
+    return false;
+
+  for (r = next[q]; r != p; r = next[r])
+    if (owl_meshCross(a, b, &points[r]) * sign >= 0.0f &&
+        owl_meshCross(b, c, &points[r]) * sign >= 0.0f &&
+        owl_meshCross(c, a, &points[r]) * sign >= 0.0f)
+      return false;
+
+  return true;
+}
+
+owl_Mesh *owl_mesh(void) {
+  return (owl_Mesh *)calloc(1, sizeof(owl_Mesh));
+}
+
+void owl_freeMesh(owl_Mesh *mesh) {
+  if (!mesh)
+    return;
+
+  free(mesh->vertices);
+  free(mesh->indices);
+  free(mesh->scratch);
+  free(mesh);
+}
+
+void owl_clearMesh(owl_Mesh *mesh) {
+  mesh->num_vertices = 0;
+  mesh->num_indices = 0;
+}
+
+bool owl_meshFillRect(owl_Mesh *mesh, f32 x, f32 y, f32 w, f32 h) {
+  owl_Point points[4] = {{0}};
+
+  points[0].x = x, points[0].y = y;
+  points[1].x = x + w, points[1].y = y;
+  points[2].x = x + w, points[2].y = y + h;
+  points[3].x = x, points[3].y = y + h;
+
+  return owl_meshFillPolygon(mesh, points, 4);
+}
+
+bool owl_meshFillArc(owl_Mesh *mesh, f32 x, f32 y, f32 radius,
+                     f32 start_angle, f32 end_angle) {
+  return owl_meshRing(mesh, x, y, 0.0f, radius, start_angle, end_angle);
+}
+
+bool owl_meshFillCircle(owl_Mesh *mesh, f32 x, f32 y, f32 radius) {
+  return owl_meshRing(mesh, x, y, 0.0f, radius, 0.0f, 360.0f);
+}
+
+bool owl_meshFillEllipse(owl_Mesh *mesh, f32 x, f32 y, f32 rx, f32 ry,
+                         f32 degrees) {
+  owl_Vertex *v;
+  u16 *idx, base;
+  f32 cosr = cosf((f32)(degrees * OWL_RAD));
+  f32 sinr = sinf((f32)(degrees * OWL_RAD));
+  f32 a, ex, ey;
+  s32 i, n = owl_meshSegments(rx > ry ? rx : ry, 360.0f);
+
+  v = owl_meshAlloc(mesh, n, (n - 2) * 3, &idx, &base);
+
+  if (!v)
+    return false;
+
+  for (i = 0; i < n; ++i) {
+    a = (f32)(2.0 * OWL_PI * i / n);
+    ex = rx * cosf(a);
+    ey = ry * sinf(a);
+
+    v[i].position.x = x + ex * cosr - ey * sinr;
+    v[i].position.y = y + ex * sinr + ey * cosr;
+  }
+
+  owl_meshFan(idx, base, n);
+  return true;
+}
+
+bool owl_meshFillSector(owl_Mesh *mesh, f32 x, f32 y, f32 inner_radius,
+                        f32 outer_radius, f32 start_angle, f32 end_angle) {
+  f32 t;
+
+  if (inner_radius > outer_radius) {
+    t = inner_radius;
+    inner_radius = outer_radius;
+    outer_radius = t;
+  }
+
+  return owl_meshRing(mesh, x, y, inner_radius, outer_radius, start_angle,
+                      end_angle);
+}
+
+bool owl_meshFillTrigon(owl_Mesh *mesh, f32 x1, f32 y1, f32 x2, f32 y2,
+                        f32 x3, f32 y3) {
+  owl_Vertex *v;
+  u16 *idx, base;
+
+  v = owl_meshAlloc(mesh, 3, 3, &idx, &base);
+
+  if (!v)
+    return false;
+
+  v[0].position.x = x1, v[0].position.y = y1;
+  v[1].position.x = x2, v[1].position.y = y2;
+  v[2].position.x = x3, v[2].position.y = y3;
+
+  owl_meshFan(idx, base, 3);
+  return true;
+}
+
+bool owl_meshFillRectRound(owl_Mesh *mesh, f32 x, f32 y, f32 w, f32 h,
+                           f32 radius) {
+  static const f32 cx[4] = {1, 0, 0, 1}, cy[4] = {1, 1, 0, 0};
+  owl_Vertex *v;
+  u16 *idx, base;
+  f32 a, px, py;
+  s32 i, k, n;
+
+  if (radius > w * 0.5f)
+    radius = w * 0.5f;
+
+  if (radius > h * 0.5f)
+    radius = h * 0.5f;
+
+  if (radius <= 0.0f)
+    return owl_meshFillRect(mesh, x, y, w, h);
+
+  /* Quarter circles at each corner, clockwise from the bottom right */
+  n = owl_meshSegments(radius, 90.0f);
+  v = owl_meshAlloc(mesh, (n + 1) * 4, ((n + 1) * 4 - 2) * 3, &idx, &base);
+
+  if (!v)
+    return false;
+
+  for (k = 0; k < 4; ++k) {
+    px = x + radius + cx[k] * (w - radius * 2);
+    py = y + radius + cy[k] * (h - radius * 2);
+
+    for (i = 0; i <= n; ++i, ++v) {
+      a = (f32)((k * 90.0f + 90.0f * i / n) * OWL_RAD);
+      v->position.x = px + radius * cosf(a);
+      v->position.y = py + radius * sinf(a);
+    }
+  }
+
+  owl_meshFan(idx, base, (n + 1) * 4);
+  return true;
+}
+
+/* Ear clipping, clipping anyway when a self-intersection leaves no ear */
+bool owl_meshFillPolygon(owl_Mesh *mesh, const owl_Point *points,
+                         s32 num_points) {
+  owl_Vertex *v;
+  u16 *idx, base;
+  s32 *prev, *next, i, p, q, left, misses = 0;
+  f32 area = 0.0f, sign;
+
+  if (!points || num_points < 3)
+    return false;
+
+  prev = (s32 *)malloc(num_points * 2 * sizeof(s32));
+
+  if (!prev)
+    return false;
+
+  v = owl_meshAlloc(mesh, num_points, (num_points - 2) * 3, &idx, &base);
+
+  if (!v) {
+    free(prev);
+    return false;
+  }
+
+  next = prev + num_points;
+
+  for (i = 0; i < num_points; ++i) {
+    v[i].position = points[i];
+    prev[i] = (i + num_points - 1) % num_points;
+    next[i] = (i + 1) % num_points;
+    area += owl_meshCross(&points[0], &points[i], &points[next[i]]);
+  }
+
+  sign = area < 0.0f ? -1.0f : 1.0f;
+
+  for (i = 0, left = num_points; left > 3;) {
+    p = prev[i];
+    q = next[i];
+
+    if (misses < left && !owl_meshEar(points, next, p, i, q, sign)) {
+      i = q;
+      misses += 1;
+      continue;
+    }
+
+    *idx++ = (u16)(base + p);
+    *idx++ = (u16)(base + i);
+    *idx++ = (u16)(base + q);
+
+    next[p] = q;
+    prev[q] = p;
+    left -= 1;
+    misses = 0;
+    i = q;
+  }
+
+  *idx++ = (u16)(base + prev[i]);
+  *idx++ = (u16)(base + i);
+  *idx++ = (u16)(base + next[i]);
+
+  free(prev);
+  return true;
+}
+
+void owl_drawMesh(owl_Mesh *mesh, const owl_Matrix *transform,
+                  owl_Pixel tint) {
+  const owl_Vertex *from;
+  owl_Vertex *to;
+  f32 x, y;
+  s32 i;
+
+  if (!mesh || mesh->num_indices == 0)
+    return;
+
+  /* Untransformed and untinted meshes go out as they are */
+  if (!transform && tint.rgba == 0xFFFFFFFF) {
+    owl_geometry(NULL, OWL_GEOMETRY_TRIANGLES, mesh->vertices,
+                 mesh->num_vertices, mesh->indices, mesh->num_indices);
+    return;
+  }
+
+  if (!owl_meshGrow((void **)&mesh->scratch, &mesh->max_scratch,
+                    mesh->num_vertices, sizeof(owl_Vertex)))
+    return;
+
+  from = mesh->vertices;
+  to = mesh->scratch;
+
+  for (i = 0; i < mesh->num_vertices; ++i, ++from, ++to) {
+    *to = *from;
+
+    if (transform) {
+      x = from->position.x;
+      y = from->position.y;
+
+      to->position.x = (f32)(transform->a * x + transform->c * y +
+                             transform->tx);
+      to->position.y = (f32)(transform->b * x + transform->d * y +
+                             transform->ty);
+    }
+
+    to->color.r = (u8)((from->color.r * tint.r + 127) / 255);
+    to->color.g = (u8)((from->color.g * tint.g + 127) / 255);
+    to->color.b = (u8)((from->color.b * tint.b + 127) / 255);
+    to->color.a = (u8)((from->color.a * tint.a + 127) / 255);
+  }
+
+  owl_geometry(NULL, OWL_GEOMETRY_TRIANGLES, mesh->scratch,
+               mesh->num_vertices, mesh->indices, mesh->num_indices);
+}
@@ -0,0 +1,32 @@
+/*
+ * owl_mesh.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_MESH_H__
+#define __OWL_MESH_H__
+
+#include "owl.h"
+
+/* Largest gap between a curve and its chords, in pixels */
+#define OWL_MESH_TOLERANCE 0.25
+#define OWL_MESH_SEGMENTS 256
+#define OWL_MESH_VERTICES 0xFFFF
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern s32 owl_meshSegments(f32 radius, f32 degrees);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_MESH_H__ */
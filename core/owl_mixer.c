@@ -0,0 +1,457 @@
+/*
+ * owl_mixer.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "owl_mixer.h"
+#include "owl_platform.h"
+
+#if OWL_SSE2
+#include <emmintrin.h>
+#elif OWL_NEON
+#include <arm_neon.h>
+#endif
+
+#define OWL_MIXER_CHUNK 4096
+
+#define OWL_VOICE_BITS 8
+#define OWL_VOICE_MASK ((1 << OWL_VOICE_BITS) - 1)
+
+typedef struct owl_MixVoice {
+  const void *owner;
+  u32 generation;
+  u64 started;
+  const u8 *buffer;
+  u32 size;
+  u32 cursor;
+  SDL_AudioStream *stream;
+  owl_MixRead read;
+  void *source;
+  f32 gain;
+  bool active;
+  bool paused;
+} owl_MixVoice;
+
+static SDL_AudioDeviceID device = 0;
+static SDL_AudioSpec output;
+static owl_MixVoice voices[OWL_MIXER_VOICES];
+static s32 voice_limit = OWL_MIXER_VOICES;
+static u64 sequence = 0;
+static f32 *scratch = NULL;
+static s32 scratch_size = 0;
+
+static void owl_mixAdd(f32 *dst, const f32 *src, f32 gain, s32 n) {
+  s32 i = 0;
+
+#if OWL_SSE2
+  __m128 g = _mm_set1_ps(gain);
+
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i),
+                                      _mm_mul_ps(_mm_loadu_ps(src + i), g)));
+#elif OWL_NEON
+  float32x4_t g = vdupq_n_f32(gain);
+
+  for (; i + 4 <= n; i += 4)
+    vst1q_f32(dst + i, vmlaq_f32(vld1q_f32(dst + i), vld1q_f32(src + i), g));
+#endif
+
+  for (; i < n; ++i)
+    dst[i] += src[i] * gain;
+}
+
+static void owl_mixClamp(f32 *dst, s32 n) {
+  s32 i = 0;
+
+#if OWL_SSE2
+  __m128 lo = _mm_set1_ps(-1.0f), hi = _mm_set1_ps(1.0f);
+
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(dst + i,
+                  _mm_min_ps(_mm_max_ps(_mm_loadu_ps(dst + i), lo), hi));
+#elif OWL_NEON
+  float32x4_t lo = vdupq_n_f32(-1.0f), hi = vdupq_n_f32(1.0f);
+
+  for (; i + 4 <= n; i += 4)
+    vst1q_f32(dst + i, vminq_f32(vmaxq_f32(vld1q_f32(dst + i), lo), hi));
+#endif
+
+  for (; i < n; ++i)
+    dst[i] = dst[i] < -1.0f ? -1.0f : (dst[i] > 1.0f ? 1.0f : dst[i]);
+}
+
+/* Returns up to n output samples, converting through the voice's stream */
+static const f32 *owl_voicePull(owl_MixVoice *voice, s32 n, s32 *got,
+                                bool *ended) {
+  s32 bytes = n * (s32)sizeof(f32);
+  u32 chunk;
+
+  /* A source may come up short without ending, that is an underrun */
+  if (voice->read) {
+    *got = voice->read(voice->source, scratch, n);
+    *ended = *got < 0;
+
+    if (*got < 0)
+      *got = 0;
+
+    return scratch;
+  }
+
+  if (!voice->stream) {
+    chunk = voice->size - voice->cursor;
+
+    if (chunk > (u32)bytes)
+      chunk = (u32)bytes;
+
+    *got = (s32)(chunk / sizeof(f32));
+    *ended = *got < n;
+    voice->cursor += chunk;
+
+    return (const f32 *)(voice->buffer + voice->cursor - chunk);
+  }
+
+  while (SDL_AudioStreamAvailable(voice->stream) < bytes &&
+         voice->cursor < voice->size) {
+    chunk = voice->size - voice->cursor;
+
+    if (chunk > OWL_MIXER_CHUNK)
+      chunk = OWL_MIXER_CHUNK;
+
+    SDL_AudioStreamPut(voice->stream, voice->buffer + voice->cursor, chunk);
+    voice->cursor += chunk;
+
+    if (voice->cursor >= voice->size)
+      SDL_AudioStreamFlush(voice->stream);
+  }
+
+  bytes = SDL_AudioStreamGet(voice->stream, scratch, bytes);
+  *got = bytes > 0 ? bytes / (s32)sizeof(f32) : 0;
+  *ended = *got < n;
+
+  return scratch;
+}
+
+static void SDLCALL owl_mixerCallback(void *userdata, u8 *stream, int len) {
+  s32 n = len / (s32)sizeof(f32);
+  owl_MixVoice *voice;
+  const f32 *samples;
+  bool ended;
+  s32 i, got;
+
+  memset(stream, 0, len);
+
+  if (n > scratch_size)
+    n = scratch_size;
+
+  for (i = 0; i < OWL_MIXER_VOICES; ++i) {
+    voice = &voices[i];
+
+    if (!voice->active || voice->paused)
+      continue;
+
+    samples = owl_voicePull(voice, n, &got, &ended);
+    owl_mixAdd((f32 *)stream, samples, voice->gain, got);
+
+    if (ended)
+      voice->active = false;
+  }
+
+  owl_mixClamp((f32 *)stream, n);
+}
+
+static owl_MixVoice *owl_voice(owl_Voice handle) {
+  u32 index = handle & OWL_VOICE_MASK;
+  owl_MixVoice *voice;
+
+  if (!handle || index >= OWL_MIXER_VOICES)
+    return NULL;
+
+  voice = &voices[index];
+
+  if (!voice->active || voice->generation != (handle >> OWL_VOICE_BITS))
+    return NULL;
+
+  return voice;
+}
+
+/* Quietest voice first, the oldest one breaks ties */
+static bool owl_voiceQuieter(owl_MixVoice *a, owl_MixVoice *b) {
+  if (a->gain != b->gain)
+    return a->gain < b->gain;
+
+  return a->started < b->started;
+}
+
+static owl_MixVoice *owl_voiceSlot(const void *owner, s32 limit) {
+  owl_MixVoice *free_slot = NULL, *owned = NULL, *victim = NULL;
+  s32 i, active = 0, count = 0;
+
+  for (i = 0; i < OWL_MIXER_VOICES; ++i) {
+    owl_MixVoice *voice = &voices[i];
+
+    if (!voice->active) {
+      if (!free_slot)
+        free_slot = voice;
+      continue;
+    }
+
+    active += 1;
+
+    /* Sources such as music are never stolen to make room for others */
+    if (!voice->read && (!victim || owl_voiceQuieter(voice, victim)))
+      victim = voice;
+
+    if (voice->owner == owner) {
+      count += 1;
+
+      if (!owned || owl_voiceQuieter(voice, owned))
+        owned = voice;
+    }
+  }
+
+  if (limit > 0 && count >= limit)
+    return owned;
+
+  if (active >= voice_limit || !free_slot)
+    return victim;
+
+  return free_slot;
+}
+
+bool owl_mixerInit(void) {
+  SDL_AudioSpec spec = {0};
+
+  if (device)
+    return true;
+
+  spec.freq = OWL_MIXER_FREQ;
+  spec.format = AUDIO_F32SYS;
+  spec.channels = OWL_MIXER_CHANNELS;
+  spec.samples = OWL_MIXER_SAMPLES;
+  spec.callback = owl_mixerCallback;
+
+  scratch_size = OWL_MIXER_SAMPLES * OWL_MIXER_CHANNELS;
+  scratch = (f32 *)malloc(scratch_size * sizeof(f32));
+
+  if (!scratch)
+    return false;
+
+  /* Without allowed changes SDL converts to whatever the hardware wants */
+  device = SDL_OpenAudioDevice(NULL, 0, &spec, &output, 0);
+
+  if (!device) {
+    free(scratch);
+    scratch = NULL;
+    return false;
+  }
+
+  SDL_PauseAudioDevice(device, 0);
+  return true;
+}
+
+void owl_mixerQuit(void) {
+  s32 i;
+
+  if (device) {
+    SDL_CloseAudioDevice(device);
+    device = 0;
+  }
+
+  for (i = 0; i < OWL_MIXER_VOICES; ++i)
+    if (voices[i].stream)
+      SDL_FreeAudioStream(voices[i].stream);
+
+  memset(voices, 0, sizeof(voices));
+  voice_limit = OWL_MIXER_VOICES;
+  sequence = 0;
+
+  if (scratch) {
+    free(scratch);
+    scratch = NULL;
+    scratch_size = 0;
+  }
+}
+
+static owl_Voice owl_mixerStart(const void *owner, s32 limit,
+                                const u8 *buffer, u32 size,
+                                SDL_AudioStream *stream, owl_MixRead read,
+                                void *source, f32 gain) {
+  SDL_AudioStream *unused;
+  owl_MixVoice *voice;
+  owl_Voice handle;
+
+  SDL_LockAudioDevice(device);
+
+  voice = owl_voiceSlot(owner, limit);
+
+  if (!voice) {
+    SDL_UnlockAudioDevice(device);
+
+    if (stream)
+      SDL_FreeAudioStream(stream);
+
+    return 0;
+  }
+
+  unused = voice->stream;
+
+  /* Generation 0 never occurs so no live handle is 0 */
+  voice->generation = (voice->generation + 1) & (0xFFFFFFFF >> OWL_VOICE_BITS);
+
+  if (!voice->generation)
+    voice->generation = 1;
+
+  voice->owner = owner;
+  voice->started = ++sequence;
+  voice->buffer = buffer;
+  voice->size = size;
+  voice->cursor = 0;
+  voice->stream = stream;
+  voice->read = read;
+  voice->source = source;
+  voice->gain = gain;
+  voice->paused = false;
+  voice->active = true;
+
+  handle = (voice->generation << OWL_VOICE_BITS) | (u32)(voice - voices);
+
+  SDL_UnlockAudioDevice(device);
+
+  if (unused)
+    SDL_FreeAudioStream(unused);
+
+  return handle;
+}
+
+const SDL_AudioSpec *owl_mixerSpec(void) { return device ? &output : NULL; }
+
+owl_Voice owl_mixerPlay(const void *owner, s32 limit,
+                        const SDL_AudioSpec *spec, const u8 *buffer, u32 size,
+                        f32 gain) {
+  SDL_AudioStream *stream = NULL;
+
+  if (!device)
+    return 0;
+
+  if (spec->freq != output.freq || spec->format != output.format ||
+      spec->channels != output.channels) {
+    stream = SDL_NewAudioStream(spec->format, spec->channels, spec->freq,
+                                output.format, output.channels, output.freq);
+    if (!stream)
+      return 0;
+  }
+
+  return owl_mixerStart(owner, limit, buffer, size, stream, NULL, NULL, gain);
+}
+
+owl_Voice owl_mixerSource(const void *owner, s32 limit, owl_MixRead read,
+                          void *source, f32 gain) {
+  if (!device)
+    return 0;
+
+  return owl_mixerStart(owner, limit, NULL, 0, NULL, read, source, gain);
+}
+
+void owl_mixerLimit(s32 limit) {
+  if (limit <= 0 || limit > OWL_MIXER_VOICES)
+    limit = OWL_MIXER_VOICES;
+
+  voice_limit = limit;
+}
+
+void owl_mixerGain(owl_Voice handle, f32 gain) {
+  owl_MixVoice *voice;
+
+  if (!device)
+    return;
+
+  SDL_LockAudioDevice(device);
+
+  if (!!(voice = owl_voice(handle)))
+    voice->gain = gain;
+
+  SDL_UnlockAudioDevice(device);
+}
+
+void owl_mixerStopVoice(owl_Voice handle) {
+  owl_MixVoice *voice;
+
+  if (!device)
+    return;
+
+  SDL_LockAudioDevice(device);
+
+  if (!!(voice = owl_voice(handle)))
+    voice->active = false;
+
+  SDL_UnlockAudioDevice(device);
+}
+
+bool owl_mixerVoicePlaying(owl_Voice handle) {
+  bool playing;
+
+  if (!device)
+    return false;
+
+  SDL_LockAudioDevice(device);
+  playing = owl_voice(handle) != NULL;
+  SDL_UnlockAudioDevice(device);
+
+  return playing;
+}
+
+void owl_mixerStop(const void *owner) {
+  s32 i;
+
+  if (!device)
+    return;
+
+  SDL_LockAudioDevice(device);
+
+  for (i = 0; i < OWL_MIXER_VOICES; ++i)
+    if (!owner || voices[i].owner == owner)
+      voices[i].active = false;
+
+  SDL_UnlockAudioDevice(device);
+}
+
+void owl_mixerPause(const void *owner, bool paused) {
+  s32 i;
+
+  if (!device)
+    return;
+
+  SDL_LockAudioDevice(device);
+
+  for (i = 0; i < OWL_MIXER_VOICES; ++i)
+    if (!owner || voices[i].owner == owner)
+      voices[i].paused = paused;
+
+  SDL_UnlockAudioDevice(device);
+}
+
+bool owl_mixerPlaying(const void *owner) {
+  bool playing = false;
+  s32 i;
+
+  if (!device)
+    return false;
+
+  SDL_LockAudioDevice(device);
+
+  for (i = 0; i < OWL_MIXER_VOICES && !playing; ++i)
+    if (voices[i].active && (!owner || voices[i].owner == owner))
+      playing = true;
+
+  SDL_UnlockAudioDevice(device);
+  return playing;
+}
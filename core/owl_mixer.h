@@ -0,0 +1,54 @@
+/*
+ * owl_mixer.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_MIXER_H__
+#define __OWL_MIXER_H__
+
+#include "SDL.h"
+
+#include "owl.h"
+
+#define OWL_MIXER_FREQ 48000
+#define OWL_MIXER_CHANNELS 2
+#define OWL_MIXER_SAMPLES 1024
+#define OWL_MIXER_VOICES 32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Called on the audio thread, returns samples written or -1 at the end */
+typedef s32 (*owl_MixRead)(void *source, f32 *samples, s32 n);
+
+extern bool owl_mixerInit(void);
+extern void owl_mixerQuit(void);
+
+extern owl_Voice owl_mixerPlay(const void *owner, s32 limit,
+                               const SDL_AudioSpec *spec, const u8 *buffer,
+                               u32 size, f32 gain);
+extern owl_Voice owl_mixerSource(const void *owner, s32 limit,
+                                 owl_MixRead read, void *source, f32 gain);
+extern const SDL_AudioSpec *owl_mixerSpec(void);
+extern void owl_mixerLimit(s32 limit);
+
+extern void owl_mixerGain(owl_Voice handle, f32 gain);
+extern void owl_mixerStopVoice(owl_Voice handle);
+extern bool owl_mixerVoicePlaying(owl_Voice handle);
+
+extern void owl_mixerStop(const void *owner);
+extern void owl_mixerPause(const void *owner, bool paused);
+extern bool owl_mixerPlaying(const void *owner);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_MIXER_H__ */
@@ -0,0 +1,86 @@
+/*
+ * owl_pak.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_PAK_H__
+#define __OWL_PAK_H__
+
+#include "owl.h"
+
+/*
+ * An .owlpak is laid out as: header, entries sorted by name, perfect hash
+ * slots, bucket displacements, the name blob, then 4 KB aligned payloads.
+ * All fields are little-endian and every offset is from the file start.
+ */
+
+#define OWL_PAK_MAGIC 0x4B504C4F /* "OLPK" */
+#define OWL_PAK_VERSION 1
+#define OWL_PAK_ALIGN 4096
+#define OWL_PAK_BUCKET 4
+
+#define OWL_PAK_RAW 0
+#define OWL_PAK_LZ 1
+
+/* A displacement with this bit set names the slot of a lone key */
+#define OWL_PAK_DIRECT 0x80000000U
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct owl_PakHeader {
+  u32 magic;
+  u32 version;
+  u32 count;
+  u32 buckets;
+  u32 entries;
+  u32 slots;
+  u32 displace;
+  u32 names;
+} owl_PakHeader;
+
+typedef struct owl_PakEntry {
+  u64 offset;
+  u32 size;
+  u32 packed;
+  u32 name;
+  u16 length;
+  u16 codec;
+  u32 hash;
+  u32 reserved;
+} owl_PakEntry;
+
+OWL_INLINE u32 owl_pakHash(const char *name, u32 length, u32 seed) {
+  u32 i, h = 2166136261U ^ (seed * 0x9E3779B1U);
+
+  for (i = 0; i < length; ++i)
+    h = (h ^ (u8)name[i]) * 16777619U;
+
+  h ^= h >> 16;
+  h *= 0x85EBCA6BU;
+  h ^= h >> 13;
+  return h;
+}
+
+OWL_INLINE u32 owl_pakSlot(const u32 *displace, u32 buckets, u32 count,
+                           const char *name, u32 length, u32 hash) {
+  u32 d = displace[hash % buckets];
+
+  if (d & OWL_PAK_DIRECT)
+    return d & ~OWL_PAK_DIRECT;
+
+  return owl_pakHash(name, length, d) % count;
+}
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_PAK_H__ */
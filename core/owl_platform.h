@@ -14,6 +14,13 @@
 
 #include "owl.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) ||             \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OWL_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define OWL_NEON 1
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -0,0 +1,37 @@
+/*
+ * owl_render.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_RENDER_H__
+#define __OWL_RENDER_H__
+
+#include "SDL_gpu.h"
+
+#include "owl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern GPU_Target *owl_renderTarget(void);
+extern owl_Pixel owl_drawColor(void);
+extern u8 *owl_decodeImage(const char *filename, s32 *w, s32 *h, s32 *format,
+                           s32 channels, u16 *flags);
+extern void owl_imageFlags(owl_Canvas *canvas, u16 flags);
+
+/* Decoded pixels become a texture, or a region of the loading atlas */
+extern owl_Canvas *owl_loadPixels(const u8 *pixels, s32 w, s32 h, s32 format,
+                                  const owl_Pixel *colorkey, u16 flags);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_RENDER_H__ */
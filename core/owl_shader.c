@@ -0,0 +1,200 @@
+/*
+ * owl_shader.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "owl_shader.h"
+
+/*
+ * Single channel coverage textures sample as (0, 0, 0, a), so the default
+ * shader would turn them black. This one takes rgb from the vertex color and
+ * multiplies only alpha by the texel.
+ */
+
+static const char *vertex_source =
+    "%s\n"
+    "%s vec2 gpu_Vertex;\n"
+    "%s vec2 gpu_TexCoord;\n"
+    "%s vec4 gpu_Color;\n"
+    "uniform mat4 gpu_ModelViewProjectionMatrix;\n"
+    "%s vec4 color;\n"
+    "%s vec2 texCoord;\n"
+    "void main(void) {\n"
+    "  color = gpu_Color;\n"
+    "  texCoord = gpu_TexCoord;\n"
+    "  gl_Position = gpu_ModelViewProjectionMatrix * "
+    "vec4(gpu_Vertex, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *fragment_source =
+    "%s\n"
+    "%s vec4 color;\n"
+    "%s vec2 texCoord;\n"
+    "uniform sampler2D tex;\n"
+    "%s"
+    "void main(void) {\n"
+    "  %s = vec4(color.rgb, color.a * %s(tex, texCoord).a);\n"
+    "}\n";
+
+static u32 program = 0;
+static bool failed = false;
+static GPU_ShaderBlock block;
+static u8 *scratch = NULL;
+static s32 scratch_size = 0;
+
+static u32 owl_compileCoverage(void) {
+  GPU_Renderer *renderer = GPU_GetCurrentRenderer();
+  const char *header, *in, *out, *attr, *frag, *decl, *texture;
+  char vsrc[1024], fsrc[1024];
+  u32 vs, fs, prog;
+
+  if (!renderer)
+    return 0;
+
+  if (renderer->shader_language == GPU_LANGUAGE_GLSLES) {
+    header = "#version 100\nprecision mediump float;";
+    attr = "attribute", in = "varying", out = "varying";
+    decl = "", frag = "gl_FragColor", texture = "texture2D";
+  } else if (renderer->shader_language == GPU_LANGUAGE_GLSL &&
+             renderer->max_shader_version >= 130) {
+    header = "#version 130";
+    attr = "in", in = "in", out = "out";
+    decl = "out vec4 fragColor;\n", frag = "fragColor", texture = "texture";
+  } else if (renderer->shader_language == GPU_LANGUAGE_GLSL) {
+    header = "#version 110";
+    attr = "attribute", in = "varying", out = "varying";
+    decl = "", frag = "gl_FragColor", texture = "texture2D";
+  } else
+    return 0;
+
+  snprintf(vsrc, sizeof(vsrc), vertex_source, header, attr, attr, attr, out,
+           out);
+  snprintf(fsrc, sizeof(fsrc), fragment_source, header, in, in, decl, frag,
+           texture);
+
+  vs = GPU_CompileShader(GPU_VERTEX_SHADER, vsrc);
+
+  if (!vs)
+    return 0;
+
+  fs = GPU_CompileShader(GPU_FRAGMENT_SHADER, fsrc);
+
+  if (!fs) {
+    GPU_FreeShader(vs);
+    return 0;
+  }
+
+  prog = GPU_LinkShaders(vs, fs);
+
+  GPU_FreeShader(vs);
+  GPU_FreeShader(fs);
+
+  if (!prog)
+    return 0;
+
+  block = GPU_LoadShaderBlock(prog, "gpu_Vertex", "gpu_TexCoord", "gpu_Color",
+                              "gpu_ModelViewProjectionMatrix");
+  return prog;
+}
+
+void owl_shaderQuit(void) {
+  if (program) {
+    GPU_FreeShaderProgram(program);
+    program = 0;
+  }
+
+  if (scratch) {
+    free(scratch);
+    scratch = NULL;
+    scratch_size = 0;
+  }
+
+  failed = false;
+}
+
+static bool owl_coverageShader(void) {
+  if (!program && !failed) {
+    program = owl_compileCoverage();
+    failed = !program;
+  }
+  return program != 0;
+}
+
+owl_Canvas *owl_coverageImage(s32 w, s32 h) {
+  owl_Canvas *canvas = NULL;
+
+  /* Alpha textures only draw through the shader */
+  if (owl_coverageShader())
+    canvas = GPU_CreateImage(w, h, GPU_FORMAT_ALPHA);
+
+  /* Without either fall back to white RGBA, which tints the same */
+  if (!canvas)
+    canvas = GPU_CreateImage(w, h, GPU_FORMAT_RGBA);
+
+  if (!canvas)
+    return NULL;
+
+  GPU_SetBlendMode(canvas, GPU_BLEND_NORMAL);
+  GPU_SetBlending(canvas, true);
+
+  return canvas;
+}
+
+bool owl_coverageUpload(owl_Canvas *canvas, const GPU_Rect *rect,
+                        const u8 *coverage, s32 pitch) {
+  s32 x, y, w, h;
+  u8 *pixels, *p;
+
+  if (canvas->format == GPU_FORMAT_ALPHA) {
+    GPU_UpdateImageBytes(canvas, rect, coverage, pitch);
+    return true;
+  }
+
+  w = rect ? (s32)rect->w : canvas->w;
+  h = rect ? (s32)rect->h : canvas->h;
+
+  if (w * h * 4 > scratch_size) {
+    pixels = (u8 *)realloc(scratch, w * h * 4);
+
+    if (!pixels)
+      return false;
+
+    scratch = pixels;
+    scratch_size = w * h * 4;
+  }
+
+  p = scratch;
+
+  for (y = 0; y < h; ++y)
+    for (x = 0; x < w; ++x) {
+      *p++ = 0xFF;
+      *p++ = 0xFF;
+      *p++ = 0xFF;
+      *p++ = coverage[y * pitch + x];
+    }
+
+  GPU_UpdateImageBytes(canvas, rect, scratch, w * 4);
+  return true;
+}
+
+bool owl_coverageBegin(owl_Canvas *texture) {
+  if (!texture || texture->format != GPU_FORMAT_ALPHA)
+    return false;
+
+  if (!owl_coverageShader())
+    return false;
+
+  GPU_ActivateShaderProgram(program, &block);
+  return true;
+}
+
+void owl_coverageEnd(void) { GPU_DeactivateShaderProgram(); }
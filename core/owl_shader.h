@@ -0,0 +1,36 @@
+/*
+ * owl_shader.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_SHADER_H__
+#define __OWL_SHADER_H__
+
+#include "SDL_gpu.h"
+
+#include "owl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void owl_shaderQuit(void);
+
+extern owl_Canvas *owl_coverageImage(s32 w, s32 h);
+extern bool owl_coverageUpload(owl_Canvas *canvas, const GPU_Rect *rect,
+                               const u8 *coverage, s32 pitch);
+
+extern bool owl_coverageBegin(owl_Canvas *texture);
+extern void owl_coverageEnd(void);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_SHADER_H__ */
@@ -0,0 +1,352 @@
+/*
+ * owl_shapes.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL_gpu.h"
+
+#include "owl_command.h"
+#include "owl_mesh.h"
+#include "owl_render.h"
+#include "owl_shapes.h"
+
+typedef struct owl_ShapeStream {
+  owl_Vertex *vertices;
+  u16 *indices;
+  s32 num_vertices, max_vertices;
+  s32 num_indices, max_indices;
+} owl_ShapeStream;
+
+/* Kept between calls and grown on demand, as a sprite batch keeps its own */
+static owl_ShapeStream shapes = {0};
+static SDL_mutex *shapes_lock = NULL;
+
+static bool owl_shapeGrow(void **array, s32 *capacity, s32 wanted,
+                          s32 unit) {
+  void *grown;
+
+  if (wanted <= *capacity)
+    return true;
+
+  grown = realloc(*array, wanted * unit);
+
+  if (!grown)
+    return false;
+
+  *array = grown;
+  *capacity = wanted;
+  return true;
+}
+
+/* Room for the whole call, or as many elements as one draw can take */
+static owl_ShapeStream *owl_shapeBegin(s32 count, s32 vertices,
+                                       s32 indices) {
+  owl_ShapeStream *stream = &shapes;
+  s32 fit = OWL_SHAPES_VERTICES / vertices;
+
+  if (count > fit)
+    count = fit;
+
+  if (!shapes_lock)
+    return NULL;
+
+  /* A mutex, as the lock is held across the draw call */
+  SDL_LockMutex(shapes_lock);
+
+  stream->num_vertices = 0;
+  stream->num_indices = 0;
+
+  if (!owl_shapeGrow((void **)&stream->vertices, &stream->max_vertices,
+                     count * vertices, sizeof(owl_Vertex)) ||
+      !owl_shapeGrow((void **)&stream->indices, &stream->max_indices,
+                     count * indices, sizeof(u16))) {
+    SDL_UnlockMutex(shapes_lock);
+    return NULL;
+  }
+  return stream;
+}
+
+static void owl_shapeFlush(owl_ShapeStream *stream) {
+  if (stream->num_indices > 0)
+    owl_geometry(NULL, OWL_GEOMETRY_TRIANGLES, stream->vertices,
+                 stream->num_vertices, stream->indices, stream->num_indices);
+
+  stream->num_vertices = 0;
+  stream->num_indices = 0;
+}
+
+static void owl_shapeEnd(owl_ShapeStream *stream) {
+  owl_shapeFlush(stream);
+  SDL_UnlockMutex(shapes_lock);
+}
+
+bool owl_shapesInit(void) {
+  if (!shapes_lock)
+    shapes_lock = SDL_CreateMutex();
+  return shapes_lock != NULL;
+}
+
+void owl_shapesQuit(void) {
+  free(shapes.vertices);
+  free(shapes.indices);
+  memset(&shapes, 0, sizeof(owl_ShapeStream));
+
+  if (shapes_lock) {
+    SDL_DestroyMutex(shapes_lock);
+    shapes_lock = NULL;
+  }
+}
+
+static owl_Vertex *owl_shapeReserve(owl_ShapeStream *stream, s32 vertices,
+                                    s32 indices, u16 **idx, u16 *base) {
+  owl_Vertex *v;
+
+  if (stream->num_vertices + vertices > stream->max_vertices ||
+      stream->num_indices + indices > stream->max_indices)
+    owl_shapeFlush(stream);
+
+  v = stream->vertices + stream->num_vertices;
+  *idx = stream->indices + stream->num_indices;
+  *base = (u16)stream->num_vertices;
+
+  stream->num_vertices += vertices;
+  stream->num_indices += indices;
+  return v;
+}
+
+/* Corners in the order (tl, tr, bl, br), as the sprite batch does */
+static void owl_shapeQuad(owl_ShapeStream *stream, const owl_Point *corners,
+                          owl_Pixel color) {
+  owl_Vertex *v;
+  u16 *idx, base;
+  s32 i;
+
+  v = owl_shapeReserve(stream, 4, 6, &idx, &base);
+
+  for (i = 0; i < 4; ++i) {
+    v[i].position = corners[i];
+    v[i].uv.x = 0.0f;
+    v[i].uv.y = 0.0f;
+    v[i].color = color;
+  }
+
+  idx[0] = base;
+  idx[1] = (u16)(base + 1);
+  idx[2] = (u16)(base + 2);
+  idx[3] = (u16)(base + 2);
+  idx[4] = (u16)(base + 1);
+  idx[5] = (u16)(base + 3);
+}
+
+static void owl_shapeRect(owl_ShapeStream *stream, f32 x1, f32 y1, f32 x2,
+                          f32 y2, owl_Pixel color) {
+  owl_Point corners[4];
+
+  corners[0].x = x1, corners[0].y = y1;
+  corners[1].x = x2, corners[1].y = y1;
+  corners[2].x = x1, corners[2].y = y2;
+  corners[3].x = x2, corners[3].y = y2;
+
+  owl_shapeQuad(stream, corners, color);
+}
+
+void owl_pixels(const owl_Point *points, const owl_Pixel *colors,
+                s32 count) {
+  owl_ShapeStream *stream;
+  owl_Pixel color;
+  s32 i;
+
+  if (owl_recordShapes(OWL_CMD_PIXELS, points, sizeof(owl_Point), NULL,
+                       colors, count))
+    return;
+
+  if (!points || count <= 0 || !(stream = owl_shapeBegin(count, 4, 6)))
+    return;
+
+  color = owl_drawColor();
+
+  for (i = 0; i < count; ++i)
+    owl_shapeRect(stream, points[i].x, points[i].y, points[i].x + 1.0f,
+                  points[i].y + 1.0f, colors ? colors[i] : color);
+
+  owl_shapeEnd(stream);
+}
+
+/* Each segment is a quad of line thickness */
+void owl_lines(const owl_Point *points, const owl_Pixel *colors, s32 count) {
+  owl_ShapeStream *stream;
+  owl_Pixel color;
+  owl_Point corners[4];
+  const owl_Point *p, *q;
+  f32 half, dx, dy, length;
+  s32 i;
+
+  if (owl_recordShapes(OWL_CMD_LINES, points, 2 * sizeof(owl_Point), NULL,
+                       colors, count))
+    return;
+
+  if (!points || count <= 0 || !(stream = owl_shapeBegin(count, 4, 6)))
+    return;
+
+  color = owl_drawColor();
+  half = GPU_GetLineThickness() * 0.5f;
+
+  for (i = 0; i < count; ++i) {
+    p = &points[i * 2];
+    q = &points[i * 2 + 1];
+    dx = q->x - p->x;
+    dy = q->y - p->y;
+    length = sqrtf(dx * dx + dy * dy);
+
+    if (length <= 0.0f)
+      continue;
+
+    dx = dx / length * half;
+    dy = dy / length * half;
+
+    corners[0].x = p->x + dy, corners[0].y = p->y - dx;
+    corners[1].x = q->x + dy, corners[1].y = q->y - dx;
+    corners[2].x = p->x - dy, corners[2].y = p->y + dx;
+    corners[3].x = q->x - dy, corners[3].y = q->y + dx;
+
+    owl_shapeQuad(stream, corners, colors ? colors[i] : color);
+  }
+
+  owl_shapeEnd(stream);
+}
+
+/* Four bands around the edge, so translucent corners are not doubled */
+void owl_rects(const owl_Rect *rects, const owl_Pixel *colors, s32 count) {
+  owl_ShapeStream *stream;
+  owl_Pixel color, c;
+  f32 half, ox1, oy1, ox2, oy2, ix1, iy1, ix2, iy2;
+  s32 i;
+
+  if (owl_recordShapes(OWL_CMD_RECTS, rects, sizeof(owl_Rect), NULL, colors,
+                       count))
+    return;
+
+  if (!rects || count <= 0 || !(stream = owl_shapeBegin(count, 16, 24)))
+    return;
+
+  color = owl_drawColor();
+  half = GPU_GetLineThickness() * 0.5f;
+
+  for (i = 0; i < count; ++i) {
+    c = colors ? colors[i] : color;
+
+    ox1 = rects[i].x - half, oy1 = rects[i].y - half;
+    ox2 = rects[i].x + rects[i].w + half, oy2 = rects[i].y + rects[i].h + half;
+    ix1 = ox1 + half * 2, iy1 = oy1 + half * 2;
+    ix2 = ox2 - half * 2, iy2 = oy2 - half * 2;
+
+    if (ix1 >= ix2 || iy1 >= iy2) {
+      owl_shapeRect(stream, ox1, oy1, ox2, oy2, c);
+      continue;
+    }
+
+    owl_shapeRect(stream, ox1, oy1, ox2, iy1, c);
+    owl_shapeRect(stream, ox1, iy2, ox2, oy2, c);
+    owl_shapeRect(stream, ox1, iy1, ix1, iy2, c);
+    owl_shapeRect(stream, ix2, iy1, ox2, iy2, c);
+  }
+
+  owl_shapeEnd(stream);
+}
+
+void owl_fillRects(const owl_Rect *rects, const owl_Pixel *colors,
+                   s32 count) {
+  owl_ShapeStream *stream;
+  owl_Pixel color;
+  s32 i;
+
+  if (owl_recordShapes(OWL_CMD_FILLRECTS, rects, sizeof(owl_Rect), NULL,
+                       colors, count))
+    return;
+
+  if (!rects || count <= 0 || !(stream = owl_shapeBegin(count, 4, 6)))
+    return;
+
+  color = owl_drawColor();
+
+  for (i = 0; i < count; ++i)
+    owl_shapeRect(stream, rects[i].x, rects[i].y, rects[i].x + rects[i].w,
+                  rects[i].y + rects[i].h, colors ? colors[i] : color);
+
+  owl_shapeEnd(stream);
+}
+
+/* Outlines of line thickness, as rings of quads */
+void owl_circles(const owl_Point *centers, const f32 *radii,
+                 const owl_Pixel *colors, s32 count) {
+  owl_ShapeStream *stream;
+  owl_Pixel color, c;
+  owl_Vertex *v;
+  u16 *idx, base;
+  f32 half, inner, outer, a, cosa, sina;
+  s32 i, k, n, most = 1;
+
+  if (!centers || !radii || count <= 0)
+    return;
+
+  if (owl_recordShapes(OWL_CMD_CIRCLES, centers, sizeof(owl_Point), radii,
+                       colors, count))
+    return;
+
+  color = owl_drawColor();
+  half = GPU_GetLineThickness() * 0.5f;
+
+  /* Sized by the largest ring, not the segment limit */
+  for (i = 0; i < count; ++i) {
+    n = owl_meshSegments(radii[i] + half, 360.0f);
+    most = n > most ? n : most;
+  }
+
+  if (!(stream = owl_shapeBegin(count, most * 2, most * 6)))
+    return;
+
+  for (i = 0; i < count; ++i) {
+    c = colors ? colors[i] : color;
+    outer = radii[i] + half;
+    inner = radii[i] > half ? radii[i] - half : 0.0f;
+    n = owl_meshSegments(outer, 360.0f);
+
+    v = owl_shapeReserve(stream, n * 2, n * 6, &idx, &base);
+
+    for (k = 0; k < n; ++k) {
+      a = (f32)(2.0 * OWL_PI * k / n);
+      cosa = cosf(a);
+      sina = sinf(a);
+
+      v[k * 2].position.x = centers[i].x + outer * cosa;
+      v[k * 2].position.y = centers[i].y + outer * sina;
+      v[k * 2 + 1].position.x = centers[i].x + inner * cosa;
+      v[k * 2 + 1].position.y = centers[i].y + inner * sina;
+
+      v[k * 2].uv.x = v[k * 2].uv.y = 0.0f;
+      v[k * 2 + 1].uv.x = v[k * 2 + 1].uv.y = 0.0f;
+      v[k * 2].color = v[k * 2 + 1].color = c;
+    }
+
+    for (k = 0; k < n; ++k) {
+      *idx++ = (u16)(base + k * 2);
+      *idx++ = (u16)(base + (k + 1) % n * 2);
+      *idx++ = (u16)(base + k * 2 + 1);
+      *idx++ = (u16)(base + k * 2 + 1);
+      *idx++ = (u16)(base + (k + 1) % n * 2);
+      *idx++ = (u16)(base + (k + 1) % n * 2 + 1);
+    }
+  }
+
+  owl_shapeEnd(stream);
+}
@@ -0,0 +1,31 @@
+/*
+ * owl_shapes.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_SHAPES_H__
+#define __OWL_SHAPES_H__
+
+#include "owl.h"
+
+/* One draw call carries at most this many vertices, indices are u16 */
+#define OWL_SHAPES_VERTICES 0xFFFF
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern bool owl_shapesInit(void);
+extern void owl_shapesQuit(void);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_SHAPES_H__ */
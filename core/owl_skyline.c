@@ -0,0 +1,151 @@
+/*
+ * owl_skyline.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "owl_skyline.h"
+
+bool owl_skyline(owl_Skyline *sky, s32 width, s32 height) {
+  sky->width = width;
+  sky->height = height;
+  sky->capacity = 16;
+  sky->nodes = (owl_SkylineNode *)malloc(16 * sizeof(owl_SkylineNode));
+
+  if (!sky->nodes)
+    return false;
+
+  owl_resetSkyline(sky);
+  return true;
+}
+
+void owl_freeSkyline(owl_Skyline *sky) {
+  if (sky->nodes)
+    free(sky->nodes);
+
+  memset(sky, 0, sizeof(owl_Skyline));
+}
+
+void owl_resetSkyline(owl_Skyline *sky) {
+  sky->count = 1;
+  sky->nodes[0].x = 0;
+  sky->nodes[0].y = 0;
+  sky->nodes[0].w = sky->width;
+}
+
+static s32 owl_skylineFit(owl_Skyline *sky, s32 i, s32 w, s32 h) {
+  s32 x = sky->nodes[i].x;
+  s32 y = sky->nodes[i].y;
+  s32 left = w;
+
+  if (x + w > sky->width)
+    return -1;
+
+  while (left > 0) {
+    if (sky->nodes[i].y > y)
+      y = sky->nodes[i].y;
+
+    if (y + h > sky->height)
+      return -1;
+
+    left -= sky->nodes[i].w;
+    i += 1;
+  }
+  return y;
+}
+
+static bool owl_skylineInsert(owl_Skyline *sky, s32 i, s32 x, s32 y, s32 w) {
+  owl_SkylineNode *nodes;
+
+  if (sky->count >= sky->capacity) {
+    nodes = (owl_SkylineNode *)realloc(
+        sky->nodes, sky->capacity * 2 * sizeof(owl_SkylineNode));
+
+    if (!nodes)
+      return false;
+
+    sky->nodes = nodes;
+    sky->capacity *= 2;
+  }
+
+  memmove(&sky->nodes[i + 1], &sky->nodes[i],
+          (sky->count - i) * sizeof(owl_SkylineNode));
+
+  sky->nodes[i].x = x;
+  sky->nodes[i].y = y;
+  sky->nodes[i].w = w;
+  sky->count += 1;
+
+  return true;
+}
+
+static void owl_skylineRemove(owl_Skyline *sky, s32 i) {
+  memmove(&sky->nodes[i], &sky->nodes[i + 1],
+          (sky->count - i - 1) * sizeof(owl_SkylineNode));
+  sky->count -= 1;
+}
+
+bool owl_skylinePack(owl_Skyline *sky, s32 w, s32 h, s32 *x, s32 *y) {
+  s32 i, fit, shrink;
+  s32 best = -1, best_h = INT_MAX, best_w = INT_MAX;
+  owl_SkylineNode *prev, *node;
+
+  /* Bottom-left rule, ties broken by the narrowest segment */
+  for (i = 0; i < sky->count; ++i) {
+    fit = owl_skylineFit(sky, i, w, h);
+
+    if (fit < 0)
+      continue;
+
+    if (fit + h < best_h || (fit + h == best_h && sky->nodes[i].w < best_w)) {
+      best = i;
+      best_h = fit + h;
+      best_w = sky->nodes[i].w;
+      *y = fit;
+    }
+  }
+
+  if (best < 0)
+    return false;
+
+  *x = sky->nodes[best].x;
+
+  if (!owl_skylineInsert(sky, best, *x, *y + h, w))
+    return false;
+
+  for (i = best + 1; i < sky->count; ++i) {
+    prev = &sky->nodes[i - 1];
+    node = &sky->nodes[i];
+
+    if (node->x >= prev->x + prev->w)
+      break;
+
+    shrink = prev->x + prev->w - node->x;
+    node->x += shrink;
+    node->w -= shrink;
+
+    if (node->w > 0)
+      break;
+
+    owl_skylineRemove(sky, i);
+    i -= 1;
+  }
+
+  for (i = 0; i < sky->count - 1; ++i)
+    if (sky->nodes[i].y == sky->nodes[i + 1].y) {
+      sky->nodes[i].w += sky->nodes[i + 1].w;
+      owl_skylineRemove(sky, i + 1);
+      i -= 1;
+    }
+
+  return true;
+}
@@ -0,0 +1,40 @@
+/*
+ * owl_skyline.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_SKYLINE_H__
+#define __OWL_SKYLINE_H__
+
+#include "owl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct owl_SkylineNode {
+  s32 x, y, w;
+} owl_SkylineNode;
+
+typedef struct owl_Skyline {
+  s32 width, height;
+  s32 count, capacity;
+  owl_SkylineNode *nodes;
+} owl_Skyline;
+
+extern bool owl_skyline(owl_Skyline *sky, s32 width, s32 height);
+extern void owl_freeSkyline(owl_Skyline *sky);
+extern void owl_resetSkyline(owl_Skyline *sky);
+extern bool owl_skylinePack(owl_Skyline *sky, s32 w, s32 h, s32 *x, s32 *y);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_SKYLINE_H__ */
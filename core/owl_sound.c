@@ -17,31 +17,47 @@
 #define DR_MP3_IMPLEMENTATION
 #include "dr_mp3.h"
 
+#include "owl_cache.h"
+#include "owl_convert.h"
+#include "owl_mixer.h"
 #include "owl_sound.h"
+#include "owl_stream.h"
 #include "owl_table.h"
+#include "owl_vfs.h"
 
 #define OWL_SOUND_NONE 0
 #define OWL_SOUND_WAV 1
 #define OWL_SOUND_FLAC 2
 #define OWL_SOUND_MP3 3
+#define OWL_SOUND_STREAM 4
+#define OWL_SOUND_PCM 5
+#define OWL_SOUND_CACHED 6
 
-typedef struct owl_Sound {
+struct owl_Sound {
   SDL_AudioSpec spec;
-  owl_Audio audio;
+  s32 limit;
   u32 type;
   u32 size;
   u8 *buffer;
-} owl_Sound;
+  owl_Stream *stream;
+  owl_CacheEntry cache;
+};
 
 static owl_Table *sounds = NULL;
 
-static owl_Sound *owl_loadWAV(const char *filename) {
+static owl_Sound *owl_loadWAV(const u8 *data, s64 length) {
   owl_Sound *sound;
   SDL_AudioSpec spec;
+  SDL_RWops *rw;
   u8 *wav;
   u32 size;
 
-  if (!SDL_LoadWAV(filename, &spec, &wav, &size))
+  rw = SDL_RWFromConstMem(data, (s32)length);
+
+  if (!rw)
+    return NULL;
+
+  if (!SDL_LoadWAV_RW(rw, 1, &spec, &wav, &size))
     return NULL;
 
   sound = (owl_Sound *)calloc(1, sizeof(owl_Sound));
@@ -59,14 +75,14 @@ static owl_Sound *owl_loadWAV(const char *filename) {
   return sound;
 }
 
-static owl_Sound *owl_loadFlac(const char *filename) {
+static owl_Sound *owl_loadFlac(const u8 *data, s64 length) {
   owl_Sound *sound;
   u32 channels, sample_rate;
   u64 num_samples;
   s32 *samples;
 
-  samples = drflac_open_file_and_read_pcm_frames_s32(
-      filename, &channels, &sample_rate, &num_samples, NULL);
+  samples = drflac_open_memory_and_read_pcm_frames_s32(
+      data, (size_t)length, &channels, &sample_rate, &num_samples, NULL);
 
   if (!samples)
     return NULL;
@@ -89,14 +105,14 @@ static owl_Sound *owl_loadFlac(const char *filename) {
   return sound;
 }
 
-static owl_Sound *owl_loadMP3(const char *filename) {
+static owl_Sound *owl_loadMP3(const u8 *data, s64 length) {
   owl_Sound *sound;
   drmp3_config mp3;
   u64 num_samples;
   s16 *samples;
 
-  samples = drmp3_open_file_and_read_pcm_frames_s16(filename, &mp3,
-                                                    &num_samples, NULL);
+  samples = drmp3_open_memory_and_read_pcm_frames_s16(
+      data, (size_t)length, &mp3, &num_samples, NULL);
   if (!samples)
     return NULL;
 
@@ -118,31 +134,44 @@ static owl_Sound *owl_loadMP3(const char *filename) {
   return sound;
 }
 
-static owl_Sound *owl_sound(const char *filename) {
+static owl_Sound *owl_sound(const owl_File *file) {
   owl_Sound *sound;
 
-  sound = owl_loadWAV(filename);
+  if (file->size > SDL_MAX_SINT32)
+    return NULL;
 
-  if (sound)
-    return sound;
+  if (!(sound = owl_loadWAV(file->data, file->size)))
+    if (!(sound = owl_loadFlac(file->data, file->size)))
+      sound = owl_loadMP3(file->data, file->size);
 
-  sound = owl_loadFlac(filename);
+  return sound;
+}
 
-  if (sound)
-    return sound;
+/* Plays the converted samples straight out of the cache mapping */
+static owl_Sound *owl_cachedSound(u64 key, const SDL_AudioSpec *spec) {
+  owl_CacheEntry entry;
+  owl_Sound *sound;
 
-  sound = owl_loadMP3(filename);
+  if (!owl_cacheFind(key, OWL_CACHE_SOUND, &entry))
+    return NULL;
 
-  if (sound)
-    return sound;
+  if (entry.params[0] != (u32)spec->freq ||
+      entry.params[1] != spec->channels || entry.params[2] != spec->format ||
+      !(sound = (owl_Sound *)calloc(1, sizeof(owl_Sound)))) {
+    owl_cacheClose(&entry);
+    return NULL;
+  }
 
-  return NULL;
-}
+  sound->type = OWL_SOUND_CACHED;
+  sound->spec = *spec;
+  sound->buffer = (u8 *)entry.data;
+  sound->size = entry.size;
+  sound->cache = entry;
 
-static void owl_freeSound(owl_Sound *sound) {
-  owl_clearAudio(sound->audio);
-  owl_closeAudio(sound->audio);
+  return sound;
+}
 
+static void owl_freeSamples(owl_Sound *sound) {
   switch (sound->type) {
   case OWL_SOUND_WAV:
     SDL_FreeWAV(sound->buffer);
@@ -153,11 +182,48 @@ static void owl_freeSound(owl_Sound *sound) {
   case OWL_SOUND_MP3:
     drmp3_free(sound->buffer, NULL);
     break;
+  case OWL_SOUND_STREAM:
+    owl_freeStream(sound->stream);
+    break;
+  case OWL_SOUND_PCM:
+    free(sound->buffer);
+    break;
+  case OWL_SOUND_CACHED:
+    owl_cacheClose(&sound->cache);
+    break;
   }
+}
 
+static void owl_freeSound(owl_Sound *sound) {
+  owl_mixerStop(sound);
+  owl_freeSamples(sound);
   free(sound);
 }
 
+/* Converts once to the mixer format so playback never has to */
+static void owl_normalizeSound(owl_Sound *sound) {
+  const SDL_AudioSpec *spec = owl_mixerSpec();
+  u32 size;
+  f32 *pcm;
+
+  if (!spec)
+    return;
+
+  pcm = owl_convertAudio(&sound->spec, sound->buffer, sound->size, spec,
+                         &size);
+
+  /* Keeping the original data still plays, converted per voice */
+  if (!pcm)
+    return;
+
+  owl_freeSamples(sound);
+
+  sound->type = OWL_SOUND_PCM;
+  sound->spec = *spec;
+  sound->buffer = (u8 *)pcm;
+  sound->size = size;
+}
+
 static owl_Audio owl_openAudio(const SDL_AudioSpec *spec) {
   owl_Audio audio = SDL_OpenAudioDevice(NULL, 0, spec, NULL, 0);
 
@@ -170,10 +236,16 @@ static owl_Audio owl_openAudio(const SDL_AudioSpec *spec) {
 bool owl_soundInit(void) {
   if (!sounds)
     sounds = owl_table();
+
+  /* Missing audio hardware is not fatal, owl_play just fails */
+  owl_mixerInit();
+
   return sounds != NULL;
 }
 
 void owl_soundQuit(void) {
+  owl_mixerQuit();
+
   if (sounds) {
     owl_freeTable(sounds, (owl_Dtor)owl_freeSound);
     sounds = NULL;
@@ -248,6 +320,51 @@ u32 owl_audioBuffered(owl_Audio audio) {
   return SDL_GetQueuedAudioSize(audio);
 }
 
+owl_Sound *owl_soundDecode(const char *filename) {
+  const SDL_AudioSpec *spec = owl_mixerSpec();
+  owl_Sound *sound = NULL;
+  owl_File file;
+  u32 params[4];
+  u64 key = 0;
+
+  if (!owl_vfsOpen(&file, filename))
+    return NULL;
+
+  if (spec) {
+    params[0] = (u32)spec->freq;
+    params[1] = spec->channels;
+    params[2] = spec->format;
+    params[3] = 0;
+
+    key = owl_cacheKey(OWL_CACHE_SOUND, params, 3, file.data, file.size);
+    sound = owl_cachedSound(key, spec);
+  }
+
+  /* Each decoder copies out its samples, so the view is dropped after */
+  if (!sound && (sound = owl_sound(&file))) {
+    owl_normalizeSound(sound);
+
+    if (key && sound->type == OWL_SOUND_PCM)
+      owl_cacheStore(key, OWL_CACHE_SOUND, params, sound->buffer,
+                     sound->size);
+  }
+
+  owl_vfsClose(&file);
+  return sound;
+}
+
+bool owl_soundAdd(const char *name, owl_Sound *sound) {
+  if (!name || owl_getTable(sounds, name)) {
+    owl_freeSound(sound);
+    return name != NULL;
+  }
+
+  owl_setTable(sounds, name, sound);
+  return true;
+}
+
+void owl_soundDiscard(owl_Sound *sound) { owl_freeSound(sound); }
+
 bool owl_loadSound(const char *name, const char *filename) {
   owl_Sound *sound = (owl_Sound *)owl_getTable(sounds, name);
 
@@ -257,7 +374,7 @@ bool owl_loadSound(const char *name, const char *filename) {
   if (!filename)
     return false;
 
-  sound = owl_sound(filename);
+  sound = owl_soundDecode(filename);
 
   if (!sound)
     return false;
@@ -266,25 +383,60 @@ bool owl_loadSound(const char *name, const char *filename) {
   return true;
 }
 
-bool owl_playing(const char *name) {
+bool owl_loadMusic(const char *name, const char *filename) {
   owl_Sound *sound = (owl_Sound *)owl_getTable(sounds, name);
+  const SDL_AudioSpec *spec = owl_mixerSpec();
+
+  if (sound)
+    return true;
+
+  if (!filename || !spec)
+    return false;
+
+  sound = (owl_Sound *)calloc(1, sizeof(owl_Sound));
 
   if (!sound)
     return false;
 
-  return owl_audioBuffered(sound->audio) > 0;
+  sound->stream = owl_stream(filename, spec);
+
+  if (!sound->stream) {
+    free(sound);
+    return false;
+  }
+
+  sound->type = OWL_SOUND_STREAM;
+  sound->spec = *spec;
+
+  owl_setTable(sounds, name, sound);
+  return true;
 }
 
-bool owl_play(const char *name) {
+bool owl_playing(const char *name) {
   owl_Sound *sound = (owl_Sound *)owl_getTable(sounds, name);
 
   if (!sound)
     return false;
 
-  if (!sound->audio)
-    sound->audio = owl_openAudio(&sound->spec);
+  return owl_mixerPlaying(sound);
+}
+
+owl_Voice owl_play(const char *name) {
+  owl_Sound *sound = (owl_Sound *)owl_getTable(sounds, name);
+
+  if (!sound)
+    return 0;
+
+  /* A stream has one decoder, so playing it again restarts it */
+  if (sound->stream) {
+    owl_mixerStop(sound);
+    owl_rewindStream(sound->stream);
 
-  return owl_audioStream(sound->audio, sound->buffer, sound->size);
+    return owl_mixerSource(sound, 1, owl_readStream, sound->stream, 1.0f);
+  }
+
+  return owl_mixerPlay(sound, sound->limit, &sound->spec, sound->buffer,
+                       sound->size, 1.0f);
 }
 
 bool owl_stop(const char *name) {
@@ -293,7 +445,7 @@ bool owl_stop(const char *name) {
   if (!sound)
     return false;
 
-  owl_clearAudio(sound->audio);
+  owl_mixerStop(sound);
   return true;
 }
 
@@ -303,7 +455,7 @@ bool owl_pause(const char *name) {
   if (!sound)
     return false;
 
-  owl_playAudio(sound->audio, false);
+  owl_mixerPause(sound, true);
   return true;
 }
 
@@ -313,6 +465,24 @@ bool owl_resume(const char *name) {
   if (!sound)
     return false;
 
-  owl_playAudio(sound->audio, true);
+  owl_mixerPause(sound, false);
   return true;
 }
+
+bool owl_soundLimit(const char *name, s32 limit) {
+  owl_Sound *sound = (owl_Sound *)owl_getTable(sounds, name);
+
+  if (!sound)
+    return false;
+
+  sound->limit = limit > 0 ? limit : 0;
+  return true;
+}
+
+void owl_voiceLimit(s32 limit) { owl_mixerLimit(limit); }
+
+void owl_stopVoice(owl_Voice voice) { owl_mixerStopVoice(voice); }
+
+void owl_voiceGain(owl_Voice voice, f32 gain) { owl_mixerGain(voice, gain); }
+
+bool owl_voicePlaying(owl_Voice voice) { return owl_mixerVoicePlaying(voice); }
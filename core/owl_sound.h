@@ -18,9 +18,15 @@
 extern "C" {
 #endif
 
+typedef struct owl_Sound owl_Sound;
+
 extern bool owl_soundInit(void);
 extern void owl_soundQuit(void);
 
+extern owl_Sound *owl_soundDecode(const char *filename);
+extern bool owl_soundAdd(const char *name, owl_Sound *sound);
+extern void owl_soundDiscard(owl_Sound *sound);
+
 #ifdef __cplusplus
 };
 #endif
@@ -0,0 +1,315 @@
+/*
+ * owl_stream.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dr_flac.h"
+#include "dr_mp3.h"
+
+#include "owl_job.h"
+#include "owl_stream.h"
+#include "owl_vfs.h"
+
+#define OWL_STREAM_FLAC 1
+#define OWL_STREAM_MP3 2
+
+#define OWL_STREAM_MASK (OWL_STREAM_RING - 1)
+#define OWL_STREAM_LOW (OWL_STREAM_RING / 4)
+
+/*
+ * At most one fill job runs at a time, so it is the only writer and the
+ * audio callback the only reader; the ring needs no lock. The mutex only
+ * keeps a rewind from racing with a decode step. The job holds a
+ * reference, so the stream outlives a fill still in flight.
+ */
+struct owl_Stream {
+  u32 type;
+  owl_File file;
+  drflac *flac;
+  drmp3 mp3;
+  u32 channels;
+  f32 *pcm;
+  SDL_AudioStream *convert;
+  SDL_mutex *lock;
+  bool decoded;
+  SDL_atomic_t refs;
+  SDL_atomic_t filling;
+  SDL_atomic_t quit;
+  SDL_atomic_t finished;
+  SDL_atomic_t read;
+  SDL_atomic_t write;
+  f32 ring[OWL_STREAM_RING];
+};
+
+static u64 owl_streamDecode(owl_Stream *stream, u64 frames) {
+  switch (stream->type) {
+  case OWL_STREAM_FLAC:
+    return drflac_read_pcm_frames_f32(stream->flac, frames, stream->pcm);
+  case OWL_STREAM_MP3:
+    return drmp3_read_pcm_frames_f32(&stream->mp3, frames, stream->pcm);
+  }
+  return 0;
+}
+
+static bool owl_streamFill(owl_Stream *stream) {
+  u32 r = (u32)SDL_AtomicGet(&stream->read);
+  u32 w = (u32)SDL_AtomicGet(&stream->write);
+  u32 space = OWL_STREAM_RING - (w - r);
+  f32 *ring = stream->ring + (w & OWL_STREAM_MASK);
+  s32 n, first, got;
+  u64 frames;
+
+  if (space < OWL_STREAM_FRAMES)
+    return false;
+
+  n = SDL_AudioStreamAvailable(stream->convert) / (s32)sizeof(f32);
+
+  if (n == 0) {
+    if (stream->decoded) {
+      SDL_AtomicSet(&stream->finished, 1);
+      return false;
+    }
+
+    frames = owl_streamDecode(stream, OWL_STREAM_FRAMES);
+
+    if (frames == 0) {
+      stream->decoded = true;
+      SDL_AudioStreamFlush(stream->convert);
+    } else
+      SDL_AudioStreamPut(stream->convert, stream->pcm,
+                         (s32)(frames * stream->channels * sizeof(f32)));
+    return true;
+  }
+
+  if ((u32)n > space)
+    n = (s32)space;
+
+  first = OWL_STREAM_RING - (s32)(w & OWL_STREAM_MASK);
+
+  if (first > n)
+    first = n;
+
+  got = SDL_AudioStreamGet(stream->convert, ring, first * (s32)sizeof(f32));
+
+  if (got == first * (s32)sizeof(f32) && n > first)
+    got += SDL_AudioStreamGet(stream->convert, stream->ring,
+                              (n - first) * (s32)sizeof(f32));
+
+  if (got > 0)
+    SDL_AtomicSet(&stream->write, (int)(w + got / sizeof(f32)));
+
+  return true;
+}
+
+static void owl_streamDestroy(owl_Stream *stream) {
+  if (stream->lock)
+    SDL_DestroyMutex(stream->lock);
+
+  if (stream->convert)
+    SDL_FreeAudioStream(stream->convert);
+
+  if (stream->pcm)
+    free(stream->pcm);
+
+  switch (stream->type) {
+  case OWL_STREAM_FLAC:
+    drflac_close(stream->flac);
+    break;
+  case OWL_STREAM_MP3:
+    drmp3_uninit(&stream->mp3);
+    break;
+  }
+
+  owl_vfsClose(&stream->file);
+  free(stream);
+}
+
+static void owl_streamRelease(owl_Stream *stream) {
+  if (SDL_AtomicDecRef(&stream->refs))
+    owl_streamDestroy(stream);
+}
+
+static bool owl_streamHungry(owl_Stream *stream) {
+  u32 r = (u32)SDL_AtomicGet(&stream->read);
+  u32 w = (u32)SDL_AtomicGet(&stream->write);
+
+  return !SDL_AtomicGet(&stream->quit) &&
+         !SDL_AtomicGet(&stream->finished) &&
+         OWL_STREAM_RING - (w - r) >= OWL_STREAM_LOW;
+}
+
+static void owl_streamKick(owl_Stream *stream);
+
+static void owl_streamJob(owl_Job *job, void *data) {
+  owl_Stream *stream = (owl_Stream *)data;
+
+  SDL_LockMutex(stream->lock);
+
+  while (!SDL_AtomicGet(&stream->quit) && owl_streamFill(stream))
+    ;
+
+  SDL_UnlockMutex(stream->lock);
+  SDL_AtomicSet(&stream->filling, 0);
+
+  /* The reader may have drained the ring after the last fill step */
+  if (owl_streamHungry(stream))
+    owl_streamKick(stream);
+
+  owl_streamRelease(stream);
+}
+
+/* A kick that cannot be queued is dropped, the next read retries it */
+static void owl_streamKick(owl_Stream *stream) {
+  owl_Job *job;
+
+  if (SDL_AtomicGet(&stream->filling) ||
+      !SDL_AtomicCAS(&stream->filling, 0, 1))
+    return;
+
+  SDL_AtomicIncRef(&stream->refs);
+  job = owl_jobUrgent(owl_streamJob, stream);
+
+  if (!job) {
+    SDL_AtomicSet(&stream->filling, 0);
+    owl_streamRelease(stream);
+    return;
+  }
+
+  owl_releaseJob(job);
+}
+
+static bool owl_streamOpen(owl_Stream *stream, const char *filename,
+                           u32 *freq) {
+  /* The decoder reads from the view for as long as the stream lives */
+  if (!owl_vfsOpen(&stream->file, filename))
+    return false;
+
+  stream->flac = drflac_open_memory(stream->file.data,
+                                    (size_t)stream->file.size, NULL);
+
+  if (stream->flac) {
+    stream->type = OWL_STREAM_FLAC;
+    stream->channels = stream->flac->channels;
+    *freq = stream->flac->sampleRate;
+    return true;
+  }
+
+  if (drmp3_init_memory(&stream->mp3, stream->file.data,
+                        (size_t)stream->file.size, NULL)) {
+    stream->type = OWL_STREAM_MP3;
+    stream->channels = stream->mp3.channels;
+    *freq = stream->mp3.sampleRate;
+    return true;
+  }
+
+  owl_vfsClose(&stream->file);
+  return false;
+}
+
+owl_Stream *owl_stream(const char *filename, const SDL_AudioSpec *output) {
+  owl_Stream *stream = (owl_Stream *)calloc(1, sizeof(owl_Stream));
+  u32 freq;
+
+  if (!stream)
+    return NULL;
+
+  SDL_AtomicSet(&stream->refs, 1);
+
+  if (!owl_streamOpen(stream, filename, &freq)) {
+    free(stream);
+    return NULL;
+  }
+
+  stream->pcm =
+      (f32 *)malloc(OWL_STREAM_FRAMES * stream->channels * sizeof(f32));
+  stream->convert =
+      SDL_NewAudioStream(AUDIO_F32SYS, (u8)stream->channels, (s32)freq,
+                         output->format, output->channels, output->freq);
+  stream->lock = SDL_CreateMutex();
+
+  if (!stream->pcm || !stream->convert || !stream->lock) {
+    owl_freeStream(stream);
+    return NULL;
+  }
+
+  owl_streamKick(stream);
+  return stream;
+}
+
+void owl_freeStream(owl_Stream *stream) {
+  SDL_AtomicSet(&stream->quit, 1);
+  owl_streamRelease(stream);
+}
+
+/* The caller must make sure no voice is reading the stream */
+bool owl_rewindStream(owl_Stream *stream) {
+  bool ok = false;
+
+  SDL_LockMutex(stream->lock);
+
+  switch (stream->type) {
+  case OWL_STREAM_FLAC:
+    ok = drflac_seek_to_pcm_frame(stream->flac, 0);
+    break;
+  case OWL_STREAM_MP3:
+    ok = drmp3_seek_to_pcm_frame(&stream->mp3, 0);
+    break;
+  }
+
+  SDL_AudioStreamClear(stream->convert);
+  stream->decoded = false;
+
+  SDL_AtomicSet(&stream->finished, 0);
+  SDL_AtomicSet(&stream->read, 0);
+  SDL_AtomicSet(&stream->write, 0);
+
+  SDL_UnlockMutex(stream->lock);
+
+  owl_streamKick(stream);
+  return ok;
+}
+
+s32 owl_readStream(void *source, f32 *samples, s32 n) {
+  owl_Stream *stream = (owl_Stream *)source;
+  s32 finished = SDL_AtomicGet(&stream->finished);
+  u32 r = (u32)SDL_AtomicGet(&stream->read);
+  u32 w = (u32)SDL_AtomicGet(&stream->write);
+  s32 first;
+
+  /* finished is read first, so w is final once it is set */
+  if (w == r) {
+    if (!finished && owl_streamHungry(stream))
+      owl_streamKick(stream);
+
+    return finished ? -1 : 0;
+  }
+
+  if ((u32)n > w - r)
+    n = (s32)(w - r);
+
+  first = OWL_STREAM_RING - (s32)(r & OWL_STREAM_MASK);
+
+  if (first > n)
+    first = n;
+
+  memcpy(samples, stream->ring + (r & OWL_STREAM_MASK), first * sizeof(f32));
+
+  if (n > first)
+    memcpy(samples + first, stream->ring, (n - first) * sizeof(f32));
+
+  SDL_AtomicSet(&stream->read, (int)(r + n));
+
+  if (owl_streamHungry(stream))
+    owl_streamKick(stream);
+
+  return n;
+}
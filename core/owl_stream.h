@@ -0,0 +1,38 @@
+/*
+ * owl_stream.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_STREAM_H__
+#define __OWL_STREAM_H__
+
+#include "SDL.h"
+
+#include "owl.h"
+
+#define OWL_STREAM_RING 32768
+#define OWL_STREAM_FRAMES 1024
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct owl_Stream owl_Stream;
+
+extern owl_Stream *owl_stream(const char *filename,
+                              const SDL_AudioSpec *output);
+extern void owl_freeStream(owl_Stream *stream);
+extern bool owl_rewindStream(owl_Stream *stream);
+extern s32 owl_readStream(void *stream, f32 *samples, s32 n);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_STREAM_H__ */
@@ -10,184 +10,759 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
+#include "owl_platform.h"
 #include "owl_table.h"
 
-#define OWL_TRIE_BITS 4
-#define OWL_TRIE_FACTOR (1 << OWL_TRIE_BITS)
-#define OWL_TRIE_MASK (OWL_TRIE_FACTOR - 1)
+#if OWL_SSE2
+#include <emmintrin.h>
+#endif
 
-typedef struct owl_TrieNode {
+/*
+ * String keys live in an open addressing table probed 16 control bytes at a
+ * time. A control byte is EMPTY, DELETED or the low 7 bits of a full slot's
+ * hash. The first group is mirrored past the end so a group load never
+ * wraps.
+ */
+#define OWL_GROUP 16
+#define OWL_CTRL_EMPTY ((s8)-128)
+#define OWL_CTRL_DELETED ((s8)-2)
+
+/*
+ * Integer keys below a dense bound index an array directly, the bound grows
+ * only while the array stays a quarter full. Other keys go to a linear
+ * probing map that deletes by backward shifting, so it never holds
+ * tombstones and can shrink.
+ */
+#define OWL_DENSE_MIN 64
+#define OWL_DENSE_MAX 65536
+#define OWL_SPARSE_MIN 16
+
+typedef struct owl_TableSlot {
+  u64 hash;
+  char *name;
   void *value;
-  struct owl_TrieNode *next[OWL_TRIE_FACTOR];
-} owl_TrieNode;
+} owl_TableSlot;
 
 struct owl_Table {
   s32 count;
-  owl_TrieNode *root;
+  s32 size;
+  u32 capacity;
+  u32 used;
+  s8 *ctrl;
+  owl_TableSlot *slots;
+  char *keys;
+  u32 keys_size;
+  u32 keys_dead;
+  void **dense;
+  u32 dense_size;
+  u32 dense_count;
+  u64 *ikeys;
+  void **ivalues;
+  u32 icapacity;
+  u32 isize;
 };
 
-#define owl_trie() (owl_TrieNode *)calloc(1, sizeof(owl_TrieNode))
+/* FNV-1a with a final avalanche so the low 7 bits are usable */
+static u64 owl_hash(const char *name) {
+  const u8 *p = (const u8 *)name;
+  u64 h = 0xCBF29CE484222325ULL;
 
-static void owl_freeTrie(owl_TrieNode *trie) {
+  while (*p)
+    h = (h ^ *p++) * 0x100000001B3ULL;
+
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+
+  return h;
+}
+
+#define owl_h1(hash) ((u32)((hash) >> 7))
+#define owl_h2(hash) ((s8)((hash)&0x7F))
+
+static u32 owl_groupMatch(const s8 *group, s8 h2) {
+#if OWL_SSE2
+  __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+  return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2)));
+#else
+  u32 mask = 0;
   s32 i;
 
-  for (i = 0; i < OWL_TRIE_FACTOR; ++i)
-    if (trie->next[i]) {
-      owl_freeTrie(trie->next[i]);
-      trie->next[i] = NULL;
-    }
+  for (i = 0; i < OWL_GROUP; ++i)
+    if (group[i] == h2)
+      mask |= 1u << i;
 
-  free(trie);
+  return mask;
+#endif
 }
 
-static void owl_trieDtor(owl_Table *table, owl_TrieNode *trie, owl_Dtor dtor) {
+/* EMPTY and DELETED are the only control bytes with the sign bit set */
+static u32 owl_groupFree(const s8 *group) {
+#if OWL_SSE2
+  return (u32)_mm_movemask_epi8(
+      _mm_loadu_si128((const __m128i *)group));
+#else
+  u32 mask = 0;
   s32 i;
 
-  if (trie->value) {
+  for (i = 0; i < OWL_GROUP; ++i)
+    if (group[i] < 0)
+      mask |= 1u << i;
+
+  return mask;
+#endif
+}
+
+static u32 owl_bitScan(u32 mask) {
+  u32 n = 0;
+
+  while (!(mask & 1)) {
+    mask >>= 1;
+    n += 1;
+  }
+  return n;
+}
+
+static void owl_setCtrl(owl_Table *table, u32 index, s8 h2) {
+  table->ctrl[index] = h2;
+
+  if (index < OWL_GROUP)
+    table->ctrl[table->capacity + index] = h2;
+}
+
+static s32 owl_findSlot(owl_Table *table, const char *name, u64 hash) {
+  u32 mask = table->capacity - 1, pos, stride = 0, bits, index;
+  const s8 *group;
+
+  if (table->capacity == 0)
+    return -1;
+
+  pos = owl_h1(hash) & mask;
+
+  for (;;) {
+    group = table->ctrl + pos;
+    bits = owl_groupMatch(group, owl_h2(hash));
+
+    while (bits) {
+      index = (pos + owl_bitScan(bits)) & mask;
+
+      if (table->slots[index].hash == hash &&
+          0 == strcmp(table->slots[index].name, name))
+        return (s32)index;
+
+      bits &= bits - 1;
+    }
+
+    if (owl_groupMatch(group, OWL_CTRL_EMPTY))
+      return -1;
+
+    stride += OWL_GROUP;
+    pos = (pos + stride) & mask;
+  }
+}
+
+static u32 owl_freeSlot(owl_Table *table, u64 hash) {
+  u32 mask = table->capacity - 1, pos, stride = 0, bits;
+
+  pos = owl_h1(hash) & mask;
+
+  while (!(bits = owl_groupFree(table->ctrl + pos))) {
+    stride += OWL_GROUP;
+    pos = (pos + stride) & mask;
+  }
+
+  return (pos + owl_bitScan(bits)) & mask;
+}
+
+/* Keys packed by owl_compactTable stay in the arena until the next one */
+static void owl_freeKey(owl_Table *table, char *name) {
+  if (table->keys && name >= table->keys &&
+      name < table->keys + table->keys_size)
+    table->keys_dead += (u32)strlen(name) + 1;
+  else
+    free(name);
+}
+
+static void owl_releaseSlots(owl_Table *table) {
+  if (table->ctrl)
+    free(table->ctrl);
+
+  if (table->slots)
+    free(table->slots);
+
+  if (table->keys)
+    free(table->keys);
+
+  table->ctrl = NULL;
+  table->slots = NULL;
+  table->keys = NULL;
+  table->capacity = 0;
+  table->used = 0;
+  table->keys_size = 0;
+  table->keys_dead = 0;
+}
+
+static bool owl_rehash(owl_Table *table, u32 capacity) {
+  owl_TableSlot *slots = table->slots, *slot;
+  u32 i, index, old = table->capacity;
+  s8 *ctrl = table->ctrl;
+
+  table->ctrl = (s8 *)malloc(capacity + OWL_GROUP);
+  table->slots = (owl_TableSlot *)malloc(capacity * sizeof(owl_TableSlot));
+
+  if (!table->ctrl || !table->slots) {
+    if (table->ctrl)
+      free(table->ctrl);
+
+    if (table->slots)
+      free(table->slots);
+
+    table->ctrl = ctrl;
+    table->slots = slots;
+    return false;
+  }
+
+  memset(table->ctrl, OWL_CTRL_EMPTY, capacity + OWL_GROUP);
+  table->capacity = capacity;
+  table->used = 0;
+
+  for (i = 0; i < old; ++i) {
+    if (ctrl[i] < 0)
+      continue;
+
+    slot = &slots[i];
+    index = owl_freeSlot(table, slot->hash);
+
+    table->slots[index] = *slot;
+    owl_setCtrl(table, index, owl_h2(slot->hash));
+    table->used += 1;
+  }
+
+  if (ctrl)
+    free(ctrl);
+
+  if (slots)
+    free(slots);
+
+  return true;
+}
+
+/* Keeps the load, tombstones included, under 7/8 */
+static bool owl_reserve(owl_Table *table) {
+  u32 capacity = table->capacity;
+
+  if (capacity && (table->used + 1) * 8 <= capacity * 7)
+    return true;
+
+  if (!capacity)
+    capacity = OWL_GROUP;
+  else if ((u32)(table->size + 1) * 16 > capacity * 7)
+    capacity *= 2;
+
+  return owl_rehash(table, capacity);
+}
+
+/* Gives memory back once the live load falls under 1/16 */
+static void owl_shrink(owl_Table *table) {
+  if (table->size == 0)
+    owl_releaseSlots(table);
+  else if (table->capacity > OWL_GROUP &&
+           (u32)table->size * 16 < table->capacity)
+    owl_rehash(table, table->capacity / 2);
+}
+
+static void owl_clearSlots(owl_Table *table, owl_Dtor dtor) {
+  u32 i;
+
+  for (i = 0; i < table->capacity; ++i) {
+    if (table->ctrl[i] < 0)
+      continue;
+
     if (dtor)
-      dtor(trie->value);
+      dtor(table->slots[i].value);
 
-    trie->value = NULL;
-    table->count -= 1;
+    owl_freeKey(table, table->slots[i].name);
   }
 
-  for (i = 0; i < OWL_TRIE_FACTOR; ++i)
-    if (trie->next[i])
-      owl_trieDtor(table, trie->next[i], dtor);
+  owl_releaseSlots(table);
+  table->size = 0;
 }
 
-static void *owl_setTrie(owl_Table *table, owl_TrieNode *trie, void *value) {
-  void *oldval = trie->value;
+static bool owl_compactSlots(owl_Table *table) {
+  u32 i, len, total = 0, capacity = OWL_GROUP;
+  owl_TableSlot *slot;
+  char *keys, *p;
 
-  if (!oldval)
-    table->count += 1;
+  if (table->size == 0) {
+    owl_releaseSlots(table);
+    return true;
+  }
 
-  trie->value = value;
+  for (i = 0; i < table->capacity; ++i)
+    if (table->ctrl[i] >= 0)
+      total += (u32)strlen(table->slots[i].name) + 1;
 
-  if (!value)
-    table->count -= 1;
+  keys = (char *)malloc(total);
 
-  return oldval;
+  if (!keys)
+    return false;
+
+  for (p = keys, i = 0; i < table->capacity; ++i) {
+    if (table->ctrl[i] < 0)
+      continue;
+
+    slot = &table->slots[i];
+    len = (u32)strlen(slot->name) + 1;
+
+    memcpy(p, slot->name, len);
+    owl_freeKey(table, slot->name);
+
+    slot->name = p;
+    p += len;
+  }
+
+  if (table->keys)
+    free(table->keys);
+
+  table->keys = keys;
+  table->keys_size = total;
+  table->keys_dead = 0;
+
+  while ((u32)table->size * 8 > capacity * 7)
+    capacity *= 2;
+
+  return owl_rehash(table, capacity);
 }
 
-static owl_TrieNode **owl_getTrie(owl_TrieNode **root, const char *name,
-                                  bool build) {
-  owl_TrieNode **node = root;
-  const u8 *p = (const u8 *)name;
-  u8 ch, lo, hi;
+static u64 owl_iHash(u64 key) {
+  key ^= key >> 33;
+  key *= 0xFF51AFD7ED558CCDULL;
+  key ^= key >> 33;
+  key *= 0xC4CEB9FE1A85EC53ULL;
+  key ^= key >> 33;
 
-  if (!name)
-    return NULL;
+  return key;
+}
 
-  while (!!(ch = *p++)) {
-    lo = ch & OWL_TRIE_MASK;
-    hi = ch >> OWL_TRIE_BITS;
+static s32 owl_iFind(owl_Table *table, u64 key) {
+  u32 mask = table->icapacity - 1, index;
 
-    node = &(*node)->next[lo];
+  if (table->icapacity == 0)
+    return -1;
 
-    if (!(*node)) {
-      if (!build)
-        return NULL;
+  for (index = (u32)owl_iHash(key) & mask; table->ivalues[index];
+       index = (index + 1) & mask)
+    if (table->ikeys[index] == key)
+      return (s32)index;
 
-      *node = owl_trie();
+  return -1;
+}
+
+static void owl_iInsert(owl_Table *table, u64 key, void *value) {
+  u32 mask = table->icapacity - 1, index = (u32)owl_iHash(key) & mask;
+
+  while (table->ivalues[index])
+    index = (index + 1) & mask;
+
+  table->ikeys[index] = key;
+  table->ivalues[index] = value;
+  table->isize += 1;
+}
+
+static bool owl_iResize(owl_Table *table, u32 capacity) {
+  u64 *keys = table->ikeys;
+  void **values = table->ivalues;
+  u32 i, old = table->icapacity;
+
+  if (capacity == 0) {
+    table->ikeys = NULL;
+    table->ivalues = NULL;
+  } else {
+    table->ikeys = (u64 *)malloc(capacity * sizeof(u64));
+    table->ivalues = (void **)calloc(capacity, sizeof(void *));
+
+    if (!table->ikeys || !table->ivalues) {
+      if (table->ikeys)
+        free(table->ikeys);
+
+      if (table->ivalues)
+        free(table->ivalues);
+
+      table->ikeys = keys;
+      table->ivalues = values;
+      return false;
     }
+  }
+
+  table->icapacity = capacity;
+  table->isize = 0;
 
-    node = &(*node)->next[hi];
+  for (i = 0; i < old; ++i)
+    if (values[i])
+      owl_iInsert(table, keys[i], values[i]);
 
-    if (!(*node)) {
-      if (!build)
-        return NULL;
+  if (keys)
+    free(keys);
 
-      *node = owl_trie();
+  if (values)
+    free(values);
+
+  return true;
+}
+
+static void owl_iRemove(owl_Table *table, u32 index) {
+  u32 mask = table->icapacity - 1, next, home;
+
+  /* Pull later entries back into the hole unless it is before their home */
+  for (next = (index + 1) & mask; table->ivalues[next];
+       next = (next + 1) & mask) {
+    home = (u32)owl_iHash(table->ikeys[next]) & mask;
+
+    if (((next - home) & mask) >= ((next - index) & mask)) {
+      table->ikeys[index] = table->ikeys[next];
+      table->ivalues[index] = table->ivalues[next];
+      index = next;
     }
   }
-  return node;
+
+  table->ivalues[index] = NULL;
+  table->isize -= 1;
+
+  if (table->isize == 0)
+    owl_iResize(table, 0);
+  else if (table->icapacity > OWL_SPARSE_MIN &&
+           table->isize * 8 < table->icapacity)
+    owl_iResize(table, table->icapacity / 2);
 }
 
-static owl_TrieNode **owl_iGetTrie(owl_TrieNode **root, u64 key, bool build) {
-  owl_TrieNode **node = root;
+static bool owl_denseGrow(owl_Table *table, u64 key) {
+  u32 size = OWL_DENSE_MIN, moved = 0, i;
+  void **dense;
 
-  while (key > 0) {
-    node = &(*node)->next[key & OWL_TRIE_MASK];
+  if (key >= OWL_DENSE_MAX)
+    return false;
 
-    if (!(*node)) {
-      if (!build)
-        return NULL;
+  while (size <= key)
+    size *= 2;
 
-      *node = owl_trie();
+  if (size > OWL_DENSE_MIN && size > ((u32)table->count + 1) * 4)
+    return false;
+
+  dense = (void **)realloc(table->dense, size * sizeof(void *));
+
+  if (!dense)
+    return false;
+
+  memset(dense + table->dense_size, 0,
+         (size - table->dense_size) * sizeof(void *));
+
+  table->dense = dense;
+  table->dense_size = size;
+
+  /* Sparse keys now inside the dense range move over */
+  for (i = 0; i < table->icapacity; ++i)
+    if (table->ivalues[i] && table->ikeys[i] < size) {
+      dense[table->ikeys[i]] = table->ivalues[i];
+      table->dense_count += 1;
+      table->ivalues[i] = NULL;
+      moved += 1;
     }
 
-    key = key >> OWL_TRIE_BITS;
-  }
-  return node;
+  /* Rebuilding also repairs the probe chains the moves broke */
+  if (moved)
+    owl_iResize(table, table->isize > moved ? table->icapacity : 0);
+
+  return true;
 }
 
-owl_Table *owl_table(void) {
-  owl_Table *table = (owl_Table *)malloc(sizeof(owl_Table));
+static void owl_clearInts(owl_Table *table, owl_Dtor dtor) {
+  u32 i;
 
-  if (!table)
-    return NULL;
+  if (dtor) {
+    for (i = 0; i < table->dense_size; ++i)
+      if (table->dense[i])
+        dtor(table->dense[i]);
+
+    for (i = 0; i < table->icapacity; ++i)
+      if (table->ivalues[i])
+        dtor(table->ivalues[i]);
+  }
+
+  if (table->dense)
+    free(table->dense);
+
+  if (table->ikeys)
+    free(table->ikeys);
+
+  if (table->ivalues)
+    free(table->ivalues);
+
+  table->dense = NULL;
+  table->dense_size = 0;
+  table->dense_count = 0;
+
+  table->ikeys = NULL;
+  table->ivalues = NULL;
+  table->icapacity = 0;
+  table->isize = 0;
 
   table->count = 0;
-  table->root = owl_trie();
+}
 
-  return table;
+owl_Table *owl_table(void) {
+  return (owl_Table *)calloc(1, sizeof(owl_Table));
 }
 
 void owl_freeTable(owl_Table *table, owl_Dtor dtor) {
-  owl_trieDtor(table, table->root, dtor);
-  owl_freeTrie(table->root);
+  owl_clearSlots(table, dtor);
+  owl_clearInts(table, dtor);
   free(table);
 }
 
 void owl_clearTable(owl_Table *table, owl_Dtor dtor) {
-  owl_TrieNode *root = table->root;
-  s32 i;
+  owl_clearSlots(table, dtor);
+  owl_clearInts(table, dtor);
+}
 
-  owl_trieDtor(table, root, dtor);
+s32 owl_tableSize(owl_Table *table) { return table->count + table->size; }
 
-  for (i = 0; i < OWL_TRIE_FACTOR; ++i)
-    if (root->next[i]) {
-      owl_freeTrie(root->next[i]);
-      root->next[i] = NULL;
-    }
+void owl_tableStats(owl_Table *table, owl_TableStats *stats) {
+  u32 i;
+
+  memset(stats, 0, sizeof(owl_TableStats));
+
+  stats->entries = table->count + table->size;
+  stats->slots = table->capacity + table->dense_size + table->icapacity;
+  stats->tombstones = table->used - (u32)table->size;
+  stats->key_waste = table->keys_dead;
+
+  stats->bytes = sizeof(owl_Table) + table->keys_size;
+  stats->bytes += table->dense_size * sizeof(void *);
+  stats->bytes += table->icapacity * (sizeof(u64) + sizeof(void *));
+
+  if (!table->capacity)
+    return;
+
+  stats->bytes += table->capacity + OWL_GROUP;
+  stats->bytes += table->capacity * sizeof(owl_TableSlot);
+
+  for (i = 0; i < table->capacity; ++i) {
+    const char *name = table->slots[i].name;
+
+    if (table->ctrl[i] < 0)
+      continue;
+
+    if (name < table->keys || name >= table->keys + table->keys_size)
+      stats->bytes += strlen(name) + 1;
+  }
 }
 
-s32 owl_tableSize(owl_Table *table) { return table->count; }
+bool owl_compactTable(owl_Table *table) {
+  u32 top = 0, size = OWL_DENSE_MIN, capacity = OWL_SPARSE_MIN, i;
+  void **dense;
+
+  if (!owl_compactSlots(table))
+    return false;
+
+  if (table->dense_count == 0 && table->dense) {
+    free(table->dense);
+    table->dense = NULL;
+    table->dense_size = 0;
+  } else if (table->dense) {
+    for (i = 0; i < table->dense_size; ++i)
+      if (table->dense[i])
+        top = i;
+
+    while (size <= top)
+      size *= 2;
+
+    if (size < table->dense_size) {
+      dense = (void **)realloc(table->dense, size * sizeof(void *));
+
+      if (dense) {
+        table->dense = dense;
+        table->dense_size = size;
+      }
+    }
+  }
+
+  if (!table->isize)
+    return true;
+
+  while (table->isize * 4 > capacity * 3)
+    capacity *= 2;
+
+  return capacity >= table->icapacity || owl_iResize(table, capacity);
+}
 
 void *owl_setTable(owl_Table *table, const char *name, void *value) {
-  owl_TrieNode **node = owl_getTrie(&table->root, name, true);
+  owl_TableSlot *slot;
+  void *oldval;
+  u64 hash;
+  s32 index;
+  u32 free_index;
 
-  if (!node)
+  if (!name)
     return NULL;
 
-  return owl_setTrie(table, *node, value);
+  hash = owl_hash(name);
+  index = owl_findSlot(table, name, hash);
+
+  if (index >= 0) {
+    slot = &table->slots[index];
+    oldval = slot->value;
+
+    if (value) {
+      slot->value = value;
+      return oldval;
+    }
+
+    owl_freeKey(table, slot->name);
+    owl_setCtrl(table, (u32)index, OWL_CTRL_DELETED);
+    table->size -= 1;
+
+    owl_shrink(table);
+    return oldval;
+  }
+
+  if (!value || !owl_reserve(table))
+    return NULL;
+
+  free_index = owl_freeSlot(table, hash);
+  slot = &table->slots[free_index];
+  slot->name = strdup(name);
+
+  if (!slot->name)
+    return NULL;
+
+  slot->hash = hash;
+  slot->value = value;
+
+  if (table->ctrl[free_index] == OWL_CTRL_EMPTY)
+    table->used += 1;
+
+  owl_setCtrl(table, free_index, owl_h2(hash));
+  table->size += 1;
+
+  return NULL;
 }
 
 void *owl_getTable(owl_Table *table, const char *name) {
-  owl_TrieNode **node = owl_getTrie(&table->root, name, false);
+  s32 index;
+
+  if (!name)
+    return NULL;
 
-  if (!node)
+  index = owl_findSlot(table, name, owl_hash(name));
+
+  if (index < 0)
     return NULL;
 
-  return (*node)->value;
+  return table->slots[index].value;
 }
 
 void *owl_iSetTable(owl_Table *table, u64 key, void *value) {
-  owl_TrieNode **node = owl_iGetTrie(&table->root, key, true);
+  void *oldval;
+  s32 index;
 
-  if (!node)
+  if (!value)
+    return owl_iDelTable(table, key);
+
+  if (key < table->dense_size) {
+    oldval = table->dense[key];
+    table->dense[key] = value;
+
+    if (!oldval) {
+      table->dense_count += 1;
+      table->count += 1;
+    }
+    return oldval;
+  }
+
+  index = owl_iFind(table, key);
+
+  if (index >= 0) {
+    oldval = table->ivalues[index];
+    table->ivalues[index] = value;
+    return oldval;
+  }
+
+  if (owl_denseGrow(table, key)) {
+    table->dense[key] = value;
+    table->dense_count += 1;
+    table->count += 1;
     return NULL;
+  }
+
+  if ((table->isize + 1) * 4 > table->icapacity * 3 &&
+      !owl_iResize(table, table->icapacity ? table->icapacity * 2
+                                           : OWL_SPARSE_MIN))
+    return NULL;
+
+  owl_iInsert(table, key, value);
+  table->count += 1;
 
-  return owl_setTrie(table, *node, value);
+  return NULL;
 }
 
 void *owl_iGetTable(owl_Table *table, u64 key) {
-  owl_TrieNode **node = owl_iGetTrie(&table->root, key, false);
+  s32 index;
 
-  if (!node)
+  if (key < table->dense_size)
+    return table->dense[key];
+
+  index = owl_iFind(table, key);
+
+  if (index < 0)
     return NULL;
 
-  return (*node)->value;
+  return table->ivalues[index];
+}
+
+void *owl_iDelTable(owl_Table *table, u64 key) {
+  void *oldval;
+  s32 index;
+
+  if (key < table->dense_size) {
+    oldval = table->dense[key];
+
+    if (!oldval)
+      return NULL;
+
+    table->dense[key] = NULL;
+    table->dense_count -= 1;
+    table->count -= 1;
+
+    if (table->dense_count == 0) {
+      free(table->dense);
+      table->dense = NULL;
+      table->dense_size = 0;
+    }
+    return oldval;
+  }
+
+  index = owl_iFind(table, key);
+
+  if (index < 0)
+    return NULL;
+
+  oldval = table->ivalues[index];
+  owl_iRemove(table, (u32)index);
+  table->count -= 1;
+
+  return oldval;
+}
+
+void owl_iEachTable(owl_Table *table, owl_IEach each, void *ud) {
+  u32 i;
+
+  for (i = 0; i < table->dense_size; ++i)
+    if (table->dense[i])
+      each((u64)i, table->dense[i], ud);
+
+  for (i = 0; i < table->icapacity; ++i)
+    if (table->ivalues[i])
+      each(table->ikeys[i], table->ivalues[i], ud);
 }
@@ -20,15 +20,28 @@ extern "C" {
 
 typedef struct owl_Table owl_Table;
 typedef void (*owl_Dtor)(void *);
+typedef void (*owl_IEach)(u64 key, void *value, void *ud);
+
+typedef struct owl_TableStats {
+  u64 bytes;
+  u32 entries;
+  u32 slots;
+  u32 tombstones;
+  u32 key_waste;
+} owl_TableStats;
 
 extern owl_Table *owl_table(void);
 extern void owl_freeTable(owl_Table *table, owl_Dtor dtor);
 extern void owl_clearTable(owl_Table *table, owl_Dtor dtor);
 extern s32 owl_tableSize(owl_Table *table);
+extern void owl_tableStats(owl_Table *table, owl_TableStats *stats);
+extern bool owl_compactTable(owl_Table *table);
 extern void *owl_setTable(owl_Table *table, const char *name, void *value);
 extern void *owl_getTable(owl_Table *table, const char *name);
 extern void *owl_iSetTable(owl_Table *table, u64 key, void *value);
 extern void *owl_iGetTable(owl_Table *table, u64 key);
+extern void *owl_iDelTable(owl_Table *table, u64 key);
+extern void owl_iEachTable(owl_Table *table, owl_IEach each, void *ud);
 
 #ifdef __cplusplus
 };
@@ -0,0 +1,74 @@
+/*
+ * owl_tex.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_TEX_H__
+#define __OWL_TEX_H__
+
+#include "owl.h"
+
+/*
+ * An .owltex is a header followed by RGBA8 rows, top to bottom, either
+ * stored raw so they can be uploaded straight from a mapping or packed
+ * with owl_lz. All fields are little-endian.
+ */
+
+#define OWL_TEX_MAGIC 0x58544C4F /* "OLTX" */
+#define OWL_TEX_VERSION 1
+
+#define OWL_TEX_RAW 0
+#define OWL_TEX_LZ 1
+
+#define OWL_TEX_PREMULTIPLIED 0x0001
+#define OWL_TEX_COLORKEYED 0x0002
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct owl_TexHeader {
+  u32 magic;
+  u16 version;
+  u16 flags;
+  u32 width;
+  u32 height;
+  u32 size;
+  u32 packed;
+  u32 offset;
+  u16 codec;
+  u16 reserved;
+} owl_TexHeader;
+
+OWL_INLINE const owl_TexHeader *owl_texHeader(const u8 *data, s64 size) {
+  const owl_TexHeader *tex = (const owl_TexHeader *)data;
+
+  if (size < (s64)sizeof(owl_TexHeader) || tex->magic != OWL_TEX_MAGIC ||
+      tex->version != OWL_TEX_VERSION)
+    return NULL;
+
+  if (tex->width == 0 || tex->height == 0 || tex->width > 0xFFFF ||
+      tex->height > 0xFFFF || (u64)tex->width * tex->height * 4 != tex->size)
+    return NULL;
+
+  if (tex->offset < sizeof(owl_TexHeader) ||
+      (s64)tex->offset + tex->packed > size)
+    return NULL;
+
+  if (tex->codec == OWL_TEX_RAW)
+    return tex->packed == tex->size ? tex : NULL;
+
+  return tex->codec == OWL_TEX_LZ ? tex : NULL;
+}
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_TEX_H__ */
@@ -0,0 +1,528 @@
+/*
+ * owl_vfs.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "miniz/miniz.h"
+
+#include "owl_io.h"
+#include "owl_lz.h"
+#include "owl_pak.h"
+#include "owl_table.h"
+#include "owl_vfs.h"
+
+#define OWL_VFS_PATH 512
+
+#define OWL_VFS_POOL_MIN 12
+#define OWL_VFS_POOL_MAX 24
+#define OWL_VFS_POOL_CLASSES (OWL_VFS_POOL_MAX - OWL_VFS_POOL_MIN + 1)
+#define OWL_VFS_POOL_DEPTH 4
+
+#define OWL_ZIP_LOCAL 0x04034b50
+#define OWL_ZIP_CENTRAL 0x02014b50
+#define OWL_ZIP_END 0x06054b50
+
+#define OWL_ZIP_LOCAL_SIZE 30
+#define OWL_ZIP_CENTRAL_SIZE 46
+#define OWL_ZIP_END_SIZE 22
+
+#define OWL_ZIP_STORED 0
+#define OWL_ZIP_DEFLATED 8
+
+typedef struct owl_ZipEntry {
+  u32 offset;
+  u32 compressed;
+  u32 size;
+  u16 method;
+} owl_ZipEntry;
+
+typedef struct owl_Pack {
+  char *name;
+  const u8 *data;
+  s64 size;
+  const owl_PakHeader *pak;
+  owl_ZipEntry *entries;
+  owl_Table *index;
+  SDL_atomic_t refs;
+  struct owl_Pack *next;
+} owl_Pack;
+
+typedef struct owl_PoolClass {
+  u8 *buffers[OWL_VFS_POOL_DEPTH];
+  s32 count;
+} owl_PoolClass;
+
+static owl_Pack *packs = NULL;
+static SDL_SpinLock packs_lock = 0;
+
+static owl_PoolClass pool[OWL_VFS_POOL_CLASSES];
+static SDL_SpinLock pool_lock = 0;
+
+OWL_INLINE u16 owl_read16(const u8 *p) { return (u16)(p[0] | (p[1] << 8)); }
+
+OWL_INLINE u32 owl_read32(const u8 *p) {
+  return (u32)p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24);
+}
+
+static u8 *owl_poolAlloc(u32 size, s32 *index) {
+  u8 *buffer = NULL;
+  s32 bits = OWL_VFS_POOL_MIN;
+
+  while (bits <= OWL_VFS_POOL_MAX && ((u32)1 << bits) < size)
+    bits += 1;
+
+  if (bits > OWL_VFS_POOL_MAX) {
+    *index = -1;
+    return (u8 *)malloc(size);
+  }
+
+  *index = bits - OWL_VFS_POOL_MIN;
+
+  SDL_AtomicLock(&pool_lock);
+
+  if (pool[*index].count > 0)
+    buffer = pool[*index].buffers[--pool[*index].count];
+
+  SDL_AtomicUnlock(&pool_lock);
+
+  return buffer ? buffer : (u8 *)malloc((size_t)1 << bits);
+}
+
+static void owl_poolFree(u8 *buffer, s32 index) {
+  if (index >= 0) {
+    SDL_AtomicLock(&pool_lock);
+
+    if (pool[index].count < OWL_VFS_POOL_DEPTH) {
+      pool[index].buffers[pool[index].count++] = buffer;
+      buffer = NULL;
+    }
+
+    SDL_AtomicUnlock(&pool_lock);
+  }
+
+  if (buffer)
+    free(buffer);
+}
+
+static void owl_poolQuit(void) {
+  s32 i;
+
+  for (i = 0; i < OWL_VFS_POOL_CLASSES; ++i)
+    while (pool[i].count > 0)
+      free(pool[i].buffers[--pool[i].count]);
+}
+
+static const char *owl_vfsName(const char *path) {
+  while (path[0] == '.' && (path[1] == '/' || path[1] == '\\'))
+    path += 2;
+
+  return path;
+}
+
+static void owl_releasePack(owl_Pack *pack) {
+  if (!SDL_AtomicDecRef(&pack->refs))
+    return;
+
+  if (pack->index)
+    owl_freeTable(pack->index, NULL);
+
+  if (pack->entries)
+    free(pack->entries);
+
+  owl_unmapFile(pack->data, pack->size);
+  free(pack->name);
+  free(pack);
+}
+
+static const u8 *owl_zipEnd(const u8 *data, s64 size) {
+  s64 i, limit;
+
+  if (size < OWL_ZIP_END_SIZE)
+    return NULL;
+
+  limit = size - OWL_ZIP_END_SIZE - 0xFFFF;
+
+  if (limit < 0)
+    limit = 0;
+
+  /* The end record sits behind an optional comment of up to 64 KB */
+  for (i = size - OWL_ZIP_END_SIZE; i >= limit; --i)
+    if (owl_read32(data + i) == OWL_ZIP_END)
+      return data + i;
+
+  return NULL;
+}
+
+static bool owl_zipIndex(owl_Pack *pack) {
+  char name[OWL_VFS_PATH];
+  const u8 *end, *p, *last;
+  owl_ZipEntry *entry;
+  u32 i, count, offset, length, extra, comment;
+
+  end = owl_zipEnd(pack->data, pack->size);
+
+  if (!end)
+    return false;
+
+  count = owl_read16(end + 10);
+  offset = owl_read32(end + 16);
+
+  if ((s64)offset + owl_read32(end + 12) > end - pack->data)
+    return false;
+
+  pack->entries = (owl_ZipEntry *)calloc(count ? count : 1,
+                                         sizeof(owl_ZipEntry));
+  pack->index = owl_table();
+
+  if (!pack->entries || !pack->index)
+    return false;
+
+  p = pack->data + offset;
+  last = end;
+  entry = pack->entries;
+
+  for (i = 0; i < count; ++i) {
+    if (p + OWL_ZIP_CENTRAL_SIZE > last || owl_read32(p) != OWL_ZIP_CENTRAL)
+      return false;
+
+    length = owl_read16(p + 28);
+    extra = owl_read16(p + 30);
+    comment = owl_read16(p + 32);
+
+    if (p + OWL_ZIP_CENTRAL_SIZE + length + extra + comment > last)
+      return false;
+
+    entry->method = owl_read16(p + 10);
+    entry->compressed = owl_read32(p + 20);
+    entry->size = owl_read32(p + 24);
+    entry->offset = owl_read32(p + 42);
+
+    /* Directories, encrypted and unsupported entries are left out */
+    if (length > 0 && length < OWL_VFS_PATH &&
+        p[OWL_ZIP_CENTRAL_SIZE + length - 1] != '/' &&
+        !(owl_read16(p + 8) & 1) &&
+        (entry->method == OWL_ZIP_STORED ||
+         entry->method == OWL_ZIP_DEFLATED)) {
+      memcpy(name, p + OWL_ZIP_CENTRAL_SIZE, length);
+      name[length] = '\0';
+
+      owl_setTable(pack->index, name, entry);
+      entry += 1;
+    }
+
+    p += OWL_ZIP_CENTRAL_SIZE + length + extra + comment;
+  }
+
+  return true;
+}
+
+static bool owl_zipOpen(owl_Pack *pack, owl_ZipEntry *entry, owl_File *file) {
+  const u8 *local, *data;
+  u32 length, extra;
+
+  if ((s64)entry->offset + OWL_ZIP_LOCAL_SIZE > pack->size)
+    return false;
+
+  local = pack->data + entry->offset;
+
+  if (owl_read32(local) != OWL_ZIP_LOCAL)
+    return false;
+
+  length = owl_read16(local + 26);
+  extra = owl_read16(local + 28);
+  data = local + OWL_ZIP_LOCAL_SIZE + length + extra;
+
+  if (data - pack->data + (s64)entry->compressed > pack->size)
+    return false;
+
+  file->pack = pack;
+
+  /* Stored entries are served straight out of the archive mapping */
+  if (entry->method == OWL_ZIP_STORED) {
+    if (entry->compressed != entry->size)
+      return false;
+
+    file->data = data;
+    file->size = entry->size;
+    return true;
+  }
+
+  file->buffer = owl_poolAlloc(entry->size ? entry->size : 1, &file->pool);
+
+  if (!file->buffer)
+    return false;
+
+  if (tinfl_decompress_mem_to_mem(file->buffer, entry->size, data,
+                                  entry->compressed, 0) != entry->size) {
+    owl_poolFree(file->buffer, file->pool);
+    file->buffer = NULL;
+    return false;
+  }
+
+  file->data = file->buffer;
+  file->size = entry->size;
+  return true;
+}
+
+static bool owl_pakIndex(owl_Pack *pack) {
+  const owl_PakHeader *pak = (const owl_PakHeader *)pack->data;
+  const owl_PakEntry *entries;
+  const u32 *slots, *displace;
+  u64 size = pack->size > 0 ? (u64)pack->size : 0;
+  u32 i;
+
+  if (pak->version != OWL_PAK_VERSION || pak->count == 0 ||
+      pak->buckets == 0 || pak->entries % 8 != 0 || pak->slots % 4 != 0 ||
+      pak->displace % 4 != 0)
+    return false;
+
+  /* Offsets and counts are u32, so none of this can overflow in u64 */
+  if ((u64)pak->entries + (u64)pak->count * sizeof(owl_PakEntry) > size ||
+      (u64)pak->slots + (u64)pak->count * sizeof(u32) > size ||
+      (u64)pak->displace + (u64)pak->buckets * sizeof(u32) > size)
+    return false;
+
+  entries = (const owl_PakEntry *)(pack->data + pak->entries);
+  slots = (const u32 *)(pack->data + pak->slots);
+  displace = (const u32 *)(pack->data + pak->displace);
+
+  /* Validate once here so lookups never have to */
+  for (i = 0; i < pak->count; ++i) {
+    if (slots[i] >= pak->count)
+      return false;
+
+    if ((u64)pak->names + entries[i].name + entries[i].length > size ||
+        entries[i].offset > size ||
+        entries[i].packed > size - entries[i].offset)
+      return false;
+
+    if (entries[i].codec == OWL_PAK_RAW) {
+      if (entries[i].packed != entries[i].size)
+        return false;
+    } else if (entries[i].codec != OWL_PAK_LZ)
+      return false;
+  }
+
+  for (i = 0; i < pak->buckets; ++i)
+    if ((displace[i] & OWL_PAK_DIRECT) &&
+        (displace[i] & ~OWL_PAK_DIRECT) >= pak->count)
+      return false;
+
+  pack->pak = pak;
+  return true;
+}
+
+static const owl_PakEntry *owl_pakFind(owl_Pack *pack, const char *name) {
+  const owl_PakHeader *pak = pack->pak;
+  const owl_PakEntry *entry;
+  const u32 *slots, *displace;
+  u32 hash, length = (u32)strlen(name);
+
+  slots = (const u32 *)(pack->data + pak->slots);
+  displace = (const u32 *)(pack->data + pak->displace);
+
+  hash = owl_pakHash(name, length, 0);
+  entry = (const owl_PakEntry *)(pack->data + pak->entries) +
+          slots[owl_pakSlot(displace, pak->buckets, pak->count, name, length,
+                            hash)];
+
+  /* A perfect hash maps unknown names somewhere too, so confirm the key */
+  if (entry->hash != hash || entry->length != length ||
+      0 != memcmp(pack->data + pak->names + entry->name, name, length))
+    return NULL;
+
+  return entry;
+}
+
+static bool owl_pakOpen(owl_Pack *pack, const owl_PakEntry *entry,
+                        owl_File *file) {
+  const u8 *data = pack->data + entry->offset;
+
+  file->pack = pack;
+
+  if (entry->codec == OWL_PAK_RAW) {
+    file->data = data;
+    file->size = entry->size;
+    return true;
+  }
+
+  file->buffer = owl_poolAlloc(entry->size ? entry->size : 1, &file->pool);
+
+  if (!file->buffer)
+    return false;
+
+  if (owl_lzDecompress(data, (s32)entry->packed, file->buffer,
+                       (s32)entry->size) != (s32)entry->size) {
+    owl_poolFree(file->buffer, file->pool);
+    file->buffer = NULL;
+    return false;
+  }
+
+  file->data = file->buffer;
+  file->size = entry->size;
+  return true;
+}
+
+bool owl_mount(const char *archive) {
+  owl_Pack *pack;
+
+  if (!archive)
+    return false;
+
+  for (pack = packs; pack; pack = pack->next)
+    if (0 == strcmp(pack->name, archive))
+      return true;
+
+  pack = (owl_Pack *)calloc(1, sizeof(owl_Pack));
+
+  if (!pack)
+    return false;
+
+  SDL_AtomicSet(&pack->refs, 1);
+
+  pack->name = strdup(archive);
+  pack->data = owl_mapFile(archive, &pack->size);
+
+  if (!pack->name || !pack->data) {
+    owl_releasePack(pack);
+    return false;
+  }
+
+  if (pack->size >= (s64)sizeof(owl_PakHeader) &&
+      owl_read32(pack->data) == OWL_PAK_MAGIC) {
+    if (!owl_pakIndex(pack)) {
+      owl_releasePack(pack);
+      return false;
+    }
+  } else if (!owl_zipIndex(pack)) {
+    owl_releasePack(pack);
+    return false;
+  }
+
+  /* The newest mount shadows older ones and the file system */
+  SDL_AtomicLock(&packs_lock);
+  pack->next = packs;
+  packs = pack;
+  SDL_AtomicUnlock(&packs_lock);
+
+  return true;
+}
+
+void owl_unmount(const char *archive) {
+  owl_Pack **link, *pack = NULL;
+
+  if (!archive)
+    return;
+
+  SDL_AtomicLock(&packs_lock);
+
+  for (link = &packs; *link; link = &(*link)->next)
+    if (0 == strcmp((*link)->name, archive)) {
+      pack = *link;
+      *link = pack->next;
+      break;
+    }
+
+  SDL_AtomicUnlock(&packs_lock);
+
+  /* Files still open keep the archive mapped until they are closed */
+  if (pack)
+    owl_releasePack(pack);
+}
+
+bool owl_vfsOpen(owl_File *file, const char *path) {
+  const void *entry = NULL;
+  owl_Pack *pack;
+  const char *name;
+  bool ok;
+
+  memset(file, 0, sizeof(owl_File));
+
+  if (!path)
+    return false;
+
+  name = owl_vfsName(path);
+
+  SDL_AtomicLock(&packs_lock);
+
+  for (pack = packs; pack; pack = pack->next) {
+    entry = pack->pak ? (const void *)owl_pakFind(pack, name)
+                      : owl_getTable(pack->index, name);
+
+    if (entry) {
+      SDL_AtomicIncRef(&pack->refs);
+      break;
+    }
+  }
+
+  SDL_AtomicUnlock(&packs_lock);
+
+  if (!entry) {
+    file->data = owl_mapFile(path, &file->size);
+    return file->data != NULL;
+  }
+
+  if (pack->pak)
+    ok = owl_pakOpen(pack, (const owl_PakEntry *)entry, file);
+  else
+    ok = owl_zipOpen(pack, (owl_ZipEntry *)entry, file);
+
+  if (!ok) {
+    owl_releasePack(pack);
+    memset(file, 0, sizeof(owl_File));
+  }
+
+  return ok;
+}
+
+void owl_vfsClose(owl_File *file) {
+  if (file->buffer)
+    owl_poolFree(file->buffer, file->pool);
+
+  if (file->pack)
+    owl_releasePack((owl_Pack *)file->pack);
+  else
+    owl_unmapFile(file->data, file->size);
+
+  memset(file, 0, sizeof(owl_File));
+}
+
+u8 *owl_vfsRead(const char *path) {
+  owl_File file;
+  u8 *data;
+
+  if (!owl_vfsOpen(&file, path))
+    return NULL;
+
+  data = (u8 *)malloc((size_t)file.size + 1);
+
+  if (data) {
+    memcpy(data, file.data, (size_t)file.size);
+    data[file.size] = 0;
+  }
+
+  owl_vfsClose(&file);
+  return data;
+}
+
+void owl_vfsQuit(void) {
+  owl_Pack *pack;
+
+  while (packs) {
+    pack = packs;
+    packs = pack->next;
+    owl_releasePack(pack);
+  }
+
+  owl_poolQuit();
+}
@@ -0,0 +1,38 @@
+/*
+ * owl_vfs.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_VFS_H__
+#define __OWL_VFS_H__
+
+#include "owl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct owl_File {
+  const u8 *data;
+  s64 size;
+  void *pack;
+  u8 *buffer;
+  s32 pool;
+} owl_File;
+
+extern bool owl_vfsOpen(owl_File *file, const char *path);
+extern void owl_vfsClose(owl_File *file);
+extern u8 *owl_vfsRead(const char *path);
+extern void owl_vfsQuit(void);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_VFS_H__ */
@@ -101,6 +101,14 @@
 #define OWL_AUDIO_S32 4
 #define OWL_AUDIO_F32 5
 
+#define OWL_ASSET_IMAGE 0
+#define OWL_ASSET_FONT 1
+#define OWL_ASSET_SOUND 2
+
+#define OWL_ASYNC_PENDING 0
+#define OWL_ASYNC_DONE 1
+#define OWL_ASYNC_FAILED 2
+
 #define OWL_EVENT_BASE 0x100
 #define OWL_EVENT_QUIT (OWL_EVENT_BASE + 0)
 #define OWL_EVENT_KEYDOWN (OWL_EVENT_BASE + 1)
@@ -169,7 +177,50 @@ typedef struct owl_Matrix {
 } owl_Matrix;
 
 typedef u32 owl_Audio;
+typedef u32 owl_Voice;
 typedef struct GPU_Image owl_Canvas;
+typedef struct owl_SpriteBatch owl_SpriteBatch;
+typedef struct owl_CommandList owl_CommandList;
+typedef struct owl_Mesh owl_Mesh;
+typedef struct owl_Atlas owl_Atlas;
+typedef struct owl_Async owl_Async;
+
+typedef struct owl_Job owl_Job;
+
+typedef void (*owl_AsyncDone)(owl_Async *async, void *ud);
+typedef void (*owl_JobFunc)(owl_Job *job, void *ud);
+typedef void (*owl_ForFunc)(s32 first, s32 last, void *ud);
+typedef bool (*owl_UpdateFunc)(f64 dt, void *ud);
+typedef void (*owl_RenderFunc)(f64 alpha, void *ud);
+typedef void (*owl_RecordFunc)(void *frame, f64 alpha, void *ud);
+typedef void (*owl_SubmitFunc)(void *frame, void *ud);
+
+typedef struct owl_CacheStats {
+  u32 hits;
+  u32 misses;
+  u32 writes;
+  u32 evictions;
+  u64 bytes;
+} owl_CacheStats;
+
+typedef struct owl_FrameStats {
+  u32 frames;
+  u32 missed;
+  f64 last;
+  f64 average;
+  f64 min;
+  f64 max;
+  f64 jitter;
+} owl_FrameStats;
+
+typedef struct owl_Pipeline {
+  u32 hz;
+  void *frames[2];
+  owl_UpdateFunc update;
+  owl_RecordFunc record;
+  owl_SubmitFunc submit;
+  void *ud;
+} owl_Pipeline;
 
 typedef struct owl_Event {
   u32 type;
@@ -367,9 +418,24 @@ OWL_API void owl_sleep(u32 ms);
 OWL_API bool owl_init(s32 width, s32 height, const char *title, s32 flags);
 OWL_API void owl_quit(void);
 
+OWL_API bool owl_mount(const char *archive);
+OWL_API void owl_unmount(const char *archive);
+
+OWL_API bool owl_assetCache(const char *dir, u64 limit);
+OWL_API void owl_cacheStats(owl_CacheStats *stats);
+
 OWL_API bool owl_setFPS(u32 rate);
 OWL_API u32 owl_getFPS(void);
 OWL_API u32 owl_wait(void);
+OWL_API bool owl_vsync(bool onoff);
+OWL_API void owl_frameStats(owl_FrameStats *stats);
+OWL_API void owl_resetFrameStats(void);
+
+OWL_API bool owl_loop(u32 hz, owl_UpdateFunc update, owl_RenderFunc render,
+                      void *ud);
+OWL_API bool owl_pipeline(const owl_Pipeline *pipeline);
+OWL_API void owl_loopClamp(u32 steps);
+OWL_API void owl_stopLoop(void);
 
 OWL_API bool owl_event(owl_Event *event);
 OWL_API const u8 *owl_keystate(void);
@@ -424,6 +490,18 @@ OWL_API void owl_fillTrigon(f32 x1, f32 y1, f32 x2, f32 y2, f32 x3, f32 y3);
 OWL_API void owl_rectRound(f32 x, f32 y, f32 w, f32 h, f32 radius);
 OWL_API void owl_fillRectRound(f32 x, f32 y, f32 w, f32 h, f32 radius);
 
+OWL_API void owl_pixels(const owl_Point *points, const owl_Pixel *colors,
+                        s32 count);
+/* count segments, points holds them as 2 * count consecutive pairs */
+OWL_API void owl_lines(const owl_Point *points, const owl_Pixel *colors,
+                       s32 count);
+OWL_API void owl_rects(const owl_Rect *rects, const owl_Pixel *colors,
+                       s32 count);
+OWL_API void owl_fillRects(const owl_Rect *rects, const owl_Pixel *colors,
+                           s32 count);
+OWL_API void owl_circles(const owl_Point *centers, const f32 *radii,
+                         const owl_Pixel *colors, s32 count);
+
 OWL_API void owl_polygon(const owl_Point *points, s32 num_points, bool close);
 OWL_API void owl_fillPolygon(const owl_Point *points, s32 num_points);
 
@@ -438,11 +516,64 @@ OWL_API void owl_blit(owl_Canvas *canvas, const owl_Rect *srcrect,
                       const owl_Point *center, u8 flip);
 OWL_API void owl_present(void);
 
+OWL_API owl_SpriteBatch *owl_spriteBatch(s32 capacity);
+OWL_API void owl_freeSpriteBatch(owl_SpriteBatch *batch);
+OWL_API void owl_batchBegin(owl_SpriteBatch *batch);
+OWL_API void owl_batchDraw(owl_SpriteBatch *batch, owl_Canvas *canvas,
+                           const owl_Rect *srcrect, const owl_Rect *dstrect,
+                           f32 degrees, const owl_Point *center, u8 flip);
+OWL_API void owl_batchEnd(owl_SpriteBatch *batch);
+
+OWL_API owl_CommandList *owl_commandList(void);
+OWL_API void owl_freeCommandList(owl_CommandList *list);
+OWL_API void owl_clearCommandList(owl_CommandList *list);
+OWL_API void owl_record(owl_CommandList *list);
+OWL_API void owl_layer(u16 layer);
+OWL_API void owl_replay(owl_CommandList *list, bool sort);
+
+OWL_API owl_Mesh *owl_mesh(void);
+OWL_API void owl_freeMesh(owl_Mesh *mesh);
+OWL_API void owl_clearMesh(owl_Mesh *mesh);
+OWL_API bool owl_meshFillRect(owl_Mesh *mesh, f32 x, f32 y, f32 w, f32 h);
+OWL_API bool owl_meshFillArc(owl_Mesh *mesh, f32 x, f32 y, f32 radius,
+                             f32 start_angle, f32 end_angle);
+OWL_API bool owl_meshFillCircle(owl_Mesh *mesh, f32 x, f32 y, f32 radius);
+OWL_API bool owl_meshFillEllipse(owl_Mesh *mesh, f32 x, f32 y, f32 rx, f32 ry,
+                                 f32 degrees);
+OWL_API bool owl_meshFillSector(owl_Mesh *mesh, f32 x, f32 y,
+                                f32 inner_radius, f32 outer_radius,
+                                f32 start_angle, f32 end_angle);
+OWL_API bool owl_meshFillTrigon(owl_Mesh *mesh, f32 x1, f32 y1, f32 x2,
+                                f32 y2, f32 x3, f32 y3);
+OWL_API bool owl_meshFillRectRound(owl_Mesh *mesh, f32 x, f32 y, f32 w,
+                                   f32 h, f32 radius);
+OWL_API bool owl_meshFillPolygon(owl_Mesh *mesh, const owl_Point *points,
+                                 s32 num_points);
+OWL_API void owl_drawMesh(owl_Mesh *mesh, const owl_Matrix *transform,
+                          owl_Pixel tint);
+
+OWL_API owl_Atlas *owl_atlas(s32 width, s32 height, s32 padding);
+OWL_API void owl_freeAtlas(owl_Atlas *atlas);
+OWL_API owl_Canvas *owl_atlasImage(owl_Atlas *atlas, const u8 *data, s32 w,
+                                   s32 h, u8 format);
+OWL_API owl_Canvas *owl_atlasImagex(owl_Atlas *atlas, const u8 *data, s32 w,
+                                    s32 h, owl_Pixel colorkey);
+OWL_API owl_Canvas *owl_atlasLoad(owl_Atlas *atlas, const char *filename);
+OWL_API owl_Canvas *owl_atlasLoadex(owl_Atlas *atlas, const char *filename,
+                                    owl_Pixel colorkey);
+OWL_API s32 owl_atlasBuild(owl_Atlas *atlas, const char *manifest);
+OWL_API void owl_loadAtlas(owl_Atlas *atlas);
+OWL_API owl_Canvas *owl_atlasGet(owl_Atlas *atlas, const char *name);
+OWL_API s32 owl_atlasPages(owl_Atlas *atlas);
+
 OWL_API bool owl_loadFont(const char *name, const char *filename);
+/* While recording, text is drawn on replay with a font selected in it */
 OWL_API bool owl_font(const char *name, s32 size);
 
 OWL_API owl_Canvas *owl_text(const char *text, owl_Pixel color);
+OWL_API owl_Canvas *owl_textTint(owl_Canvas *text, owl_Pixel color);
 OWL_API f32 owl_textWidth(const char *text);
+OWL_API f32 owl_drawText(f32 x, f32 y, const char *text, owl_Pixel color);
 
 OWL_API owl_Audio owl_audio(s32 freq, u8 format, u8 channels, u16 samples);
 OWL_API void owl_closeAudio(owl_Audio audio);
@@ -452,11 +583,40 @@ OWL_API bool owl_audioStream(owl_Audio audio, const void *buffer, s32 len);
 OWL_API u32 owl_audioBuffered(owl_Audio audio);
 
 OWL_API bool owl_loadSound(const char *name, const char *filename);
+OWL_API bool owl_loadMusic(const char *name, const char *filename);
 OWL_API bool owl_playing(const char *name);
-OWL_API bool owl_play(const char *name);
+OWL_API owl_Voice owl_play(const char *name);
 OWL_API bool owl_stop(const char *name);
 OWL_API bool owl_pause(const char *name);
 OWL_API bool owl_resume(const char *name);
+OWL_API bool owl_soundLimit(const char *name, s32 limit);
+
+OWL_API owl_Async *owl_loadAsync(u8 type, const char *name,
+                                 const char *filename, owl_AsyncDone done,
+                                 void *ud);
+OWL_API s32 owl_asyncStatus(owl_Async *async);
+OWL_API owl_Canvas *owl_asyncCanvas(owl_Async *async);
+OWL_API void owl_freeAsync(owl_Async *async);
+OWL_API s32 owl_asyncPending(void);
+OWL_API void owl_uploadBudget(u32 bytes);
+
+/*
+ * False when the parent has finished already, func never runs then. The
+ * handle is NULL when the job ran inline or when handle is NULL itself.
+ */
+OWL_API bool owl_job(owl_JobFunc func, void *ud, owl_Job *parent,
+                     owl_Job **handle);
+OWL_API void owl_waitJob(owl_Job *job);
+OWL_API void owl_releaseJob(owl_Job *job);
+OWL_API void owl_parallelFor(s32 count, s32 grain, owl_ForFunc func,
+                             void *ud);
+OWL_API void owl_jobWorkers(s32 count);
+OWL_API s32 owl_jobThreads(void);
+
+OWL_API void owl_voiceLimit(s32 limit);
+OWL_API void owl_stopVoice(owl_Voice voice);
+OWL_API void owl_voiceGain(owl_Voice voice, f32 gain);
+OWL_API bool owl_voicePlaying(owl_Voice voice);
 
 #ifdef __cplusplus
 };
@@ -40,11 +40,31 @@ workspace ( "owl" )
     os.remove("owl.vcxproj")
     os.remove("owl.vcxproj.filters")
     os.remove("owl.vcxproj.user")
+    os.remove("owlbench.vcxproj")
+    os.remove("owlbench.vcxproj.filters")
+    os.remove("owlbench.vcxproj.user")
+    os.remove("owltest.vcxproj")
+    os.remove("owltest.vcxproj.filters")
+    os.remove("owltest.vcxproj.user")
+    os.remove("owlpack.vcxproj")
+    os.remove("owlpack.vcxproj.filters")
+    os.remove("owlpack.vcxproj.user")
+    os.remove("owltex.vcxproj")
+    os.remove("owltex.vcxproj.filters")
+    os.remove("owltex.vcxproj.user")
+    os.remove("owlatlas.vcxproj")
+    os.remove("owlatlas.vcxproj.filters")
+    os.remove("owlatlas.vcxproj.user")
     os.remove("SDL2.make")
     os.remove("SDL2main.make")
     os.remove("SDL_gpu.make")
     os.remove("owlcore.make")
     os.remove("owl.make")
+    os.remove("owlbench.make")
+    os.remove("owltest.make")
+    os.remove("owlpack.make")
+    os.remove("owltex.make")
+    os.remove("owlatlas.make")
     os.remove("Makefile")
     return
   end
@@ -341,3 +361,162 @@ workspace ( "owl" )
     filter { "action:gmake", "system:macosx" }
       defines { "__APPLE__", "__MACH__", "__MRC__", "macintosh" }
       links { "Foundation.framework", "IOKit.framework" }
+
+
+  -- A project defines one build target
+  project ( "owlbench" )
+    kind ( "ConsoleApp" )
+    language ( "C" )
+    files { "./bench/**.h", "./bench/**.c" }
+    includedirs { "./include", "./core", "./3rd/sdl2/include" }
+    libdirs { "./bin" }
+    objdir ( "./objs" )
+    targetdir ( "./bin" )
+    links { "SDL2main", "OwlCore" }
+    defines { "_UNICODE" }
+    staticruntime "On"
+
+    filter ( "configurations:Release" )
+      optimize "On"
+      defines { "NDEBUG", "_NDEBUG" }
+
+    filter ( "configurations:Debug" )
+      symbols "On"
+      defines { "DEBUG", "_DEBUG" }
+
+    filter ( "action:vs*" )
+      defines { "WIN32", "_WIN32", "_WINDOWS", "_CRT_SECURE_NO_WARNINGS",
+                "_CRT_SECURE_NO_DEPRECATE", "_CRT_NONSTDC_NO_DEPRECATE" }
+      links { "SDL2" }
+      -- The DLL only exports OWL_API, so bench_table builds its own table
+      files { "./core/owl_table.h", "./core/owl_table.c" }
+
+    filter ( "action:gmake" )
+      warnings  "Default" --"Extra"
+      links { "m" }
+      linkoptions { "-rpath @executable_path", "-rpath @loader_path" }
+
+    filter { "action:gmake", "system:macosx" }
+      defines { "__APPLE__", "__MACH__", "__MRC__", "macintosh" }
+
+
+  -- A project defines one build target
+  project ( "owltest" )
+    kind ( "ConsoleApp" )
+    language ( "C" )
+    files { "./test/**.h", "./test/**.c" }
+    includedirs { "./include", "./3rd/sdl2/include", "./3rd/sdl-gpu/include" }
+    libdirs { "./bin" }
+    objdir ( "./objs" )
+    targetdir ( "./bin" )
+    links { "SDL2main", "SDL2", "SDL_gpu", "OwlCore" }
+    defines { "_UNICODE" }
+    staticruntime "On"
+
+    filter ( "configurations:Release" )
+      optimize "On"
+      defines { "NDEBUG", "_NDEBUG" }
+
+    filter ( "configurations:Debug" )
+      symbols "On"
+      defines { "DEBUG", "_DEBUG" }
+
+    filter ( "action:vs*" )
+      defines { "WIN32", "_WIN32", "_WINDOWS", "_CRT_SECURE_NO_WARNINGS",
+                "_CRT_SECURE_NO_DEPRECATE", "_CRT_NONSTDC_NO_DEPRECATE" }
+
+    filter ( "action:gmake" )
+      warnings  "Default" --"Extra"
+      links { "m" }
+      linkoptions { "-rpath @executable_path", "-rpath @loader_path" }
+
+    filter { "action:gmake", "system:macosx" }
+      defines { "__APPLE__", "__MACH__", "__MRC__", "macintosh" }
+
+
+  -- A project defines one build target
+  project ( "owlpack" )
+    kind ( "ConsoleApp" )
+    language ( "C" )
+    files { "./tools/owlpack/*.h", "./tools/owlpack/*.c",
+            "./core/owl_pak.h", "./core/owl_lz.h", "./core/owl_lz.c" }
+    includedirs { "./include", "./core" }
+    objdir ( "./objs" )
+    targetdir ( "./bin" )
+    defines { "_UNICODE", "OWL_STATIC" }
+    staticruntime "On"
+
+    filter ( "configurations:Release" )
+      optimize "On"
+      defines { "NDEBUG", "_NDEBUG" }
+
+    filter ( "configurations:Debug" )
+      symbols "On"
+      defines { "DEBUG", "_DEBUG" }
+
+    filter ( "action:vs*" )
+      defines { "WIN32", "_WIN32", "_WINDOWS", "_CRT_SECURE_NO_WARNINGS",
+                "_CRT_SECURE_NO_DEPRECATE", "_CRT_NONSTDC_NO_DEPRECATE" }
+
+    filter ( "action:gmake" )
+      warnings  "Default" --"Extra"
+
+
+  -- A project defines one build target
+  project ( "owltex" )
+    kind ( "ConsoleApp" )
+    language ( "C" )
+    files { "./tools/owltex/*.h", "./tools/owltex/*.c",
+            "./core/owl_tex.h", "./core/owl_lz.h", "./core/owl_lz.c" }
+    includedirs { "./include", "./core", "./3rd" }
+    objdir ( "./objs" )
+    targetdir ( "./bin" )
+    defines { "_UNICODE", "OWL_STATIC" }
+    staticruntime "On"
+
+    filter ( "configurations:Release" )
+      optimize "On"
+      defines { "NDEBUG", "_NDEBUG" }
+
+    filter ( "configurations:Debug" )
+      symbols "On"
+      defines { "DEBUG", "_DEBUG" }
+
+    filter ( "action:vs*" )
+      defines { "WIN32", "_WIN32", "_WINDOWS", "_CRT_SECURE_NO_WARNINGS",
+                "_CRT_SECURE_NO_DEPRECATE", "_CRT_NONSTDC_NO_DEPRECATE" }
+
+    filter ( "action:gmake" )
+      warnings  "Default" --"Extra"
+      links { "m" }
+
+
+  -- A project defines one build target
+  project ( "owlatlas" )
+    kind ( "ConsoleApp" )
+    language ( "C" )
+    files { "./tools/owlatlas/*.h", "./tools/owlatlas/*.c",
+            "./core/owl_atlas.h", "./core/owl_skyline.h",
+            "./core/owl_skyline.c", "./core/owl_tex.h", "./core/owl_lz.h",
+            "./core/owl_lz.c" }
+    includedirs { "./include", "./core", "./3rd" }
+    objdir ( "./objs" )
+    targetdir ( "./bin" )
+    defines { "_UNICODE", "OWL_STATIC" }
+    staticruntime "On"
+
+    filter ( "configurations:Release" )
+      optimize "On"
+      defines { "NDEBUG", "_NDEBUG" }
+
+    filter ( "configurations:Debug" )
+      symbols "On"
+      defines { "DEBUG", "_DEBUG" }
+
+    filter ( "action:vs*" )
+      defines { "WIN32", "_WIN32", "_WINDOWS", "_CRT_SECURE_NO_WARNINGS",
+                "_CRT_SECURE_NO_DEPRECATE", "_CRT_NONSTDC_NO_DEPRECATE" }
+
+    filter ( "action:gmake" )
+      warnings  "Default" --"Extra"
+      links { "m" }
@@ -28,8 +28,9 @@ typedef struct Args {
 
 static int owl_main(int argc, char *argv[]) {
   bool quit = false;
-  char title[128];
+  char title[128], status[64];
   owl_Event event;
+  owl_FrameStats stats;
   owl_Canvas *screen, *hero, *morph, *text1, *text2, *text3;
   owl_Point points[] = {{13, 13}, {13, 15}, {15, 13}, {15, 15}};
   owl_Point lines[] = {{320, 200}, {300, 240}, {340, 240}};
@@ -71,11 +72,16 @@ static int owl_main(int argc, char *argv[]) {
 
   morph = owl_canvas(200, 200);
 
+  owl_mount("test-res.zip");
+
   owl_loadFont("Unifont", "./unifont.ttf");
 
   owl_loadSound("coin1", "./coin1.wav");
   owl_loadSound("coin2", "./coin2.wav");
 
+  owl_soundLimit("coin1", 4);
+  owl_soundLimit("coin2", 4);
+
   hero = owl_loadex("hero.bmp", owl_rgb(0xff, 0, 0xff));
 
   hero_pos.x = 20;
@@ -94,12 +100,12 @@ static int owl_main(int argc, char *argv[]) {
     text1_pos.w = (f32)w;
     text1_pos.h = (f32)h;
 
-    text2 = owl_text(text, owl_rgb(0, 0xff, 0xff));
+    text2 = owl_textTint(text1, owl_rgb(0, 0xff, 0xff));
     owl_size(text2, &w, &h);
     text2_pos.w = (f32)w;
     text2_pos.h = (f32)h;
 
-    text3 = owl_text(text, owl_rgb(0xff, 0xff, 0));
+    text3 = owl_textTint(text1, owl_rgb(0xff, 0xff, 0));
     owl_size(text3, &w, &h);
     text3_pos.w = (f32)w;
     text3_pos.h = (f32)h;
@@ -250,6 +256,11 @@ static int owl_main(int argc, char *argv[]) {
     owl_fillEllipse(450, 450, 90, 40, 0.0f);
     owl_blendMode(screen, OWL_BLEND_ALPHA);
 
+    owl_frameStats(&stats);
+    sprintf(status, "Frame: %.2f ms, jitter %.2f ms", stats.last,
+            stats.jitter);
+    owl_drawText(10, (f32)(SCREEN_H - 26), status, owl_rgb(0xff, 0xff, 0xff));
+
     owl_present();
     owl_wait();
   }
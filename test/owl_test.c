@@ -0,0 +1,46 @@
+/*
+ * owl_test.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "SDL_main.h"
+#include "owl_test.h"
+
+static const owl_Test tests[] = {
+    {"command", test_command},
+};
+
+#define OWL_NUM_TESTS (s32)(sizeof(tests) / sizeof(*tests))
+
+/* Runs every test, or only the ones named on the command line */
+int main(int argc, char *argv[]) {
+  s32 i, j, failed = 0;
+  bool run;
+
+  for (i = 0; i < OWL_NUM_TESTS; ++i) {
+    run = argc < 2;
+
+    for (j = 1; j < argc && !run; ++j)
+      run = 0 == strcmp(argv[j], tests[i].name);
+
+    if (!run)
+      continue;
+
+    if (tests[i].run()) {
+      printf("%-10s ok\n", tests[i].name);
+    } else {
+      printf("%-10s FAILED\n", tests[i].name);
+      failed += 1;
+    }
+  }
+  return failed;
+}
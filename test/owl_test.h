@@ -0,0 +1,34 @@
+/*
+ * owl_test.h
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#ifndef __OWL_TEST_H__
+#define __OWL_TEST_H__
+
+#include "owl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef bool (*owl_TestFunc)(void);
+
+typedef struct owl_Test {
+  const char *name;
+  owl_TestFunc run;
+} owl_Test;
+
+extern bool test_command(void);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __OWL_TEST_H__ */
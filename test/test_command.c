@@ -0,0 +1,97 @@
+/*
+ * test_command.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "SDL_gpu.h"
+#include "owl_test.h"
+
+#define SCREEN_W 64
+#define SCREEN_H 64
+
+static owl_Pixel test_readPixel(owl_Canvas *canvas, s32 x, s32 y) {
+  SDL_Surface *surface = GPU_CopySurfaceFromImage(canvas);
+  owl_Pixel pixel = owl_rgba(0, 0, 0, 0);
+  u32 value = 0;
+  u8 *p;
+
+  if (!surface)
+    return pixel;
+
+  p = (u8 *)surface->pixels + y * surface->pitch +
+      x * surface->format->BytesPerPixel;
+  memcpy(&value, p, surface->format->BytesPerPixel);
+
+  SDL_GetRGBA(value, surface->format, &pixel.r, &pixel.g, &pixel.b,
+              &pixel.a);
+  SDL_FreeSurface(surface);
+
+  return pixel;
+}
+
+/*
+ * A background on the screen, draws into a canvas, then a blit of that
+ * canvas to the screen. The sorted replay must not move the blit ahead of
+ * the draws it samples.
+ */
+static bool test_sampleTarget(void) {
+  owl_CommandList *list = owl_commandList();
+  owl_Canvas *canvas = owl_canvas(16, 16);
+  owl_Rect screen = {0, 0, SCREEN_W, SCREEN_H};
+  owl_Pixel pixel;
+  bool ok = false;
+
+  if (!list || !canvas)
+    goto cleanup;
+
+  owl_record(list);
+
+  owl_color(owl_rgb(0xFF, 0, 0));
+  owl_fillRect(0, 0, SCREEN_W, SCREEN_H);
+
+  owl_target(canvas);
+  owl_color(owl_rgb(0, 0xFF, 0));
+  owl_fillRect(0, 0, 16, 16);
+
+  owl_target(NULL);
+  owl_color(owl_rgb(0xFF, 0xFF, 0xFF));
+  owl_blit(canvas, NULL, &screen, 0, NULL, OWL_FLIP_NONE);
+
+  owl_record(NULL);
+  owl_replay(list, true);
+
+  pixel = test_readPixel(owl_screen(), SCREEN_W / 2, SCREEN_H / 2);
+  ok = pixel.r == 0 && pixel.g == 0xFF && pixel.b == 0;
+
+  if (!ok)
+    printf("  sampled target: got %02x%02x%02x, want 00ff00\n", pixel.r,
+           pixel.g, pixel.b);
+
+cleanup:
+  owl_freeCommandList(list);
+
+  if (canvas)
+    owl_freeCanvas(canvas);
+  return ok;
+}
+
+bool test_command(void) {
+  bool ok;
+
+  if (!owl_init(SCREEN_W, SCREEN_H, "owltest: command", 0))
+    return false;
+
+  ok = test_sampleTarget();
+
+  owl_quit();
+  return ok;
+}
@@ -0,0 +1,344 @@
+/*
+ * owlatlas.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "owl_atlas.h"
+#include "owl_lz.h"
+#include "owl_tex.h"
+
+#define NAME_SIZE 64
+#define PATH_SIZE 260
+#define LINE_SIZE 1024
+
+typedef struct Entry {
+  char name[NAME_SIZE];
+  u8 *pixels;
+  s32 w, h;
+  s32 page, x, y;
+} Entry;
+
+typedef struct Page {
+  owl_Skyline sky;
+  u8 *pixels;
+} Page;
+
+static s32 width = OWL_ATLAS_WIDTH;
+static s32 height = OWL_ATLAS_HEIGHT;
+static s32 padding = 1;
+static bool compress = false;
+
+static void usage(const char *self) {
+  printf("usage: %s [-w W] [-h H] [-p N] [-z] <manifest> <output>\n\n",
+         self);
+  printf("  -w W  page width, %d by default\n", OWL_ATLAS_WIDTH);
+  printf("  -h H  page height, %d by default\n", OWL_ATLAS_HEIGHT);
+  printf("  -p N  extruded border around each image, 1 by default\n");
+  printf("  -z    compress pages when it saves at least 1/8\n\n");
+  printf("Writes <output>.atlas and the pages <output>N.owltex, which\n");
+  printf("owl_atlasBuild loads without packing anything at runtime.\n");
+}
+
+static void colorKey(u8 *pixels, u32 count, u32 key) {
+  u8 r = (u8)(key >> 16), g = (u8)(key >> 8), b = (u8)key;
+  u32 i;
+
+  for (i = 0; i < count; ++i, pixels += 4)
+    if (pixels[0] == r && pixels[1] == g && pixels[2] == b)
+      memset(pixels, 0, 4);
+}
+
+/* Same order as owl_atlasBuild, tallest first packs the densest pages */
+static int compare(const void *a, const void *b) {
+  const Entry *l = (const Entry *)a;
+  const Entry *r = (const Entry *)b;
+
+  if (l->h != r->h)
+    return r->h - l->h;
+
+  return r->w - l->w;
+}
+
+static const char *baseName(const char *path) {
+  const char *slash = strrchr(path, '/');
+  const char *back = strrchr(path, '\\');
+
+  if (back > slash)
+    slash = back;
+
+  return slash ? slash + 1 : path;
+}
+
+static s32 parse(const char *manifest, Entry **entries) {
+  char line[LINE_SIZE], file[PATH_SIZE], path[PATH_SIZE * 2];
+  s32 n, w, h, c, dir, count = 0, capacity = 0;
+  Entry *grown, *e;
+  u32 key;
+  FILE *fp;
+
+  fp = fopen(manifest, "r");
+
+  if (!fp)
+    return -1;
+
+  dir = (s32)(baseName(manifest) - manifest);
+
+  while (fgets(line, sizeof(line), fp)) {
+    if (count == capacity) {
+      capacity = capacity ? capacity * 2 : 64;
+      grown = (Entry *)realloc(*entries, capacity * sizeof(Entry));
+
+      if (!grown)
+        break;
+
+      *entries = grown;
+    }
+
+    e = &(*entries)[count];
+    n = sscanf(line, "%63s %259s %x", e->name, file, &key);
+
+    if (n < 2 || e->name[0] == '#')
+      continue;
+
+    if (file[0] == '/' || file[0] == '\\' || (file[0] && file[1] == ':'))
+      snprintf(path, sizeof(path), "%s", file);
+    else
+      snprintf(path, sizeof(path), "%.*s%s", dir, manifest, file);
+
+    e->pixels = stbi_load(path, &w, &h, &c, STBI_rgb_alpha);
+
+    if (!e->pixels) {
+      fprintf(stderr, "owlatlas: cannot decode %s\n", path);
+      continue;
+    }
+
+    /* Only RGB sources are keyed at runtime, so match that here */
+    if (n == 3 && c == STBI_rgb)
+      colorKey(e->pixels, (u32)(w * h), key);
+
+    e->w = w;
+    e->h = h;
+    count += 1;
+  }
+
+  fclose(fp);
+  return count;
+}
+
+static void extrude(Page *page, const Entry *e) {
+  s32 pw = e->w + padding * 2, ph = e->h + padding * 2;
+  s32 x, y, sx, sy;
+  u8 *row;
+
+  for (y = 0; y < ph; ++y) {
+    sy = y - padding;
+    sy = sy < 0 ? 0 : (sy >= e->h ? e->h - 1 : sy);
+    row = page->pixels + ((e->y - padding + y) * width + e->x - padding) * 4;
+
+    for (x = 0; x < pw; ++x) {
+      sx = x - padding;
+      sx = sx < 0 ? 0 : (sx >= e->w ? e->w - 1 : sx);
+      memcpy(row + x * 4, e->pixels + (sy * e->w + sx) * 4, 4);
+    }
+  }
+}
+
+static s32 pack(Entry *entries, s32 count, Page **pages) {
+  s32 i, k, x, y, num_pages = 0;
+  Page *grown;
+
+  for (i = 0; i < count; ++i) {
+    entries[i].page = -1;
+
+    if (entries[i].w + padding * 2 > width ||
+        entries[i].h + padding * 2 > height) {
+      fprintf(stderr, "owlatlas: %s does not fit a page\n", entries[i].name);
+      continue;
+    }
+
+    for (k = 0; k < num_pages; ++k)
+      if (owl_skylinePack(&(*pages)[k].sky, entries[i].w + padding * 2,
+                          entries[i].h + padding * 2, &x, &y))
+        break;
+
+    if (k == num_pages) {
+      grown = (Page *)realloc(*pages, (num_pages + 1) * sizeof(Page));
+
+      if (!grown)
+        return -1;
+
+      *pages = grown;
+      grown[k].pixels = (u8 *)calloc(width * height, 4);
+
+      if (!grown[k].pixels || !owl_skyline(&grown[k].sky, width, height))
+        return -1;
+
+      num_pages += 1;
+
+      if (!owl_skylinePack(&grown[k].sky, entries[i].w + padding * 2,
+                           entries[i].h + padding * 2, &x, &y))
+        continue;
+    }
+
+    entries[i].page = k;
+    entries[i].x = x + padding;
+    entries[i].y = y + padding;
+
+    extrude(&(*pages)[k], &entries[i]);
+  }
+  return num_pages;
+}
+
+static bool writePage(const char *filename, const u8 *pixels) {
+  owl_TexHeader header;
+  const u8 *payload = pixels;
+  u8 *packed = NULL;
+  s32 bound, size;
+  FILE *fp;
+
+  memset(&header, 0, sizeof(header));
+  header.magic = OWL_TEX_MAGIC;
+  header.version = OWL_TEX_VERSION;
+  header.width = (u32)width;
+  header.height = (u32)height;
+  header.size = (u32)(width * height * 4);
+  header.packed = header.size;
+  header.offset = sizeof(owl_TexHeader);
+  header.codec = OWL_TEX_RAW;
+
+  if (compress) {
+    bound = owl_lzBound((s32)header.size);
+    packed = (u8 *)malloc(bound);
+    size = packed ? owl_lzCompress(pixels, (s32)header.size, packed, bound)
+                  : 0;
+
+    if (size > 0 && (u32)size <= header.size - header.size / 8) {
+      header.packed = (u32)size;
+      header.codec = OWL_TEX_LZ;
+      payload = packed;
+    }
+  }
+
+  fp = fopen(filename, "wb");
+
+  if (!fp) {
+    free(packed);
+    return false;
+  }
+
+  fwrite(&header, sizeof(header), 1, fp);
+  fwrite(payload, 1, header.packed, fp);
+  fclose(fp);
+
+  free(packed);
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  char filename[PATH_SIZE + 16];
+  const char *output;
+  Entry *entries = NULL;
+  Page *pages = NULL;
+  s32 i, count, num_pages, placed = 0, ret = -1;
+  FILE *fp = NULL;
+
+  for (i = 1; i < argc && argv[i][0] == '-'; ++i) {
+    if (0 == strcmp(argv[i], "-w") && i + 1 < argc)
+      width = atoi(argv[++i]);
+    else if (0 == strcmp(argv[i], "-h") && i + 1 < argc)
+      height = atoi(argv[++i]);
+    else if (0 == strcmp(argv[i], "-p") && i + 1 < argc)
+      padding = atoi(argv[++i]);
+    else if (0 == strcmp(argv[i], "-z"))
+      compress = true;
+    else {
+      usage(argv[0]);
+      return -1;
+    }
+  }
+
+  if (argc - i != 2 || width <= 0 || height <= 0 || padding < 0 ||
+      width > 16384 || height > 16384) {
+    usage(argv[0]);
+    return -1;
+  }
+
+  output = argv[i + 1];
+  count = parse(argv[i], &entries);
+
+  if (count < 0) {
+    fprintf(stderr, "owlatlas: cannot read %s\n", argv[i]);
+    return -1;
+  }
+
+  qsort(entries, count, sizeof(Entry), compare);
+  num_pages = pack(entries, count, &pages);
+
+  if (num_pages < 0) {
+    fprintf(stderr, "owlatlas: out of memory\n");
+    goto cleanup;
+  }
+
+  snprintf(filename, sizeof(filename), "%s.atlas", output);
+  fp = fopen(filename, "w");
+
+  if (!fp) {
+    fprintf(stderr, "owlatlas: cannot create %s\n", filename);
+    goto cleanup;
+  }
+
+  /* Pages sit next to the manifest, so it names them without a path */
+  fprintf(fp, "%s %dx%d padding %d\n", OWL_ATLAS_PACKED, width, height,
+          padding);
+
+  for (i = 0; i < num_pages; ++i) {
+    snprintf(filename, sizeof(filename), "%s%d.owltex", output, i);
+
+    if (!writePage(filename, pages[i].pixels)) {
+      fprintf(stderr, "owlatlas: cannot create %s\n", filename);
+      goto cleanup;
+    }
+
+    fprintf(fp, "page %s\n", baseName(filename));
+  }
+
+  for (i = 0; i < count; ++i)
+    if (entries[i].page >= 0) {
+      fprintf(fp, "%s %d %d %d %d %d\n", entries[i].name, entries[i].page,
+              entries[i].x, entries[i].y, entries[i].w, entries[i].h);
+      placed += 1;
+    }
+
+  printf("%s.atlas: %d of %d images on %d pages\n", output, placed, count,
+         num_pages);
+  ret = 0;
+
+cleanup:
+  if (fp)
+    fclose(fp);
+
+  for (i = 0; i < count; ++i)
+    stbi_image_free(entries[i].pixels);
+
+  for (i = 0; i < num_pages; ++i) {
+    free(pages[i].pixels);
+    owl_freeSkyline(&pages[i].sky);
+  }
+
+  free(entries);
+  free(pages);
+  return ret;
+}
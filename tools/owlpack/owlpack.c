@@ -0,0 +1,374 @@
+/*
+ * owlpack.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "owl_lz.h"
+#include "owl_pak.h"
+
+#define OWL_PACK_SEEDS (1 << 24)
+
+typedef struct owl_PackItem {
+  char *name;
+  u32 length;
+  u32 hash;
+  u8 *data;
+  u32 size;
+  u32 packed;
+  u16 codec;
+  u64 offset;
+} owl_PackItem;
+
+static const u8 zeros[OWL_PAK_ALIGN];
+
+static u64 align(u64 offset) {
+  return (offset + OWL_PAK_ALIGN - 1) & ~(u64)(OWL_PAK_ALIGN - 1);
+}
+
+static char *packName(const char *path) {
+  char *name, *p;
+
+  while (path[0] == '.' && (path[1] == '/' || path[1] == '\\'))
+    path += 2;
+
+  name = strdup(path);
+
+  if (name)
+    for (p = name; *p; ++p)
+      if (*p == '\\')
+        *p = '/';
+
+  return name;
+}
+
+static u8 *readAll(const char *path, u32 *size) {
+  FILE *fp = fopen(path, "rb");
+  long length;
+  u8 *data;
+
+  if (!fp)
+    return NULL;
+
+  fseek(fp, 0, SEEK_END);
+  length = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+
+  data = length >= 0 ? (u8 *)malloc(length ? length : 1) : NULL;
+
+  if (data && length > 0 && 1 != fread(data, length, 1, fp)) {
+    free(data);
+    data = NULL;
+  }
+
+  fclose(fp);
+  *size = (u32)length;
+  return data;
+}
+
+static bool compressItem(owl_PackItem *item) {
+  s32 bound = owl_lzBound((s32)item->size), packed;
+  u8 *buffer = (u8 *)malloc(bound);
+
+  if (!buffer)
+    return false;
+
+  packed = owl_lzCompress(item->data, (s32)item->size, buffer, bound);
+
+  /* Only keep the codec when it saves at least an eighth */
+  if (packed <= 0 || (u32)packed > item->size - item->size / 8) {
+    free(buffer);
+    return true;
+  }
+
+  free(item->data);
+  item->data = buffer;
+  item->packed = (u32)packed;
+  item->codec = OWL_PAK_LZ;
+  return true;
+}
+
+static int compareItem(const void *a, const void *b) {
+  return strcmp(((const owl_PackItem *)a)->name,
+                ((const owl_PackItem *)b)->name);
+}
+
+static u32 *bucketOrder;
+static u32 *bucketSize;
+
+static int compareBucket(const void *a, const void *b) {
+  u32 l = bucketSize[*(const u32 *)a], r = bucketSize[*(const u32 *)b];
+  return l < r ? 1 : (l > r ? -1 : 0);
+}
+
+static bool perfectHash(owl_PackItem *items, u32 count, u32 buckets,
+                        u32 *slots, u32 *displace) {
+  u32 *start, *members, *fill, *tried;
+  u8 *used;
+  u32 i, j, b, d, n, slot, next = 0;
+  bool ok = false;
+
+  start = (u32 *)calloc(buckets + 1, sizeof(u32));
+  members = (u32 *)malloc(count * sizeof(u32));
+  fill = (u32 *)calloc(buckets, sizeof(u32));
+  tried = (u32 *)malloc(count * sizeof(u32));
+  used = (u8 *)calloc(count, 1);
+  bucketOrder = (u32 *)malloc(buckets * sizeof(u32));
+  bucketSize = fill;
+
+  if (!start || !members || !fill || !tried || !used || !bucketOrder)
+    goto done;
+
+  /* Counting sort of the keys by first-level bucket */
+  for (i = 0; i < count; ++i)
+    start[items[i].hash % buckets + 1] += 1;
+
+  for (b = 0; b < buckets; ++b)
+    start[b + 1] += start[b];
+
+  for (i = 0; i < count; ++i) {
+    b = items[i].hash % buckets;
+    members[start[b] + fill[b]++] = i;
+  }
+
+  for (b = 0; b < buckets; ++b)
+    bucketOrder[b] = b;
+
+  /* Place the crowded buckets first while the slot table is still sparse */
+  qsort(bucketOrder, buckets, sizeof(u32), compareBucket);
+
+  for (i = 0; i < buckets; ++i) {
+    b = bucketOrder[i];
+    n = fill[b];
+    displace[b] = 0;
+
+    if (n == 0)
+      continue;
+
+    if (n == 1) {
+      while (used[next])
+        next += 1;
+
+      used[next] = 1;
+      slots[next] = members[start[b]];
+      displace[b] = OWL_PAK_DIRECT | next;
+      continue;
+    }
+
+    for (d = 1; d < OWL_PACK_SEEDS; ++d) {
+      for (j = 0; j < n; ++j) {
+        owl_PackItem *item = &items[members[start[b] + j]];
+        slot = owl_pakHash(item->name, item->length, d) % count;
+
+        if (used[slot])
+          break;
+
+        used[slot] = 1;
+        tried[j] = slot;
+      }
+
+      if (j == n)
+        break;
+
+      while (j-- > 0)
+        used[tried[j]] = 0;
+    }
+
+    if (d == OWL_PACK_SEEDS)
+      goto done;
+
+    for (j = 0; j < n; ++j)
+      slots[tried[j]] = members[start[b] + j];
+
+    displace[b] = d;
+  }
+
+  ok = true;
+
+done:
+  free(start);
+  free(members);
+  free(fill);
+  free(tried);
+  free(used);
+  free(bucketOrder);
+  return ok;
+}
+
+static bool writePack(const char *output, owl_PackItem *items, u32 count) {
+  owl_PakHeader header;
+  owl_PakEntry *entries;
+  u32 *slots, *displace, i, names = 0;
+  u64 offset;
+  bool ok = false;
+  FILE *fp;
+
+  header.magic = OWL_PAK_MAGIC;
+  header.version = OWL_PAK_VERSION;
+  header.count = count;
+  header.buckets = (count + OWL_PAK_BUCKET - 1) / OWL_PAK_BUCKET;
+  header.entries = sizeof(owl_PakHeader);
+  header.slots = header.entries + count * sizeof(owl_PakEntry);
+  header.displace = header.slots + count * sizeof(u32);
+  header.names = header.displace + header.buckets * sizeof(u32);
+
+  entries = (owl_PakEntry *)calloc(count, sizeof(owl_PakEntry));
+  slots = (u32 *)calloc(count, sizeof(u32));
+  displace = (u32 *)calloc(header.buckets, sizeof(u32));
+  fp = NULL;
+
+  if (!entries || !slots || !displace)
+    goto done;
+
+  if (!perfectHash(items, count, header.buckets, slots, displace)) {
+    fprintf(stderr, "owlpack: failed to build the name hash\n");
+    goto done;
+  }
+
+  for (i = 0; i < count; ++i)
+    names += items[i].length;
+
+  offset = align((u64)header.names + names);
+  names = 0;
+
+  for (i = 0; i < count; ++i) {
+    items[i].offset = offset;
+
+    entries[i].offset = offset;
+    entries[i].size = items[i].size;
+    entries[i].packed = items[i].packed;
+    entries[i].name = names;
+    entries[i].length = (u16)items[i].length;
+    entries[i].codec = items[i].codec;
+    entries[i].hash = items[i].hash;
+
+    names += items[i].length;
+    offset = align(offset + items[i].packed);
+  }
+
+  fp = fopen(output, "wb");
+
+  if (!fp) {
+    fprintf(stderr, "owlpack: cannot create %s\n", output);
+    goto done;
+  }
+
+  fwrite(&header, sizeof(header), 1, fp);
+  fwrite(entries, sizeof(owl_PakEntry), count, fp);
+  fwrite(slots, sizeof(u32), count, fp);
+  fwrite(displace, sizeof(u32), header.buckets, fp);
+
+  for (i = 0; i < count; ++i)
+    fwrite(items[i].name, 1, items[i].length, fp);
+
+  for (i = 0; i < count; ++i) {
+    offset = (u64)ftell(fp);
+    fwrite(zeros, 1, (size_t)(items[i].offset - offset), fp);
+    fwrite(items[i].data, 1, items[i].packed, fp);
+  }
+
+  offset = (u64)ftell(fp);
+  fwrite(zeros, 1, (size_t)(align(offset) - offset), fp);
+
+  ok = !ferror(fp);
+  fclose(fp);
+
+done:
+  free(entries);
+  free(slots);
+  free(displace);
+  return ok;
+}
+
+static void usage(const char *self) {
+  printf("usage: %s [-z] <output.owlpak> <file>...\n\n", self);
+  printf("  -z    compress entries that shrink by at least 1/8\n");
+}
+
+int main(int argc, char *argv[]) {
+  owl_PackItem *items;
+  const char *output;
+  bool compress = false;
+  s32 i, first = 1;
+  u32 count, raw = 0, stored = 0;
+  int retval = -1;
+
+  if (argc > 1 && 0 == strcmp(argv[1], "-z")) {
+    compress = true;
+    first += 1;
+  }
+
+  if (argc - first < 2) {
+    usage(argv[0]);
+    return -1;
+  }
+
+  output = argv[first++];
+  count = (u32)(argc - first);
+  items = (owl_PackItem *)calloc(count, sizeof(owl_PackItem));
+
+  if (!items)
+    return -1;
+
+  for (i = 0; i < (s32)count; ++i) {
+    owl_PackItem *item = &items[i];
+
+    item->name = packName(argv[first + i]);
+    item->data = readAll(argv[first + i], &item->size);
+
+    if (!item->name || !item->data) {
+      fprintf(stderr, "owlpack: cannot read %s\n", argv[first + i]);
+      goto done;
+    }
+
+    item->length = (u32)strlen(item->name);
+    item->hash = owl_pakHash(item->name, item->length, 0);
+    item->packed = item->size;
+    item->codec = OWL_PAK_RAW;
+
+    if (item->length > 0xFFFF) {
+      fprintf(stderr, "owlpack: name too long: %s\n", item->name);
+      goto done;
+    }
+
+    if (compress && !compressItem(item))
+      goto done;
+  }
+
+  qsort(items, count, sizeof(owl_PackItem), compareItem);
+
+  for (i = 1; i < (s32)count; ++i)
+    if (0 == strcmp(items[i - 1].name, items[i].name)) {
+      fprintf(stderr, "owlpack: duplicate entry %s\n", items[i].name);
+      goto done;
+    }
+
+  if (!writePack(output, items, count))
+    goto done;
+
+  for (i = 0; i < (s32)count; ++i) {
+    raw += items[i].size;
+    stored += items[i].packed;
+  }
+
+  printf("%s: %u entries, %u -> %u bytes\n", output, count, raw, stored);
+  retval = 0;
+
+done:
+  for (i = 0; i < (s32)count; ++i) {
+    free(items[i].name);
+    free(items[i].data);
+  }
+
+  free(items);
+  return retval;
+}
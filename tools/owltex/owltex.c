@@ -0,0 +1,144 @@
+/*
+ * owltex.c
+ *
+ * Copyright (c) 2022 Xiongfei Shi. All rights reserved.
+ *
+ * Author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *
+ * This file is part of Owl.
+ * Usage of Owl is subject to the appropriate license agreement.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "owl_lz.h"
+#include "owl_tex.h"
+
+static void colorKey(u8 *pixels, u32 count, u32 key) {
+  u8 r = (u8)(key >> 16), g = (u8)(key >> 8), b = (u8)key;
+  u32 i;
+
+  for (i = 0; i < count; ++i, pixels += 4)
+    if (pixels[0] == r && pixels[1] == g && pixels[2] == b)
+      memset(pixels, 0, 4);
+}
+
+static void premultiply(u8 *pixels, u32 count) {
+  u32 i, a;
+
+  for (i = 0; i < count; ++i, pixels += 4) {
+    a = pixels[3];
+    pixels[0] = (u8)((pixels[0] * a + 127) / 255);
+    pixels[1] = (u8)((pixels[1] * a + 127) / 255);
+    pixels[2] = (u8)((pixels[2] * a + 127) / 255);
+  }
+}
+
+static void usage(const char *self) {
+  printf("usage: %s [-p] [-z] [-k RRGGBB] <input> <output.owltex>\n\n", self);
+  printf("  -p         premultiply alpha\n");
+  printf("  -z         compress when it saves at least 1/8\n");
+  printf("  -k RRGGBB  make pixels of this color transparent\n");
+}
+
+int main(int argc, char *argv[]) {
+  owl_TexHeader header;
+  const u8 *payload;
+  u8 *pixels, *packed = NULL;
+  bool compress = false;
+  s32 i, w, h, n, bound, size;
+  u32 key = 0, flags = 0;
+  FILE *fp;
+
+  for (i = 1; i < argc && argv[i][0] == '-'; ++i) {
+    if (0 == strcmp(argv[i], "-p"))
+      flags |= OWL_TEX_PREMULTIPLIED;
+    else if (0 == strcmp(argv[i], "-z"))
+      compress = true;
+    else if (0 == strcmp(argv[i], "-k") && i + 1 < argc) {
+      key = (u32)strtoul(argv[++i], NULL, 16);
+      flags |= OWL_TEX_COLORKEYED;
+    } else {
+      usage(argv[0]);
+      return -1;
+    }
+  }
+
+  if (argc - i != 2) {
+    usage(argv[0]);
+    return -1;
+  }
+
+  pixels = stbi_load(argv[i], &w, &h, &n, STBI_rgb_alpha);
+
+  if (!pixels) {
+    fprintf(stderr, "owltex: cannot decode %s\n", argv[i]);
+    return -1;
+  }
+
+  /* Sizes are s32 in the codec, so the whole image has to fit one */
+  if (w > 0xFFFF || h > 0xFFFF || (u64)w * h * 4 > INT32_MAX) {
+    fprintf(stderr, "owltex: %s is too large\n", argv[i]);
+    stbi_image_free(pixels);
+    return -1;
+  }
+
+  /* Keying runs first so premultiplied keyed pixels end up all zero */
+  if (flags & OWL_TEX_COLORKEYED)
+    colorKey(pixels, (u32)(w * h), key);
+
+  if (flags & OWL_TEX_PREMULTIPLIED)
+    premultiply(pixels, (u32)(w * h));
+
+  memset(&header, 0, sizeof(header));
+  header.magic = OWL_TEX_MAGIC;
+  header.version = OWL_TEX_VERSION;
+  header.flags = (u16)flags;
+  header.width = (u32)w;
+  header.height = (u32)h;
+  header.size = (u32)(w * h * 4);
+  header.packed = header.size;
+  header.offset = sizeof(owl_TexHeader);
+  header.codec = OWL_TEX_RAW;
+
+  payload = pixels;
+
+  /* Past this the bound itself no longer fits, keep such images raw */
+  if (compress && (u64)header.size + header.size / 255 + 16 <= INT32_MAX) {
+    bound = owl_lzBound((s32)header.size);
+    packed = (u8 *)malloc(bound);
+    size = packed ? owl_lzCompress(pixels, (s32)header.size, packed, bound)
+                  : 0;
+
+    if (size > 0 && (u32)size <= header.size - header.size / 8) {
+      header.packed = (u32)size;
+      header.codec = OWL_TEX_LZ;
+      payload = packed;
+    }
+  }
+
+  fp = fopen(argv[i + 1], "wb");
+
+  if (!fp) {
+    fprintf(stderr, "owltex: cannot create %s\n", argv[i + 1]);
+    stbi_image_free(pixels);
+    free(packed);
+    return -1;
+  }
+
+  fwrite(&header, sizeof(header), 1, fp);
+  fwrite(payload, 1, header.packed, fp);
+  fclose(fp);
+
+  printf("%s: %dx%d, %u -> %u bytes\n", argv[i + 1], w, h, header.size,
+         header.packed);
+
+  stbi_image_free(pixels);
+  free(packed);
+  return 0;
+}